@@ -24,6 +24,10 @@
  * =======================================================================
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+ #define _GNU_SOURCE
+#endif
+
 #include "../../common/header/common.h"
 
 #include <unistd.h>
@@ -50,19 +54,64 @@ netadr_t net_local_adr;
 #define MAX_LOOPBACK 4
 #define QUAKE2MCAST "ff12::666"
 
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__NetBSD__)
+#define HAVE_MMSG
+#endif
+
+#define NET_BATCH 16 /* packets per recvmmsg() / sendmmsg() */
+#define NET_BATCH_BYTES (64 * 1024)
+
 typedef struct
 {
-	byte data[MAX_MSGLEN];
+	byte *data;
 	int datalen;
+	int maxlen;
+	unsigned short port;
 } loopmsg_t;
 
 typedef struct
 {
-	loopmsg_t msgs[MAX_LOOPBACK];
+	loopmsg_t *msgs;
+	int size; /* power of two */
 	int get, send;
 } loopback_t;
 
-loopback_t loopbacks[2];
+/* packets read by the last recvmmsg() */
+typedef struct
+{
+	byte data[NET_BATCH][MAX_MSGLEN];
+	struct sockaddr_storage from[NET_BATCH];
+	int len[NET_BATCH];
+	qboolean truncated[NET_BATCH];
+	int count, next;
+} netrecv_t;
+
+/* packets waiting for NET_BatchFlush() */
+typedef struct
+{
+	byte data[NET_BATCH_BYTES];
+	int size;
+	int socket[NET_BATCH];
+	struct sockaddr_storage addr[NET_BATCH];
+	socklen_t addrlen[NET_BATCH];
+	netadr_t to[NET_BATCH];
+	int ofs[NET_BATCH];
+	int len[NET_BATCH];
+	int count;
+	qboolean active;
+} netsend_t;
+
+static netrecv_t net_recv[2];
+static netsend_t net_send[2];
+
+/* syscall counters for net_stats */
+static unsigned int net_recvcalls, net_recvpackets;
+static unsigned int net_sendcalls, net_sendpackets;
+
+static loopmsg_t loop_msgs[2][MAX_LOOPBACK];
+loopback_t loopbacks[2] = {
+	{loop_msgs[0], MAX_LOOPBACK}, {loop_msgs[1], MAX_LOOPBACK}
+};
 int ip_sockets[2];
 int ip6_sockets[2];
 int ipx_sockets[2];
@@ -188,9 +237,24 @@ SockadrToNetadr(struct sockaddr_storage *s, netadr_t *a)
 	}
 }
 
+static void
+NET_Stats_f(void)
+{
+	Com_Printf("received %u packets with %u calls, %.2f per call\n",
+		net_recvpackets, net_recvcalls,
+		net_recvcalls ? (float)net_recvpackets / net_recvcalls : 0.0f);
+	Com_Printf("sent %u packets with %u calls, %.2f per call\n",
+		net_sendpackets, net_sendcalls,
+		net_sendcalls ? (float)net_sendpackets / net_sendcalls : 0.0f);
+#ifndef HAVE_MMSG
+	Com_Printf("no recvmmsg() / sendmmsg() on this platform\n");
+#endif
+}
+
 void
 NET_Init()
 {
+	Cmd_AddCommand("net_stats", NET_Stats_f);
 }
 
 qboolean
@@ -481,9 +545,9 @@ NET_GetLoopPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 
 	loop = &loopbacks[sock];
 
-	if (loop->send - loop->get > MAX_LOOPBACK)
+	if (loop->send - loop->get > loop->size)
 	{
-		loop->get = loop->send - MAX_LOOPBACK;
+		loop->get = loop->send - loop->size;
 	}
 
 	if (loop->get >= loop->send)
@@ -491,12 +555,13 @@ NET_GetLoopPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 		return false;
 	}
 
-	i = loop->get & (MAX_LOOPBACK - 1);
+	i = loop->get & (loop->size - 1);
 	loop->get++;
 
 	memcpy(net_message->data, loop->msgs[i].data, loop->msgs[i].datalen);
 	net_message->cursize = loop->msgs[i].datalen;
 	*net_from = net_local_adr;
+	net_from->port = loop->msgs[i].port;
 	return true;
 }
 
@@ -508,28 +573,94 @@ NET_SendLoopPacket(netsrc_t sock, int length, const void *data, netadr_t to)
 
 	loop = &loopbacks[sock ^ 1];
 
-	i = loop->send & (MAX_LOOPBACK - 1);
+	i = loop->send & (loop->size - 1);
 	loop->send++;
 
+	if (loop->msgs[i].maxlen < length)
+	{
+		loop->msgs[i].data = realloc(loop->msgs[i].data, length);
+		YQ2_COM_CHECK_OOM(loop->msgs[i].data, "realloc()", length)
+		loop->msgs[i].maxlen = length;
+	}
+
 	memcpy(loop->msgs[i].data, data, length);
 	loop->msgs[i].datalen = length;
+
+	/* the receiver gets the port of the destination as port of
+	   net_from. The in-process clients of sv_bench each use their
+	   own port to tell their packets apart */
+	loop->msgs[i].port = to.port;
 }
 
-qboolean
-NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
+/*
+ * Resizes the loopback queues to hold at least the given number of
+ * packets, for the in-process clients of sv_bench. Packets still in
+ * the queues are dropped. MAX_LOOPBACK or less restores the default.
+ */
+void
+NET_SetLoopbackSize(int packets)
 {
-	int ret;
-	struct sockaddr_storage from;
-	socklen_t fromlen;
-	int net_socket;
-	int protocol;
-	int err;
+	loopback_t *loop;
+	int sock, size, i;
 
-	if (NET_GetLoopPacket(sock, net_from, net_message))
+	size = MAX_LOOPBACK;
+
+	while (size < packets)
 	{
-		return true;
+		size <<= 1;
 	}
 
+	for (sock = 0; sock < 2; sock++)
+	{
+		loop = &loopbacks[sock];
+
+		if (loop->size == size)
+		{
+			continue;
+		}
+
+		for (i = 0; i < loop->size; i++)
+		{
+			free(loop->msgs[i].data);
+		}
+
+		if (loop->msgs != loop_msgs[sock])
+		{
+			free(loop->msgs);
+		}
+
+		if (size == MAX_LOOPBACK)
+		{
+			loop->msgs = loop_msgs[sock];
+			memset(loop_msgs[sock], 0, sizeof(loop_msgs[sock]));
+		}
+		else
+		{
+			loop->msgs = calloc(size, sizeof(loopmsg_t));
+			YQ2_COM_CHECK_OOM(loop->msgs, "calloc()", size * sizeof(loopmsg_t))
+		}
+
+		loop->size = size;
+		loop->get = loop->send = 0;
+	}
+}
+
+/*
+ * Refills the receive buffer of sock with everything
+ * that's waiting on the first socket that has packets.
+ */
+static qboolean
+NET_RecvBatch(netsrc_t sock)
+{
+	netrecv_t *recv;
+	int net_socket;
+	int protocol;
+	int ret, i;
+
+	recv = &net_recv[sock];
+	recv->count = 0;
+	recv->next = 0;
+
 	for (protocol = 0; protocol < 3; protocol++)
 	{
 		if (protocol == 0)
@@ -550,15 +681,56 @@ NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 			continue;
 		}
 
-		fromlen = sizeof(from);
-		memset(&from, 0, fromlen);
-		ret = recvfrom(net_socket, net_message->data, net_message->maxsize,
-				0, (struct sockaddr *)&from, &fromlen);
+#ifdef HAVE_MMSG
+		{
+			struct mmsghdr msgs[NET_BATCH];
+			struct iovec iov[NET_BATCH];
+
+			memset(msgs, 0, sizeof(msgs));
+
+			for (i = 0; i < NET_BATCH; i++)
+			{
+				iov[i].iov_base = recv->data[i];
+				iov[i].iov_len = MAX_MSGLEN;
+				msgs[i].msg_hdr.msg_iov = &iov[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+				msgs[i].msg_hdr.msg_name = &recv->from[i];
+				msgs[i].msg_hdr.msg_namelen = sizeof(recv->from[i]);
+			}
+
+			ret = recvmmsg(net_socket, msgs, NET_BATCH, 0, NULL);
+			net_recvcalls++;
 
-		SockadrToNetadr(&from, net_from);
+			for (i = 0; i < ret; i++)
+			{
+				recv->len[i] = msgs[i].msg_len;
+				recv->truncated[i] = (msgs[i].msg_len >= MAX_MSGLEN) ||
+					(msgs[i].msg_hdr.msg_flags & MSG_TRUNC);
+			}
+		}
+#else
+		{
+			socklen_t fromlen;
+
+			fromlen = sizeof(recv->from[0]);
+			memset(&recv->from[0], 0, fromlen);
+			ret = recvfrom(net_socket, recv->data[0], MAX_MSGLEN,
+					0, (struct sockaddr *)&recv->from[0], &fromlen);
+			net_recvcalls++;
+
+			if (ret >= 0)
+			{
+				recv->len[0] = ret;
+				recv->truncated[0] = (ret == MAX_MSGLEN);
+				ret = 1;
+			}
+		}
+#endif
 
 		if (ret == -1)
 		{
+			int err;
+
 			err = errno;
 
 			if ((err == EWOULDBLOCK) || (err == ECONNREFUSED))
@@ -566,24 +738,137 @@ NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 				continue;
 			}
 
-			Com_Printf("%s: %s from %s\n", NET_ErrorString(),
-					__func__, NET_AdrToString(*net_from));
+			Com_Printf("%s: %s\n", NET_ErrorString(), __func__);
 			continue;
 		}
 
-		if (ret == net_message->maxsize)
+		if (ret > 0)
+		{
+			recv->count = ret;
+			net_recvpackets += ret;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+qboolean
+NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
+{
+	netrecv_t *recv;
+
+	if (NET_GetLoopPacket(sock, net_from, net_message))
+	{
+		return true;
+	}
+
+	recv = &net_recv[sock];
+
+	while ((recv->next < recv->count) || NET_RecvBatch(sock))
+	{
+		int i;
+
+		i = recv->next++;
+
+		SockadrToNetadr(&recv->from[i], net_from);
+
+		if (recv->truncated[i] || (recv->len[i] >= net_message->maxsize))
 		{
 			Com_Printf("Oversize packet from %s\n", NET_AdrToString(*net_from));
 			continue;
 		}
 
-		net_message->cursize = ret;
+		memcpy(net_message->data, recv->data[i], recv->len[i]);
+		net_message->cursize = recv->len[i];
 		return true;
 	}
 
 	return false;
 }
 
+/*
+ * Sends everything queued for sock.
+ */
+static void
+NET_SendBatch(netsrc_t sock)
+{
+	netsend_t *send;
+	int i, ret;
+
+	send = &net_send[sock];
+
+	for (i = 0; i < send->count; )
+	{
+#ifdef HAVE_MMSG
+		struct mmsghdr msgs[NET_BATCH];
+		struct iovec iov[NET_BATCH];
+		int j, num;
+
+		/* one call for all packets to the same socket */
+		memset(msgs, 0, sizeof(msgs));
+
+		for (num = 0, j = i; (j < send->count) &&
+			(send->socket[j] == send->socket[i]); j++, num++)
+		{
+			iov[num].iov_base = send->data + send->ofs[j];
+			iov[num].iov_len = send->len[j];
+			msgs[num].msg_hdr.msg_iov = &iov[num];
+			msgs[num].msg_hdr.msg_iovlen = 1;
+			msgs[num].msg_hdr.msg_name = &send->addr[j];
+			msgs[num].msg_hdr.msg_namelen = send->addrlen[j];
+		}
+
+		ret = sendmmsg(send->socket[i], msgs, num, 0);
+		net_sendcalls++;
+
+		if (ret > 0)
+		{
+			net_sendpackets += ret;
+			i += ret;
+			continue;
+		}
+#else
+		ret = sendto(send->socket[i], send->data + send->ofs[i],
+				send->len[i], 0, (struct sockaddr *)&send->addr[i],
+				send->addrlen[i]);
+		net_sendcalls++;
+
+		if (ret != -1)
+		{
+			net_sendpackets++;
+			i++;
+			continue;
+		}
+#endif
+
+		/* the first packet failed, skip it */
+		Com_Printf("%s ERROR: %s to %s\n", NET_ErrorString(),
+				__func__, NET_AdrToString(send->to[i]));
+		i++;
+	}
+
+	send->count = 0;
+	send->size = 0;
+}
+
+/*
+ * Until NET_BatchFlush is called packets to sock are
+ * collected and then sent with as few calls as possible.
+ */
+void
+NET_BatchBegin(netsrc_t sock)
+{
+	net_send[sock].active = true;
+}
+
+void
+NET_BatchFlush(netsrc_t sock)
+{
+	NET_SendBatch(sock);
+	net_send[sock].active = false;
+}
+
 void
 NET_SendPacket(netsrc_t sock, int length, const void *data, netadr_t to)
 {
@@ -724,18 +1009,48 @@ NET_SendPacket(netsrc_t sock, int length, const void *data, netadr_t to)
 		}
 	}
 
+	if (net_send[sock].active)
+	{
+		netsend_t *send;
+
+		send = &net_send[sock];
+
+		if ((send->count == NET_BATCH) ||
+			(send->size + length > NET_BATCH_BYTES))
+		{
+			NET_SendBatch(sock);
+		}
+
+		send->socket[send->count] = net_socket;
+		send->addr[send->count] = addr;
+		send->addrlen[send->count] = addr_size;
+		send->to[send->count] = to;
+		send->ofs[send->count] = send->size;
+		send->len[send->count] = length;
+		memcpy(send->data + send->size, data, length);
+		send->size += length;
+		send->count++;
+
+		return;
+	}
+
 	ret = sendto(net_socket,
 			data,
 			length,
 			0,
 			(struct sockaddr *)&addr,
 			addr_size);
+	net_sendcalls++;
 
 	if (ret == -1)
 	{
 		Com_Printf("%s ERROR: %s to %s\n", NET_ErrorString(),
 				__func__, NET_AdrToString(to));
 	}
+	else
+	{
+		net_sendpackets++;
+	}
 }
 
 static void
@@ -784,6 +1099,10 @@ NET_Config(qboolean multiplayer)
 		/* shut down any existing sockets */
 		for (i = 0; i < 2; i++)
 		{
+			NET_BatchFlush(i);
+			net_recv[i].count = 0;
+			net_recv[i].next = 0;
+
 			if (ip_sockets[i])
 			{
 				close(ip_sockets[i]);
@@ -1012,6 +1331,11 @@ NET_Sleep(int msec)
 		return; /* we're not a server, just run full speed */
 	}
 
+	if (net_recv[NS_SERVER].next < net_recv[NS_SERVER].count)
+	{
+		return; /* still got packets from the last call */
+	}
+
 	FD_ZERO(&fdset);
 
 	if (stdin_active)
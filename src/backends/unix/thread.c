@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * A small pool of worker threads. Sys_ParallelFor() hands out the
+ * indices of a job to the workers and the calling thread and returns
+ * when all of them are done. Jobs can't be nested, a job started while
+ * another one is running is executed by the caller alone.
+ * Sys_StartThread() runs longer background work on a thread of its
+ * own, the caller polls it with Sys_ThreadDone().
+ *
+ * =======================================================================
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "../../common/header/common.h"
+
+#define MAX_WORKERS 16
+
+typedef void (*workerfunc_t)(void *data, int index, int worker);
+
+static cvar_t *sys_workers;
+
+static pthread_t worker_threads[MAX_WORKERS];
+static int worker_numthreads; /* without the calling thread */
+
+static pthread_mutex_t worker_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t worker_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t worker_done = PTHREAD_COND_INITIALIZER;
+static unsigned int worker_job;
+static int worker_busy;
+static qboolean worker_quit;
+static qboolean worker_active;
+
+typedef struct
+{
+	pthread_t thread;
+	void (*func)(void *data);
+	void *data;
+	qboolean done;
+} systhread_t;
+
+static pthread_mutex_t thread_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static workerfunc_t job_func;
+static void *job_data;
+static int job_count;
+static int job_next;
+
+static void
+Sys_RunJob(int worker)
+{
+	int i;
+
+	while ((i = __sync_fetch_and_add(&job_next, 1)) < job_count)
+	{
+		job_func(job_data, i, worker);
+	}
+}
+
+static void *
+Sys_WorkerMain(void *arg)
+{
+	int worker = (int)(intptr_t)arg;
+	unsigned int job = 0;
+
+	pthread_mutex_lock(&worker_lock);
+
+	while (1)
+	{
+		while (!worker_quit && (job == worker_job))
+		{
+			pthread_cond_wait(&worker_wake, &worker_lock);
+		}
+
+		if (worker_quit)
+		{
+			break;
+		}
+
+		job = worker_job;
+		pthread_mutex_unlock(&worker_lock);
+
+		Sys_RunJob(worker);
+
+		pthread_mutex_lock(&worker_lock);
+
+		if (--worker_busy == 0)
+		{
+			pthread_cond_signal(&worker_done);
+		}
+	}
+
+	pthread_mutex_unlock(&worker_lock);
+
+	return NULL;
+}
+
+void
+Sys_ShutdownWorkers(void)
+{
+	int i;
+
+	if (!worker_numthreads)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&worker_lock);
+	worker_quit = true;
+	pthread_cond_broadcast(&worker_wake);
+	pthread_mutex_unlock(&worker_lock);
+
+	for (i = 0; i < worker_numthreads; i++)
+	{
+		/* Sys_Error() from inside a job, don't wait for ourself */
+		if (pthread_equal(worker_threads[i], pthread_self()))
+		{
+			return;
+		}
+	}
+
+	for (i = 0; i < worker_numthreads; i++)
+	{
+		pthread_join(worker_threads[i], NULL);
+	}
+
+	/* restarted threads count the jobs from 0 again */
+	worker_numthreads = 0;
+	worker_job = 0;
+	worker_quit = false;
+}
+
+/*
+ * (Re)starts the pool if sys_workers was changed.
+ */
+static void
+Sys_UpdateWorkers(void)
+{
+	int i, count;
+
+	if (!sys_workers)
+	{
+		sys_workers = Cvar_Get("sys_workers", "0", CVAR_ARCHIVE);
+		sys_workers->modified = true;
+	}
+
+	if (!sys_workers->modified)
+	{
+		return;
+	}
+
+	sys_workers->modified = false;
+
+	Sys_ShutdownWorkers();
+
+	count = (int)sys_workers->value;
+
+	if (count <= 0)
+	{
+		count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+
+	count = Q_clamp(count, 1, MAX_WORKERS) - 1;
+
+	for (i = 0; i < count; i++)
+	{
+		if (pthread_create(&worker_threads[worker_numthreads], NULL,
+				Sys_WorkerMain, (void *)(intptr_t)(worker_numthreads + 1)))
+		{
+			Com_Printf("%s: Couldn't start worker thread %d\n",
+				__func__, i + 1);
+			break;
+		}
+
+		worker_numthreads++;
+	}
+
+	Com_DPrintf("%s: %d worker threads\n", __func__, worker_numthreads);
+}
+
+int
+Sys_NumWorkers(void)
+{
+	if (!worker_active)
+	{
+		Sys_UpdateWorkers();
+	}
+
+	return worker_numthreads + 1;
+}
+
+void
+Sys_ParallelFor(int count, void (*func)(void *data, int index, int worker),
+	void *data)
+{
+	int i;
+
+	if (count <= 0)
+	{
+		return;
+	}
+
+	if (worker_active)
+	{
+		/* called from inside a job */
+		for (i = 0; i < count; i++)
+		{
+			func(data, i, 0);
+		}
+
+		return;
+	}
+
+	Sys_UpdateWorkers();
+
+	if (!worker_numthreads || (count == 1))
+	{
+		for (i = 0; i < count; i++)
+		{
+			func(data, i, 0);
+		}
+
+		return;
+	}
+
+	worker_active = true;
+
+	pthread_mutex_lock(&worker_lock);
+	job_func = func;
+	job_data = data;
+	job_count = count;
+	job_next = 0;
+	worker_busy = worker_numthreads;
+	worker_job++;
+	pthread_cond_broadcast(&worker_wake);
+	pthread_mutex_unlock(&worker_lock);
+
+	Sys_RunJob(0);
+
+	pthread_mutex_lock(&worker_lock);
+
+	while (worker_busy)
+	{
+		pthread_cond_wait(&worker_done, &worker_lock);
+	}
+
+	pthread_mutex_unlock(&worker_lock);
+
+	worker_active = false;
+}
+
+static void *
+Sys_ThreadMain(void *arg)
+{
+	systhread_t *thread = arg;
+
+	thread->func(thread->data);
+
+	pthread_mutex_lock(&thread_lock);
+	thread->done = true;
+	pthread_mutex_unlock(&thread_lock);
+
+	return NULL;
+}
+
+/*
+ * Runs func on a new thread. Returns NULL if that failed,
+ * otherwise the thread must be joined with Sys_JoinThread().
+ */
+void *
+Sys_StartThread(void (*func)(void *data), void *data)
+{
+	systhread_t *thread;
+
+	thread = calloc(1, sizeof(*thread));
+
+	if (!thread)
+	{
+		return NULL;
+	}
+
+	thread->func = func;
+	thread->data = data;
+
+	if (pthread_create(&thread->thread, NULL, Sys_ThreadMain, thread))
+	{
+		free(thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+qboolean
+Sys_ThreadDone(void *thread)
+{
+	qboolean done;
+
+	pthread_mutex_lock(&thread_lock);
+	done = ((systhread_t *)thread)->done;
+	pthread_mutex_unlock(&thread_lock);
+
+	return done;
+}
+
+void
+Sys_JoinThread(void *thread)
+{
+	pthread_join(((systhread_t *)thread)->thread, NULL);
+	free(thread);
+}
@@ -37,13 +37,16 @@
 
 typedef struct
 {
-	byte data[MAX_MSGLEN];
+	byte *data;
 	int datalen;
+	int maxlen;
+	unsigned short port;
 } loopmsg_t;
 
 typedef struct
 {
-	loopmsg_t msgs[MAX_LOOPBACK];
+	loopmsg_t *msgs;
+	int size; /* power of two */
 	int get, send;
 } loopback_t;
 
@@ -51,7 +54,14 @@ cvar_t *net_shownet;
 static cvar_t *noudp;
 static cvar_t *noipx;
 
-loopback_t loopbacks[2];
+/* syscall counters for net_stats */
+static unsigned int net_recvcalls, net_recvpackets;
+static unsigned int net_sendcalls, net_sendpackets;
+
+static loopmsg_t loop_msgs[2][MAX_LOOPBACK];
+loopback_t loopbacks[2] = {
+	{loop_msgs[0], MAX_LOOPBACK}, {loop_msgs[1], MAX_LOOPBACK}
+};
 int ip_sockets[2];
 int ip6_sockets[2];
 int ipx_sockets[2];
@@ -502,9 +512,9 @@ NET_GetLoopPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 
 	loop = &loopbacks[sock];
 
-	if (loop->send - loop->get > MAX_LOOPBACK)
+	if (loop->send - loop->get > loop->size)
 	{
-		loop->get = loop->send - MAX_LOOPBACK;
+		loop->get = loop->send - loop->size;
 	}
 
 	if (loop->get >= loop->send)
@@ -512,13 +522,14 @@ NET_GetLoopPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 		return false;
 	}
 
-	i = loop->get & (MAX_LOOPBACK - 1);
+	i = loop->get & (loop->size - 1);
 	loop->get++;
 
 	memcpy(net_message->data, loop->msgs[i].data, loop->msgs[i].datalen);
 	net_message->cursize = loop->msgs[i].datalen;
 	memset(net_from, 0, sizeof(*net_from));
 	net_from->type = NA_LOOPBACK;
+	net_from->port = loop->msgs[i].port;
 	return true;
 }
 
@@ -530,11 +541,76 @@ NET_SendLoopPacket(netsrc_t sock, int length, const void *data, netadr_t to)
 
 	loop = &loopbacks[sock ^ 1];
 
-	i = loop->send & (MAX_LOOPBACK - 1);
+	i = loop->send & (loop->size - 1);
 	loop->send++;
 
+	if (loop->msgs[i].maxlen < length)
+	{
+		loop->msgs[i].data = realloc(loop->msgs[i].data, length);
+		YQ2_COM_CHECK_OOM(loop->msgs[i].data, "realloc()", length)
+		loop->msgs[i].maxlen = length;
+	}
+
 	memcpy(loop->msgs[i].data, data, length);
 	loop->msgs[i].datalen = length;
+
+	/* the receiver gets the port of the destination as port of
+	   net_from. The in-process clients of sv_bench each use their
+	   own port to tell their packets apart */
+	loop->msgs[i].port = to.port;
+}
+
+/*
+ * Resizes the loopback queues to hold at least the given number of
+ * packets, for the in-process clients of sv_bench. Packets still in
+ * the queues are dropped. MAX_LOOPBACK or less restores the default.
+ */
+void
+NET_SetLoopbackSize(int packets)
+{
+	loopback_t *loop;
+	int sock, size, i;
+
+	size = MAX_LOOPBACK;
+
+	while (size < packets)
+	{
+		size <<= 1;
+	}
+
+	for (sock = 0; sock < 2; sock++)
+	{
+		loop = &loopbacks[sock];
+
+		if (loop->size == size)
+		{
+			continue;
+		}
+
+		for (i = 0; i < loop->size; i++)
+		{
+			free(loop->msgs[i].data);
+		}
+
+		if (loop->msgs != loop_msgs[sock])
+		{
+			free(loop->msgs);
+		}
+
+		if (size == MAX_LOOPBACK)
+		{
+			loop->msgs = loop_msgs[sock];
+			memset(loop_msgs[sock], 0, sizeof(loop_msgs[sock]));
+		}
+		else
+		{
+			loop->msgs = calloc(size, sizeof(loopmsg_t));
+			YQ2_COM_CHECK_OOM(loop->msgs, "calloc()", size * sizeof(loopmsg_t))
+		}
+
+		loop->size = size;
+		loop->get = loop->send = 0;
+	}
 }
 
 /* ============================================================================= */
@@ -579,6 +655,7 @@ NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 		ret = recvfrom(net_socket, (char *)net_message->data,
 				net_message->maxsize, 0, (struct sockaddr *)&from,
 				&fromlen);
+		net_recvcalls++;
 
 		SockadrToNetadr(&from, net_from);
 
@@ -612,6 +689,8 @@ NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 			continue;
 		}
 
+		net_recvpackets++;
+
 		if (ret == net_message->maxsize)
 		{
 			Com_Printf("Oversize packet from %s\n", NET_AdrToString(*net_from));
@@ -761,6 +840,12 @@ NET_SendPacket(netsrc_t sock, int length, const void *data, netadr_t to)
 
 	ret = sendto(net_socket, data, length, 0,
 			(struct sockaddr *)&addr, addr_size);
+	net_sendcalls++;
+
+	if (ret != -1)
+	{
+		net_sendpackets++;
+	}
 
 	if (ret == -1)
 	{
@@ -1263,6 +1348,30 @@ NET_Sleep(int msec)
 	select(i + 1, &fdset, NULL, NULL, &timeout);
 }
 
+/*
+ * Winsock has no sendmmsg(), packets are always sent right away.
+ */
+void
+NET_BatchBegin(netsrc_t sock)
+{
+}
+
+void
+NET_BatchFlush(netsrc_t sock)
+{
+}
+
+static void
+NET_Stats_f(void)
+{
+	Com_Printf("received %u packets with %u calls, %.2f per call\n",
+		net_recvpackets, net_recvcalls,
+		net_recvcalls ? (float)net_recvpackets / net_recvcalls : 0.0f);
+	Com_Printf("sent %u packets with %u calls, %.2f per call\n",
+		net_sendpackets, net_sendcalls,
+		net_sendcalls ? (float)net_sendpackets / net_sendcalls : 0.0f);
+}
+
 /* =================================================================== */
 
 void
@@ -1284,6 +1393,8 @@ NET_Init(void)
 	noipx = Cvar_Get("noipx", "0", CVAR_NOSET);
 
 	net_shownet = Cvar_Get("net_shownet", "0", 0);
+
+	Cmd_AddCommand("net_stats", NET_Stats_f);
 }
 
 void
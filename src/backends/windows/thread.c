@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * A small pool of worker threads. Sys_ParallelFor() hands out the
+ * indices of a job to the workers and the calling thread and returns
+ * when all of them are done. Jobs can't be nested, a job started while
+ * another one is running is executed by the caller alone.
+ * Sys_StartThread() runs longer background work on a thread of its
+ * own, the caller polls it with Sys_ThreadDone().
+ *
+ * =======================================================================
+ */
+
+#include <windows.h>
+
+#include "../../common/header/common.h"
+
+#define MAX_WORKERS 16
+
+typedef void (*workerfunc_t)(void *data, int index, int worker);
+
+static cvar_t *sys_workers;
+
+static HANDLE worker_threads[MAX_WORKERS];
+static DWORD worker_ids[MAX_WORKERS];
+static int worker_numthreads; /* without the calling thread */
+
+static CRITICAL_SECTION worker_lock;
+static CONDITION_VARIABLE worker_wake;
+static CONDITION_VARIABLE worker_done;
+static unsigned int worker_job;
+static int worker_busy;
+static qboolean worker_quit;
+static qboolean worker_active;
+
+typedef struct
+{
+	HANDLE handle;
+	void (*func)(void *data);
+	void *data;
+} systhread_t;
+
+static workerfunc_t job_func;
+static void *job_data;
+static int job_count;
+static volatile LONG job_next;
+
+static void
+Sys_RunJob(int worker)
+{
+	int i;
+
+	while ((i = InterlockedIncrement(&job_next) - 1) < job_count)
+	{
+		job_func(job_data, i, worker);
+	}
+}
+
+static DWORD WINAPI
+Sys_WorkerMain(LPVOID arg)
+{
+	int worker = (int)(INT_PTR)arg;
+	unsigned int job = 0;
+
+	EnterCriticalSection(&worker_lock);
+
+	while (1)
+	{
+		while (!worker_quit && (job == worker_job))
+		{
+			SleepConditionVariableCS(&worker_wake, &worker_lock, INFINITE);
+		}
+
+		if (worker_quit)
+		{
+			break;
+		}
+
+		job = worker_job;
+		LeaveCriticalSection(&worker_lock);
+
+		Sys_RunJob(worker);
+
+		EnterCriticalSection(&worker_lock);
+
+		if (--worker_busy == 0)
+		{
+			WakeConditionVariable(&worker_done);
+		}
+	}
+
+	LeaveCriticalSection(&worker_lock);
+
+	return 0;
+}
+
+void
+Sys_ShutdownWorkers(void)
+{
+	int i;
+
+	if (!worker_numthreads)
+	{
+		return;
+	}
+
+	EnterCriticalSection(&worker_lock);
+	worker_quit = true;
+	WakeAllConditionVariable(&worker_wake);
+	LeaveCriticalSection(&worker_lock);
+
+	for (i = 0; i < worker_numthreads; i++)
+	{
+		/* Sys_Error() from inside a job, don't wait for ourself */
+		if (worker_ids[i] == GetCurrentThreadId())
+		{
+			return;
+		}
+	}
+
+	WaitForMultipleObjects(worker_numthreads, worker_threads, TRUE, INFINITE);
+
+	for (i = 0; i < worker_numthreads; i++)
+	{
+		CloseHandle(worker_threads[i]);
+	}
+
+	/* restarted threads count the jobs from 0 again */
+	worker_numthreads = 0;
+	worker_job = 0;
+	worker_quit = false;
+}
+
+/*
+ * (Re)starts the pool if sys_workers was changed.
+ */
+static void
+Sys_UpdateWorkers(void)
+{
+	int i, count;
+
+	if (!sys_workers)
+	{
+		InitializeCriticalSection(&worker_lock);
+		InitializeConditionVariable(&worker_wake);
+		InitializeConditionVariable(&worker_done);
+
+		sys_workers = Cvar_Get("sys_workers", "0", CVAR_ARCHIVE);
+		sys_workers->modified = true;
+	}
+
+	if (!sys_workers->modified)
+	{
+		return;
+	}
+
+	sys_workers->modified = false;
+
+	Sys_ShutdownWorkers();
+
+	count = (int)sys_workers->value;
+
+	if (count <= 0)
+	{
+		SYSTEM_INFO info;
+
+		GetSystemInfo(&info);
+		count = (int)info.dwNumberOfProcessors;
+	}
+
+	count = Q_clamp(count, 1, MAX_WORKERS) - 1;
+
+	for (i = 0; i < count; i++)
+	{
+		worker_threads[worker_numthreads] = CreateThread(NULL, 0,
+				Sys_WorkerMain, (LPVOID)(INT_PTR)(worker_numthreads + 1), 0,
+				&worker_ids[worker_numthreads]);
+
+		if (!worker_threads[worker_numthreads])
+		{
+			Com_Printf("%s: Couldn't start worker thread %d\n",
+				__func__, i + 1);
+			break;
+		}
+
+		worker_numthreads++;
+	}
+
+	Com_DPrintf("%s: %d worker threads\n", __func__, worker_numthreads);
+}
+
+int
+Sys_NumWorkers(void)
+{
+	if (!worker_active)
+	{
+		Sys_UpdateWorkers();
+	}
+
+	return worker_numthreads + 1;
+}
+
+void
+Sys_ParallelFor(int count, void (*func)(void *data, int index, int worker),
+	void *data)
+{
+	int i;
+
+	if (count <= 0)
+	{
+		return;
+	}
+
+	if (worker_active)
+	{
+		/* called from inside a job */
+		for (i = 0; i < count; i++)
+		{
+			func(data, i, 0);
+		}
+
+		return;
+	}
+
+	Sys_UpdateWorkers();
+
+	if (!worker_numthreads || (count == 1))
+	{
+		for (i = 0; i < count; i++)
+		{
+			func(data, i, 0);
+		}
+
+		return;
+	}
+
+	worker_active = true;
+
+	EnterCriticalSection(&worker_lock);
+	job_func = func;
+	job_data = data;
+	job_count = count;
+	job_next = 0;
+	worker_busy = worker_numthreads;
+	worker_job++;
+	WakeAllConditionVariable(&worker_wake);
+	LeaveCriticalSection(&worker_lock);
+
+	Sys_RunJob(0);
+
+	EnterCriticalSection(&worker_lock);
+
+	while (worker_busy)
+	{
+		SleepConditionVariableCS(&worker_done, &worker_lock, INFINITE);
+	}
+
+	LeaveCriticalSection(&worker_lock);
+
+	worker_active = false;
+}
+
+static DWORD WINAPI
+Sys_ThreadMain(LPVOID arg)
+{
+	systhread_t *thread = arg;
+
+	thread->func(thread->data);
+
+	return 0;
+}
+
+/*
+ * Runs func on a new thread. Returns NULL if that failed,
+ * otherwise the thread must be joined with Sys_JoinThread().
+ */
+void *
+Sys_StartThread(void (*func)(void *data), void *data)
+{
+	systhread_t *thread;
+
+	thread = calloc(1, sizeof(*thread));
+
+	if (!thread)
+	{
+		return NULL;
+	}
+
+	thread->func = func;
+	thread->data = data;
+	thread->handle = CreateThread(NULL, 0, Sys_ThreadMain, thread, 0, NULL);
+
+	if (!thread->handle)
+	{
+		free(thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+qboolean
+Sys_ThreadDone(void *thread)
+{
+	return WaitForSingleObject(((systhread_t *)thread)->handle, 0) ==
+		WAIT_OBJECT_0;
+}
+
+void
+Sys_JoinThread(void *thread)
+{
+	WaitForSingleObject(((systhread_t *)thread)->handle, INFINITE);
+	CloseHandle(((systhread_t *)thread)->handle);
+	free(thread);
+}
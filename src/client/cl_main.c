@@ -956,7 +956,10 @@ CL_Frame(int packetdelta, int renderdelta, int timedelta, qboolean packetframe,
 	if (renderframe)
 	{
 		VID_CheckChanges();
+
+		PROF_BEGIN("CL_PredictMovement");
 		CL_PredictMovement();
+		PROF_END();
 
 		if (!cl.refresh_prepped && (cls.state == ca_active))
 		{
@@ -977,7 +980,9 @@ CL_Frame(int packetdelta, int renderdelta, int timedelta, qboolean packetframe,
 		}
 
 		/* update audio */
+		PROF_BEGIN("S_Update");
 		S_Update(cl.refdef.vieworg, cl.v_forward, cl.v_right, cl.v_up);
+		PROF_END();
 
 		/* advance local effects for next frame */
 		CL_RunDLights();
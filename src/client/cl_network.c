@@ -128,11 +128,15 @@ CL_SendConnectPacket(void)
 	}
 
 	port = Cvar_VariableValue("qport");
+	cls.quakePort = port;
 
 	userinfo_modified = false;
 
-	Netchan_OutOfBandPrint(NS_CLIENT, adr, "connect %i %i %i \"%s\"\n",
-			PROTOCOL_VERSION, port, cls.challenge, Cvar_Userinfo());
+	/* nc= offers netchan fragmentation and compression, old
+	   servers ignore it */
+	Netchan_OutOfBandPrint(NS_CLIENT, adr, "connect %i %i %i \"%s\" nc=%i\n",
+			PROTOCOL_VERSION, port, cls.challenge, Cvar_Userinfo(),
+			Netchan_FragmentSize());
 }
 
 /*
@@ -622,6 +626,11 @@ CL_ConnectionlessPacket(void)
 				Com_Printf("HTTP downloading supported by server but not the client.\n");
 #endif
 			}
+			else if (!strncmp(p, "nc=", 3))
+			{
+				/* server agreed on netchan fragmentation and compression */
+				Netchan_SetExtended(&cls.netchan, (int)strtol(p + 3, NULL, 10));
+			}
 		}
 
 		/* Put client into pause mode when connecting to a local server.
@@ -62,6 +62,7 @@ cvar_t *r_skeletalanimation;
 cvar_t *r_shadows;
 cvar_t *r_showtris;
 cvar_t *r_speeds;
+cvar_t *r_texcompress;
 cvar_t *r_ttffont;
 cvar_t *r_validation;
 cvar_t *r_videos_unfiltered;
@@ -277,6 +278,7 @@ R_InitCvar(void)
 	r_scale32bittextures = ri.Cvar_Get("r_scale32bittextures", "0", CVAR_ARCHIVE);
 	r_skeletalanimation = ri.Cvar_Get("r_skeletalanimation", "1", CVAR_ARCHIVE);
 	r_anisotropic = ri.Cvar_Get("r_anisotropic", "0", CVAR_ARCHIVE);
+	r_texcompress = ri.Cvar_Get("r_texcompress", "0", CVAR_ARCHIVE);
 	/* don't bilerp characters and crosshairs */
 	r_nolerp_list = ri.Cvar_Get("r_nolerp_list", DEFAULT_NOLERP_LIST, CVAR_ARCHIVE);
 	/* textures that should always be filtered, even if r_2D_unfiltered or an unfiltered gl mode is used */
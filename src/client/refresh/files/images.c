@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * Image registry. The renderers keep their images in an array of
+ * MAX_TEXTURES, the registry hashes the names to the array indices so
+ * that finding an image doesn't compare it to every loaded name.
+ *
+ * Before the textures of a map are loaded their retextured replacements
+ * are decoded on the worker threads, a batch at a time. LoadHiColorImage()
+ * takes the decoded pictures from here instead of decoding them itself.
+ *
+ * =======================================================================
+ */
+
+#include "../ref_shared.h"
+
+#define IMAGE_HASH_SIZE 1024    /* buckets, must be a power of two */
+
+typedef struct
+{
+	char namewe[MAX_QPATH];
+	byte *pic;
+	int width, height;
+} prefetchimage_t;
+
+static int image_hash[IMAGE_HASH_SIZE];      /* first index + 1, 0 if empty */
+static int image_next[MAX_TEXTURES];         /* next index + 1 in the bucket */
+static unsigned image_hashes[MAX_TEXTURES];
+static const char *image_names[MAX_TEXTURES]; /* NULL if not registered */
+
+static prefetchimage_t prefetch_images[MAX_PREFETCH_IMAGES];
+static int prefetch_numimages;
+
+static unsigned
+R_ImageHashName(const char *name)
+{
+	unsigned hash;
+
+	hash = 2166136261u;
+
+	for ( ; *name; name++)
+	{
+		hash = (hash ^ (byte)*name) * 16777619u;
+	}
+
+	return hash;
+}
+
+void
+R_ImageHashClear(void)
+{
+	memset(image_hash, 0, sizeof(image_hash));
+	memset(image_names, 0, sizeof(image_names));
+}
+
+/*
+ * Registers the image at index of the renderers image array,
+ * name must be the name stored in the image itself.
+ */
+void
+R_ImageHashAdd(const char *name, int index)
+{
+	unsigned hash;
+	int bucket;
+
+	if ((index < 0) || (index >= MAX_TEXTURES))
+	{
+		Com_Error(ERR_DROP, "%s: bad index %d", __func__, index);
+		return;
+	}
+
+	R_ImageHashRemove(index);
+
+	hash = R_ImageHashName(name);
+	bucket = hash & (IMAGE_HASH_SIZE - 1);
+
+	image_hashes[index] = hash;
+	image_names[index] = name;
+	image_next[index] = image_hash[bucket];
+	image_hash[bucket] = index + 1;
+}
+
+/*
+ * Has to be called before the image at index is cleared.
+ */
+void
+R_ImageHashRemove(int index)
+{
+	int *link;
+
+	if ((index < 0) || (index >= MAX_TEXTURES) || !image_names[index])
+	{
+		return;
+	}
+
+	link = &image_hash[image_hashes[index] & (IMAGE_HASH_SIZE - 1)];
+
+	while (*link)
+	{
+		if (*link == index + 1)
+		{
+			*link = image_next[index];
+			break;
+		}
+
+		link = &image_next[*link - 1];
+	}
+
+	image_names[index] = NULL;
+}
+
+/*
+ * Returns the index of the image or -1.
+ */
+int
+R_ImageHashFind(const char *name)
+{
+	unsigned hash;
+	int i;
+
+	hash = R_ImageHashName(name);
+
+	for (i = image_hash[hash & (IMAGE_HASH_SIZE - 1)]; i; i = image_next[i - 1])
+	{
+		if ((image_hashes[i - 1] == hash) && !strcmp(image_names[i - 1], name))
+		{
+			return i - 1;
+		}
+	}
+
+	return -1;
+}
+
+void
+R_FreePrefetchedImages(void)
+{
+	int i;
+
+	for (i = 0; i < prefetch_numimages; i++)
+	{
+		if (prefetch_images[i].pic)
+		{
+			free(prefetch_images[i].pic);
+		}
+	}
+
+	prefetch_numimages = 0;
+}
+
+/*
+ * Decodes the retextured replacements of up to MAX_PREFETCH_IMAGES
+ * images on the worker threads. Images that are loaded already or
+ * have no replacement are skipped. What isn't taken is freed by the
+ * next call or R_FreePrefetchedImages().
+ */
+void
+R_PrefetchImages(const char **names, int count)
+{
+	static const char *exts[] = { "tga", "png", "jpg" };
+
+	char filenames[MAX_PREFETCH_IMAGES][MAX_QPATH];
+	const char *files[MAX_PREFETCH_IMAGES];
+	byte *pics[MAX_PREFETCH_IMAGES];
+	int widths[MAX_PREFETCH_IMAGES], heights[MAX_PREFETCH_IMAGES];
+	int i, j;
+
+	R_FreePrefetchedImages();
+
+	if (!r_retexturing->value)
+	{
+		return;
+	}
+
+	count = Q_min(count, MAX_PREFETCH_IMAGES);
+
+	for (i = 0; i < count; i++)
+	{
+		prefetchimage_t *image;
+		const char *ext;
+		size_t len;
+
+		if (R_ImageHashFind(names[i]) >= 0)
+		{
+			continue;
+		}
+
+		ext = COM_FileExtension(names[i]);
+		len = (ext - names[i]) - 1;
+
+		if (!ext[0] || (len < 1) || (len >= MAX_QPATH))
+		{
+			continue;
+		}
+
+		image = &prefetch_images[prefetch_numimages];
+		memcpy(image->namewe, names[i], len);
+		image->namewe[len] = 0;
+
+		/* surfaces share their textures */
+		for (j = 0; j < prefetch_numimages; j++)
+		{
+			if (!strcmp(prefetch_images[j].namewe, image->namewe))
+			{
+				break;
+			}
+		}
+
+		if (j < prefetch_numimages)
+		{
+			continue;
+		}
+
+		/* same order as LoadHiColorImage() */
+		for (j = 0; j < ARRLEN(exts); j++)
+		{
+			FixFileExt(image->namewe, exts[j], filenames[prefetch_numimages],
+				MAX_QPATH);
+
+			if (ri.FS_LoadFile(filenames[prefetch_numimages], NULL) > 0)
+			{
+				break;
+			}
+		}
+
+		if (j == ARRLEN(exts))
+		{
+			continue;
+		}
+
+		files[prefetch_numimages] = filenames[prefetch_numimages];
+		image->pic = NULL;
+		prefetch_numimages++;
+	}
+
+	if (!prefetch_numimages)
+	{
+		return;
+	}
+
+	ri.VID_ImagesDecode(prefetch_numimages, files, pics, widths, heights);
+
+	for (i = 0; i < prefetch_numimages; i++)
+	{
+		prefetch_images[i].pic = pics[i];
+		prefetch_images[i].width = widths[i];
+		prefetch_images[i].height = heights[i];
+	}
+}
+
+/*
+ * Hands over the decoded replacement of namewe,
+ * the caller has to free() it.
+ */
+qboolean
+R_TakePrefetchedImage(const char *namewe, byte **pic, int *width, int *height)
+{
+	int i;
+
+	for (i = 0; i < prefetch_numimages; i++)
+	{
+		prefetchimage_t *image = &prefetch_images[i];
+
+		if (image->pic && !strcmp(image->namewe, namewe))
+		{
+			*pic = image->pic;
+			*width = image->width;
+			*height = image->height;
+			image->pic = NULL;
+
+			return true;
+		}
+	}
+
+	return false;
+}
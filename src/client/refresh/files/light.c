@@ -26,9 +26,108 @@
 
 #include "../ref_shared.h"
 
+/*
+ * The styles of a lightmap are added four texels at a time,
+ * twelve floats in three registers. SSE2 and NEON are part of
+ * every x86_64 and aarch64 CPU, the scalar code does the same
+ * multiplies and adds in the same order.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+#define LIGHT_SIMD
+
+typedef __m128 lightvec_t;
+
+#define LightVec_Load(p) _mm_loadu_ps(p)
+#define LightVec_Store(p, a) _mm_storeu_ps(p, a)
+#define LightVec_Set(a, b, c, d) _mm_setr_ps(a, b, c, d)
+#define LightVec_Add(a, b) _mm_add_ps(a, b)
+#define LightVec_Mul(a, b) _mm_mul_ps(a, b)
+
+/* converts 12 bytes without reading past them */
+static inline void
+LightVec_LoadBytes(const byte *p, lightvec_t *v)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i lo, hi;
+	int last;
+
+	memcpy(&last, p + 8, sizeof(last));
+	lo = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), zero);
+	hi = _mm_unpacklo_epi8(_mm_cvtsi32_si128(last), zero);
+
+	v[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+	v[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+	v[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+}
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+
+#define LIGHT_SIMD
+
+typedef float32x4_t lightvec_t;
+
+static inline lightvec_t
+LightVec_Set(float a, float b, float c, float d)
+{
+	const float v[4] = { a, b, c, d };
+
+	return vld1q_f32(v);
+}
+
+#define LightVec_Load(p) vld1q_f32(p)
+#define LightVec_Store(p, a) vst1q_f32(p, a)
+/* no vmlaq_f32(), it may be fused and round differently */
+#define LightVec_Add(a, b) vaddq_f32(a, b)
+#define LightVec_Mul(a, b) vmulq_f32(a, b)
+
+/* converts 12 bytes without reading past them */
+static inline void
+LightVec_LoadBytes(const byte *p, lightvec_t *v)
+{
+	uint16x8_t lo, hi;
+	uint32_t last;
+
+	memcpy(&last, p + 8, sizeof(last));
+	lo = vmovl_u8(vld1_u8(p));
+	hi = vmovl_u8(vcreate_u8(last));
+
+	v[0] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo)));
+	v[1] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo)));
+	v[2] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi)));
+}
+#endif
+
+/* float buffer a thread combines the styles of a lightmap in */
+typedef struct
+{
+	float *lights;
+	size_t size;
+} lmscratch_t;
+
+/* surface waiting in the queue of R_BuildQueuedLightMaps() */
+typedef struct
+{
+	const msurface_t *surf;
+	byte *dest;
+	int stride;
+} lmbuild_t;
+
+typedef struct
+{
+	const refdef_t *refdef;
+	float modulate;
+	const byte *gammatable;
+	const byte *minlight;
+} lmjob_t;
+
 int r_framecount = 1; /* used for dlight push checking */
-static float *s_blocklights = NULL, *s_blocklights_max = NULL;
+static lmscratch_t *s_blocklights = NULL; /* one per worker thread */
+static int s_numblocklights = 0;
 static byte *s_bufferlights = NULL, *s_bufferlights_max = NULL;
+static lmbuild_t *s_lmqueue = NULL;
+static int s_lmqueuesize = 0, s_lmqueuemax = 0;
 
 
 static int
@@ -550,25 +649,39 @@ R_AddDynamicLights(const msurface_t *surf, const refdef_t *r_newrefdef,
 void
 R_InitTemporaryLMBuffer(void)
 {
-	/* buffer for generate light maps */
+	/* buffers for generate light maps */
 	s_blocklights = NULL;
-	s_blocklights_max = NULL;
+	s_numblocklights = 0;
 	/* buffer for temporary copy light maps */
 	s_bufferlights = NULL;
 	s_bufferlights_max = NULL;
+	/* surfaces to build */
+	s_lmqueue = NULL;
+	s_lmqueuesize = 0;
+	s_lmqueuemax = 0;
 }
 
 void
 R_FreeTemporaryLMBuffer(void)
 {
+	int i;
+
 	/* Cleanup buffers */
+	for (i = 0; i < s_numblocklights; i++)
+	{
+		if (s_blocklights[i].lights)
+		{
+			free(s_blocklights[i].lights);
+		}
+	}
+
 	if (s_blocklights)
 	{
 		free(s_blocklights);
 	}
 
 	s_blocklights = NULL;
-	s_blocklights_max = NULL;
+	s_numblocklights = 0;
 
 	/* Cleanup temp buffers */
 	if (s_bufferlights)
@@ -578,32 +691,70 @@ R_FreeTemporaryLMBuffer(void)
 
 	s_bufferlights = NULL;
 	s_bufferlights_max = NULL;
+
+	if (s_lmqueue)
+	{
+		free(s_lmqueue);
+	}
+
+	s_lmqueue = NULL;
+	s_lmqueuesize = 0;
+	s_lmqueuemax = 0;
 }
 
+/*
+ * Makes sure there are count scratch buffers,
+ * each at least size floats large.
+ */
 static void
-R_ResizeTemporaryLMBuffer(size_t size)
+R_ResizeTemporaryLMBuffer(int count, size_t size)
 {
-	if (!s_blocklights || ((s_blocklights + size) >= s_blocklights_max))
+	int i;
+
+	if (count > s_numblocklights)
 	{
-		int new_size = ROUNDUP(size, 1024);
+		lmscratch_t *ptr;
 
-		if (new_size < 4096)
+		ptr = realloc(s_blocklights, count * sizeof(lmscratch_t));
+		YQ2_COM_CHECK_OOM(ptr, "realloc()", count * sizeof(lmscratch_t))
+		if (!ptr)
 		{
-			new_size = 4096;
+			return;
 		}
 
-		if (s_blocklights)
-		{
-			free(s_blocklights);
-		}
+		memset(ptr + s_numblocklights, 0,
+			(count - s_numblocklights) * sizeof(lmscratch_t));
+		s_blocklights = ptr;
+		s_numblocklights = count;
+	}
 
-		s_blocklights = malloc(new_size * sizeof(float));
-		s_blocklights_max = s_blocklights + new_size;
+	for (i = 0; i < count; i++)
+	{
+		lmscratch_t *scratch = &s_blocklights[i];
 
-		if (!s_blocklights)
+		if (!scratch->lights || (size >= scratch->size))
 		{
-			Com_Error(ERR_DROP, "Can't alloc s_blocklights");
-			return;
+			int new_size = ROUNDUP(size, 1024);
+
+			if (new_size < 4096)
+			{
+				new_size = 4096;
+			}
+
+			if (scratch->lights)
+			{
+				free(scratch->lights);
+			}
+
+			scratch->lights = malloc(new_size * sizeof(float));
+			scratch->size = new_size;
+
+			if (!scratch->lights)
+			{
+				scratch->size = 0;
+				Com_Error(ERR_DROP, "Can't alloc s_blocklights");
+				return;
+			}
 		}
 	}
 }
@@ -641,15 +792,13 @@ R_GetTemporaryLMBuffer(size_t size)
 }
 
 static void
-R_StoreLightMap(byte *dest, int stride, int smax, int tmax, const byte *gammatable,
-	const byte *minlight)
+R_StoreLightMap(const float *bl, byte *dest, int stride, int smax, int tmax,
+	const byte *gammatable, const byte *minlight)
 {
-	float *bl;
 	int i;
 
 	/* put into texture format */
 	stride -= (smax << 2);
-	bl = s_blocklights;
 
 	for (i = 0; i < tmax; i++, dest += stride)
 	{
@@ -741,159 +890,238 @@ R_StoreLightMap(byte *dest, int stride, int smax, int tmax, const byte *gammatab
 }
 
 /*
- * Combine and scale multiple lightmaps into the floating format in blocklights
+ * Scales the size texels of one light style and adds them to
+ * blocklights, the first style is stored instead of added.
  */
-void
-R_BuildLightMap(const msurface_t *surf, byte *dest, int stride, const refdef_t *r_newrefdef,
-	float modulate, const byte *gammatable, const byte *minlight)
+static void
+R_AddLightStyle(float *bl, const byte *lightmap, int size,
+	const vec3_t scale, qboolean add)
 {
-	int smax, tmax;
-	int size, numlightmaps;
-	const byte *lightmap;
-	const float *max_light;
+	int i = 0;
+
+#ifdef LIGHT_SIMD
+	const lightvec_t s0 = LightVec_Set(scale[0], scale[1], scale[2], scale[0]);
+	const lightvec_t s1 = LightVec_Set(scale[1], scale[2], scale[0], scale[1]);
+	const lightvec_t s2 = LightVec_Set(scale[2], scale[0], scale[1], scale[2]);
+
+	for (; i + 4 <= size; i += 4, bl += 12, lightmap += 12)
+	{
+		lightvec_t v[3];
+
+		LightVec_LoadBytes(lightmap, v);
+
+		v[0] = LightVec_Mul(v[0], s0);
+		v[1] = LightVec_Mul(v[1], s1);
+		v[2] = LightVec_Mul(v[2], s2);
 
+		if (add)
+		{
+			v[0] = LightVec_Add(LightVec_Load(bl), v[0]);
+			v[1] = LightVec_Add(LightVec_Load(bl + 4), v[1]);
+			v[2] = LightVec_Add(LightVec_Load(bl + 8), v[2]);
+		}
+
+		LightVec_Store(bl, v[0]);
+		LightVec_Store(bl + 4, v[1]);
+		LightVec_Store(bl + 8, v[2]);
+	}
+#endif
+
+	for (; i < size; i++, bl += 3, lightmap += 3)
+	{
+		int j;
+
+		for (j = 0; j < 3; j++)
+		{
+			if (add)
+			{
+				bl[j] += lightmap[j] * scale[j];
+			}
+			else
+			{
+				bl[j] = lightmap[j] * scale[j];
+			}
+		}
+	}
+}
+
+static void
+R_CheckLightMap(const msurface_t *surf, const char *caller)
+{
 	if (surf->texinfo->flags &
 		(SURF_SKY | SURF_TRANSPARENT | SURF_WARP))
 	{
-		Com_Error(ERR_DROP, "%s called for non-lit surface", __func__);
-		return;
+		Com_Error(ERR_DROP, "%s called for non-lit surface", caller);
 	}
+}
+
+/*
+ * Combine and scale multiple lightmaps into the floating format
+ * in blocklights. Doesn't touch any global state, so the workers
+ * can run it with a scratch buffer each.
+ */
+static void
+R_CombineLightMap(const msurface_t *surf, byte *dest, int stride,
+	const refdef_t *r_newrefdef, float modulate, const byte *gammatable,
+	const byte *minlight, float *blocklights)
+{
+	int smax, tmax;
+	int size, maps;
+	const byte *lightmap;
 
 	smax = (surf->extents[0] >> surf->lmshift) + 1;
 	tmax = (surf->extents[1] >> surf->lmshift) + 1;
 	size = smax * tmax;
 
-	R_ResizeTemporaryLMBuffer(size * 3);
-
-	max_light = s_blocklights + size * 3;
-
 	/* set to full bright if no light data */
 	if (!surf->samples)
 	{
-		float *curr_light;
-
-		curr_light = s_blocklights;
+		int i;
 
-		do
+		for (i = 0; i < size * 3; i++)
 		{
-			*curr_light = 255;
-			curr_light++;
+			blocklights[i] = 255;
 		}
-		while(curr_light < max_light);
 
-		R_StoreLightMap(dest, stride, smax, tmax, gammatable, minlight);
+		R_StoreLightMap(blocklights, dest, stride, smax, tmax, gammatable,
+			minlight);
 		return;
 	}
 
-	/* count the # of maps */
-	for (numlightmaps = 0; numlightmaps < MAXLIGHTMAPS && surf->styles[numlightmaps] != 255;
-		 numlightmaps++)
-	{
-	}
-
 	lightmap = surf->samples;
 
 	/* add all the lightmaps */
-	if (numlightmaps == 1)
+	for (maps = 0; maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++)
 	{
-		int maps;
+		vec3_t scale;
+		int i;
 
-		for (maps = 0; maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++)
+		for (i = 0; i < 3; i++)
 		{
-			float *curr_light;
-			vec3_t scale;
-			int i;
-
-			curr_light = s_blocklights;
+			scale[i] = modulate *
+					   r_newrefdef->lightstyles[surf->styles[maps]].rgb[i];
+		}
 
-			for (i = 0; i < 3; i++)
-			{
-				scale[i] = modulate *
-						   r_newrefdef->lightstyles[surf->styles[maps]].rgb[i];
-			}
+		R_AddLightStyle(blocklights, lightmap, size, scale, maps > 0);
+		lightmap += size * 3;
+	}
 
-			if ((scale[0] == 1.0F) &&
-				(scale[1] == 1.0F) &&
-				(scale[2] == 1.0F))
-			{
-				do
-				{
-					*curr_light = *lightmap;
-					curr_light++;
-					lightmap++;
-				}
-				while(curr_light < max_light);
-			}
-			else
-			{
-				do
-				{
-					for (i = 0; i < 3; i++)
-					{
-						*curr_light = *lightmap * scale[i];
-						curr_light++;
-						lightmap++;
-					}
-				}
-				while(curr_light < max_light);
-			}
-		}
+	if (!maps)
+	{
+		memset(blocklights, 0, sizeof(blocklights[0]) * size * 3);
 	}
-	else
+
+	/* add all the dynamic lights */
+	if (surf->dlightframe == r_framecount)
 	{
-		int maps;
+		R_AddDynamicLights(surf, r_newrefdef, blocklights);
+	}
 
-		memset(s_blocklights, 0, sizeof(s_blocklights[0]) * size * 3);
+	R_StoreLightMap(blocklights, dest, stride, smax, tmax, gammatable,
+		minlight);
+}
 
-		for (maps = 0; maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++)
-		{
-			float *curr_light;
-			vec3_t scale;
-			int i;
+void
+R_BuildLightMap(const msurface_t *surf, byte *dest, int stride, const refdef_t *r_newrefdef,
+	float modulate, const byte *gammatable, const byte *minlight)
+{
+	int smax, tmax;
 
-			curr_light = s_blocklights;
+	R_CheckLightMap(surf, __func__);
 
-			for (i = 0; i < 3; i++)
-			{
-				scale[i] = modulate *
-						   r_newrefdef->lightstyles[surf->styles[maps]].rgb[i];
-			}
+	smax = (surf->extents[0] >> surf->lmshift) + 1;
+	tmax = (surf->extents[1] >> surf->lmshift) + 1;
 
-			if ((scale[0] == 1.0F) &&
-				(scale[1] == 1.0F) &&
-				(scale[2] == 1.0F))
-			{
-				do
-				{
-					*curr_light += *lightmap;
-					curr_light++;
-					lightmap++;
-				}
-				while(curr_light < max_light);
-			}
-			else
-			{
-				do
-				{
-					for (i = 0; i < 3; i++)
-					{
-						*curr_light += *lightmap * scale[i];
-						curr_light++;
-						lightmap++;
-					}
-				}
-				while(curr_light < max_light);
-			}
+	R_ResizeTemporaryLMBuffer(1, smax * tmax * 3);
+
+	R_CombineLightMap(surf, dest, stride, r_newrefdef, modulate, gammatable,
+		minlight, s_blocklights[0].lights);
+}
+
+/*
+ * Queues a lightmap for R_BuildQueuedLightMaps(), dest must
+ * stay valid until then and not overlap other lightmaps.
+ */
+void
+R_QueueLightMap(const msurface_t *surf, byte *dest, int stride)
+{
+	if (s_lmqueuesize == s_lmqueuemax)
+	{
+		lmbuild_t *ptr;
+		int max;
+
+		max = s_lmqueuemax ? s_lmqueuemax * 2 : 256;
+		ptr = realloc(s_lmqueue, max * sizeof(lmbuild_t));
+		YQ2_COM_CHECK_OOM(ptr, "realloc()", max * sizeof(lmbuild_t))
+		if (!ptr)
+		{
+			return;
 		}
+
+		s_lmqueue = ptr;
+		s_lmqueuemax = max;
 	}
 
-	/* add all the dynamic lights */
-	if (surf->dlightframe == r_framecount)
+	s_lmqueue[s_lmqueuesize].surf = surf;
+	s_lmqueue[s_lmqueuesize].dest = dest;
+	s_lmqueue[s_lmqueuesize].stride = stride;
+	s_lmqueuesize++;
+}
+
+static void
+R_BuildLightMapJob(void *data, int index, int worker)
+{
+	const lmjob_t *job = data;
+	const lmbuild_t *build = &s_lmqueue[index];
+
+	R_CombineLightMap(build->surf, build->dest, build->stride, job->refdef,
+		job->modulate, job->gammatable, job->minlight,
+		s_blocklights[worker].lights);
+}
+
+/*
+ * Builds the queued lightmaps on the worker threads, the
+ * surfaces are checked and the buffers allocated up front
+ * so that nothing can fail inside the job.
+ */
+void
+R_BuildQueuedLightMaps(const refdef_t *r_newrefdef, float modulate,
+	const byte *gammatable, const byte *minlight)
+{
+	size_t maxsize;
+	lmjob_t job;
+	int i;
+
+	if (!s_lmqueuesize)
+	{
+		return;
+	}
+
+	maxsize = 0;
+
+	for (i = 0; i < s_lmqueuesize; i++)
 	{
-		R_AddDynamicLights(surf, r_newrefdef, s_blocklights);
+		const msurface_t *surf = s_lmqueue[i].surf;
+		size_t size;
+
+		R_CheckLightMap(surf, __func__);
+
+		size = ((surf->extents[0] >> surf->lmshift) + 1) *
+			((surf->extents[1] >> surf->lmshift) + 1) * 3;
+		maxsize = Q_max(maxsize, size);
 	}
 
-	R_StoreLightMap(dest, stride, smax, tmax, gammatable, minlight);
+	R_ResizeTemporaryLMBuffer((s_lmqueuesize > 1) ? ri.Sys_NumWorkers() : 1,
+		maxsize);
+
+	job.refdef = r_newrefdef;
+	job.modulate = modulate;
+	job.gammatable = gammatable;
+	job.minlight = minlight;
+
+	ri.Sys_ParallelFor(s_lmqueuesize, R_BuildLightMapJob, &job);
+
+	s_lmqueuesize = 0;
 }
 
 static void
@@ -382,6 +382,35 @@ Mod_CalcSurfaceExtents(const int *surfedges, int numsurfedges, mvertex_t *vertex
 	}
 }
 
+/*
+ * Decodes the retextured replacements of the next
+ * MAX_PREFETCH_IMAGES texinfos on the worker threads.
+ */
+static void
+Mod_PrefetchTexinfo(const xtexinfo_t *in, int count)
+{
+	char pathnames[MAX_PREFETCH_IMAGES][MAX_QPATH];
+	const char *names[MAX_PREFETCH_IMAGES];
+	int i;
+
+	count = Q_min(count, MAX_PREFETCH_IMAGES);
+
+	for (i = 0; i < count; i++, in++)
+	{
+		char imagename[sizeof(in->texture) + 1];
+
+		memcpy(imagename, in->texture, sizeof(in->texture));
+		imagename[sizeof(in->texture)] = 0;
+
+		/* same name as GetTexImage() tries first */
+		Com_sprintf(pathnames[i], sizeof(pathnames[i]), "textures/%s.wal",
+			imagename);
+		names[i] = pathnames[i];
+	}
+
+	R_PrefetchImages(names, count);
+}
+
 static void
 Mod_LoadTexinfoQ2(const char *name, mtexinfo_t **texinfo, int *numtexinfo,
 	const byte *mod_base, const lump_t *l, findimage_t find_image,
@@ -413,6 +442,11 @@ Mod_LoadTexinfoQ2(const char *name, mtexinfo_t **texinfo, int *numtexinfo,
 		int j, next;
 		char imagename[sizeof(in->texture) + 1];
 
+		if (!(i % MAX_PREFETCH_IMAGES))
+		{
+			Mod_PrefetchTexinfo(in, count - i);
+		}
+
 		for (j = 0; j < 4; j++)
 		{
 			out->vecs[0][j] = in->vecs[0][j];
@@ -448,6 +482,8 @@ Mod_LoadTexinfoQ2(const char *name, mtexinfo_t **texinfo, int *numtexinfo,
 
 		out->image = image;
 	}
+
+	R_FreePrefetchedImages();
 }
 
 /*
@@ -24,15 +24,66 @@
  * =======================================================================
  */
 
+#include <time.h>
+
 #include "../ref_shared.h"
 #include "../../../common/models/mesh.h"
 
+/*
+ * SSE2 is part of every x86_64 CPU and NEON of every
+ * aarch64 one, so the vector paths are chosen at compile
+ * time. Each vertex sits in one register with its x, y, z
+ * in the lanes of the vec4_t it's written to. The lanes do
+ * the same multiplies and adds in the same order as the
+ * scalar code, which gives bit identical results.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+#define MESH_SIMD "SSE2"
+
+typedef __m128 meshvec_t;
+
+#define MeshVec_Load(p) _mm_loadu_ps(p)
+#define MeshVec_Store(p, a) _mm_storeu_ps(p, a)
+#define MeshVec_Set1(f) _mm_set1_ps(f)
+#define MeshVec_Set3(x, y, z) _mm_setr_ps(x, y, z, 0.0f)
+#define MeshVec_Add(a, b) _mm_add_ps(a, b)
+#define MeshVec_Mul(a, b) _mm_mul_ps(a, b)
+/* the fourth short is the first two normal bytes, it gets multiplied by 0 */
+#define MeshVec_LoadShorts(p) _mm_cvtepi32_ps(_mm_unpacklo_epi16( \
+	_mm_loadl_epi64((const __m128i *)(p)), _mm_setzero_si128()))
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+
+#define MESH_SIMD "NEON"
+
+typedef float32x4_t meshvec_t;
+
+static inline meshvec_t
+MeshVec_Set3(float x, float y, float z)
+{
+	const float v[4] = { x, y, z, 0.0f };
+
+	return vld1q_f32(v);
+}
+
+#define MeshVec_Load(p) vld1q_f32(p)
+#define MeshVec_Store(p, a) vst1q_f32(p, a)
+#define MeshVec_Set1(f) vdupq_n_f32(f)
+/* no vmlaq_f32(), it may be fused and round differently */
+#define MeshVec_Add(a, b) vaddq_f32(a, b)
+#define MeshVec_Mul(a, b) vmulq_f32(a, b)
+#define MeshVec_LoadShorts(p) vcvtq_f32_u32(vmovl_u16(vld1_u16(p)))
+#endif
+
 #define MAX_BONES 64
 
+/* Rotation columns and position of a bone, w is always 0 */
 typedef struct
 {
-	float rot[9];
-	vec3_t pos;
+	vec4_t axis[3];
+	vec4_t pos;
 } skeletal_bone_t;
 
 static vec4_t *lerpbuff = NULL;
@@ -165,6 +216,46 @@ R_StaticVerts(qboolean powerUpEffect, int nverts,
 	}
 }
 
+#ifdef MESH_SIMD
+static void
+R_StaticVertsSIMD(qboolean powerUpEffect, int nverts,
+		const dxtrivertx_t *v, const dxtrivertx_t *ov,
+		float *lerp, const float move[3],
+		const float frontv[3], const float backv[3], const float *scale)
+{
+	meshvec_t vmove, vfront, vback, vscale;
+	int i;
+
+	vmove = MeshVec_Set3(move[0], move[1], move[2]);
+	vfront = MeshVec_Set3(frontv[0], frontv[1], frontv[2]);
+	vback = MeshVec_Set3(backv[0], backv[1], backv[2]);
+	vscale = MeshVec_Set3(scale[0], scale[1], scale[2]);
+
+	for (i = 0; i < nverts; i++, v++, ov++, lerp += 4)
+	{
+		meshvec_t p;
+
+		p = MeshVec_Add(vmove, MeshVec_Mul(MeshVec_LoadShorts(ov->v), vback));
+		p = MeshVec_Add(p, MeshVec_Mul(MeshVec_LoadShorts(v->v), vfront));
+		p = MeshVec_Mul(vscale, p);
+
+		if (powerUpEffect)
+		{
+			meshvec_t normal;
+
+			normal = MeshVec_Set3(
+				r_byteNormalScale[(unsigned char)v->normal[0]],
+				r_byteNormalScale[(unsigned char)v->normal[1]],
+				r_byteNormalScale[(unsigned char)v->normal[2]]);
+			p = MeshVec_Add(p, MeshVec_Mul(normal,
+				MeshVec_Set1(POWERSUIT_SCALE)));
+		}
+
+		MeshVec_Store(lerp, p);
+	}
+}
+#endif
+
 /* quaternion slerp for bone interpolation; assumes unit quaternions */
 static void
 BoneSlerp(const vec4_t qa, const vec4_t qb, float t, vec4_t out)
@@ -210,15 +301,16 @@ BoneSlerp(const vec4_t qa, const vec4_t qb, float t, vec4_t out)
 	}
 }
 
-static void
-R_SkeletalVerts(const dmdx_t *pheader, int frame, int oldframe, float frontlerp,
-	float backlerp, float *lerp, const float move[3], const float *scale)
+/*
+ * Lerps and slerps each bone and builds its world-space matrix.
+ */
+static const skeletal_bone_t *
+R_SkeletalBones(const dmdx_t *pheader, int frame, int oldframe,
+	float frontlerp, float backlerp)
 {
 	const dmdx_baseframe_joint_t *poses, *old_poses;
-	int num_joints, num_verts, num_weights, i;
-	const dmdx_vertex_t *mesh_verteces;
-	const dmdx_weight_t *weights;
 	skeletal_bone_t *bonematrix;
+	int i;
 
 	bonematrix = R_BonesBufferRealloc(pheader->num_joints);
 
@@ -226,16 +318,11 @@ R_SkeletalVerts(const dmdx_t *pheader, int frame, int oldframe, float frontlerp,
 	        + frame * pheader->num_joints;
 	old_poses = (const dmdx_baseframe_joint_t *)((const byte *)pheader + pheader->ofs_baseframe_joints)
 	           + oldframe * pheader->num_joints;
-	weights = (const dmdx_weight_t *)((const byte *)pheader + pheader->ofs_weights);
-	mesh_verteces = (const dmdx_vertex_t *)((const byte *)pheader + pheader->ofs_mesh_verteces);
-	num_joints = pheader->num_joints;
-	num_weights = pheader->num_weights;
-	num_verts = pheader->num_xyz;
 
-	/* lerp/slerp each bone and build its world-space matrix */
-	for (i = 0; i < num_joints; i++)
+	for (i = 0; i < pheader->num_joints; i++)
 	{
 		vec4_t lorient;
+		float rot[9];
 		int n;
 
 		for (n = 0; n < 3; n++)
@@ -246,9 +333,36 @@ R_SkeletalVerts(const dmdx_t *pheader, int frame, int oldframe, float frontlerp,
 
 		BoneSlerp(old_poses[i].orient, poses[i].orient, frontlerp, lorient);
 		Quat_normalize(lorient);
-		Quat_toMat3(lorient, bonematrix[i].rot);
+		Quat_toMat3(lorient, rot);
+
+		for (n = 0; n < 3; n++)
+		{
+			bonematrix[i].axis[n][0] = rot[n];
+			bonematrix[i].axis[n][1] = rot[3 + n];
+			bonematrix[i].axis[n][2] = rot[6 + n];
+			bonematrix[i].axis[n][3] = 0.0f;
+		}
+
+		bonematrix[i].pos[3] = 0.0f;
 	}
 
+	return bonematrix;
+}
+
+static void
+R_SkeletalVerts(const dmdx_t *pheader, const skeletal_bone_t *bonematrix,
+	float *lerp, const float move[3], const float *scale)
+{
+	int num_joints, num_verts, num_weights, i;
+	const dmdx_vertex_t *mesh_verteces;
+	const dmdx_weight_t *weights;
+
+	weights = (const dmdx_weight_t *)((const byte *)pheader + pheader->ofs_weights);
+	mesh_verteces = (const dmdx_vertex_t *)((const byte *)pheader + pheader->ofs_mesh_verteces);
+	num_joints = pheader->num_joints;
+	num_weights = pheader->num_weights;
+	num_verts = pheader->num_xyz;
+
 	/* skin each vertex */
 	for (i = 0; i < num_verts; i++, lerp += 4)
 	{
@@ -265,7 +379,8 @@ R_SkeletalVerts(const dmdx_t *pheader, int frame, int oldframe, float frontlerp,
 		{
 			const dmdx_weight_t *weight;
 			const skeletal_bone_t *joint;
-			const float *j_rot, *w_pos;
+			const float *w_pos;
+			int n;
 
 			weight = &weights[bind->start + k];
 
@@ -275,13 +390,15 @@ R_SkeletalVerts(const dmdx_t *pheader, int frame, int oldframe, float frontlerp,
 			}
 
 			joint = bonematrix + weight->joint;
-			j_rot = joint->rot;
 			w_pos = weight->pos;
 
 			/* The sum of all weight->bias should be 1.0 */
-			result[0] += (joint->pos[0] + j_rot[0] * w_pos[0] + j_rot[1] * w_pos[1] + j_rot[2] * w_pos[2]) * weight->bias;
-			result[1] += (joint->pos[1] + j_rot[3] * w_pos[0] + j_rot[4] * w_pos[1] + j_rot[5] * w_pos[2]) * weight->bias;
-			result[2] += (joint->pos[2] + j_rot[6] * w_pos[0] + j_rot[7] * w_pos[1] + j_rot[8] * w_pos[2]) * weight->bias;
+			for (n = 0; n < 3; n++)
+			{
+				result[n] += (joint->pos[n] + joint->axis[0][n] * w_pos[0] +
+					joint->axis[1][n] * w_pos[1] + joint->axis[2][n] * w_pos[2]) *
+					weight->bias;
+			}
 		}
 
 		lerp[0] = scale[0] * (result[0] + move[0]);
@@ -290,6 +407,67 @@ R_SkeletalVerts(const dmdx_t *pheader, int frame, int oldframe, float frontlerp,
 	}
 }
 
+#ifdef MESH_SIMD
+static void
+R_SkeletalVertsSIMD(const dmdx_t *pheader, const skeletal_bone_t *bonematrix,
+	float *lerp, const float move[3], const float *scale)
+{
+	int num_joints, num_verts, num_weights, i;
+	const dmdx_vertex_t *mesh_verteces;
+	const dmdx_weight_t *weights;
+	meshvec_t vmove, vscale;
+
+	weights = (const dmdx_weight_t *)((const byte *)pheader + pheader->ofs_weights);
+	mesh_verteces = (const dmdx_vertex_t *)((const byte *)pheader + pheader->ofs_mesh_verteces);
+	num_joints = pheader->num_joints;
+	num_weights = pheader->num_weights;
+	num_verts = pheader->num_xyz;
+
+	vmove = MeshVec_Set3(move[0], move[1], move[2]);
+	vscale = MeshVec_Set3(scale[0], scale[1], scale[2]);
+
+	for (i = 0; i < num_verts; i++, lerp += 4)
+	{
+		const dmdx_vertex_t *bind = &mesh_verteces[i];
+		meshvec_t result;
+		int k, count = bind->count;
+
+		if (bind->start < 0 || count < 0 || bind->start > num_weights - count)
+		{
+			count = 0;
+		}
+
+		result = MeshVec_Set1(0.0f);
+
+		for (k = 0; k < count; k++)
+		{
+			const dmdx_weight_t *weight;
+			const skeletal_bone_t *joint;
+			meshvec_t p;
+
+			weight = &weights[bind->start + k];
+
+			if (weight->joint < 0 || weight->joint >= num_joints)
+			{
+				break;
+			}
+
+			joint = bonematrix + weight->joint;
+
+			p = MeshVec_Add(MeshVec_Load(joint->pos),
+				MeshVec_Mul(MeshVec_Load(joint->axis[0]), MeshVec_Set1(weight->pos[0])));
+			p = MeshVec_Add(p,
+				MeshVec_Mul(MeshVec_Load(joint->axis[1]), MeshVec_Set1(weight->pos[1])));
+			p = MeshVec_Add(p,
+				MeshVec_Mul(MeshVec_Load(joint->axis[2]), MeshVec_Set1(weight->pos[2])));
+			result = MeshVec_Add(result, MeshVec_Mul(p, MeshVec_Set1(weight->bias)));
+		}
+
+		MeshVec_Store(lerp, MeshVec_Mul(vscale, MeshVec_Add(result, vmove)));
+	}
+}
+#endif
+
 void
 R_LerpVerts(const dmdx_t *paliashdr, int frame, int oldframe, float frontlerp,
 	float backlerp, float *lerp, const float base_move[3], const float *scale,
@@ -298,7 +476,14 @@ R_LerpVerts(const dmdx_t *paliashdr, int frame, int oldframe, float frontlerp,
 	if (r_skeletalanimation->value && !colorOnly &&
 		paliashdr->ofs_baseframe_joints != 0 && paliashdr->num_weights > 0)
 	{
-		R_SkeletalVerts(paliashdr, frame, oldframe, frontlerp, backlerp, lerp, base_move, scale);
+		const skeletal_bone_t *bonematrix;
+
+		bonematrix = R_SkeletalBones(paliashdr, frame, oldframe, frontlerp, backlerp);
+#ifdef MESH_SIMD
+		R_SkeletalVertsSIMD(paliashdr, bonematrix, lerp, base_move, scale);
+#else
+		R_SkeletalVerts(paliashdr, bonematrix, lerp, base_move, scale);
+#endif
 	}
 	else
 	{
@@ -322,9 +507,176 @@ R_LerpVerts(const dmdx_t *paliashdr, int frame, int oldframe, float frontlerp,
 			backv[i] = backlerp * oldframep->scale[i];
 		}
 
+#ifdef MESH_SIMD
+		R_StaticVertsSIMD(colorOnly, paliashdr->num_xyz, framep->verts, oldframep->verts, lerp,
+			move, frontv, backv, scale);
+#else
 		R_StaticVerts(colorOnly, paliashdr->num_xyz, framep->verts, oldframep->verts, lerp,
 			move, frontv, backv, scale);
+#endif
+	}
+}
+
+static double
+R_LerpBenchSeconds(clock_t start)
+{
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/*
+ * r_lerpbench <model> [loops]
+ * Times the vertex lerp of all frames of a model, the scalar code
+ * against the vector code and checks that both give the same result.
+ */
+void
+R_LerpBench_f(void)
+{
+	const float move[3] = { 1.0f, -2.0f, 3.0f };
+	const float scale[3] = { 1.0f, 1.0f, 1.0f };
+	int loops, num_frames, i, frame, oldframe;
+	const dmdx_t *pheader;
+	vec4_t *simdbuff;
+	void *buffer;
+	size_t size;
+
+	if ((ri.Cmd_Argc() < 2) || (ri.Cmd_Argc() > 3))
+	{
+		R_Printf(PRINT_ALL, "Usage: r_lerpbench <model> [loops]\n");
+		return;
 	}
+
+	loops = (ri.Cmd_Argc() == 3) ? atoi(ri.Cmd_Argv(2)) : 100;
+	loops = Q_max(loops, 1);
+
+	ri.Mod_LoadFile(ri.Cmd_Argv(1), &buffer);
+
+	if (!buffer)
+	{
+		R_Printf(PRINT_ALL, "%s: Can't load %s\n", __func__, ri.Cmd_Argv(1));
+		return;
+	}
+
+	pheader = buffer;
+
+	if ((LittleLong(pheader->ident) != IDALIASHEADER) ||
+		(pheader->num_frames < 1) || (pheader->num_xyz < 1))
+	{
+		R_Printf(PRINT_ALL, "%s: %s isn't an alias model\n",
+			__func__, ri.Cmd_Argv(1));
+		ri.FS_FreeFile(buffer);
+		return;
+	}
+
+	num_frames = pheader->num_frames;
+	size = pheader->num_xyz * sizeof(vec4_t);
+	R_VertBufferRealloc(pheader->num_xyz);
+	simdbuff = calloc(pheader->num_xyz, sizeof(vec4_t));
+	YQ2_COM_CHECK_OOM(simdbuff, "calloc()", size)
+
+	if (!simdbuff)
+	{
+		ri.FS_FreeFile(buffer);
+		return;
+	}
+
+	R_Printf(PRINT_ALL, "%s: %d verts, %d frames, %d joints, %d loops\n",
+		ri.Cmd_Argv(1), pheader->num_xyz, num_frames, pheader->num_joints,
+		loops);
+
+	/* both static and skeletal models have their frames */
+	for (i = 0; i < 2; i++)
+	{
+		double scalar, vector;
+		qboolean mismatch;
+		int loop;
+		clock_t start;
+
+		if (i && (!pheader->ofs_baseframe_joints || pheader->num_weights <= 0))
+		{
+			break;
+		}
+
+		scalar = vector = 0;
+		mismatch = false;
+
+		for (loop = 0; loop < loops; loop++)
+		{
+			for (frame = 0; frame < num_frames; frame++)
+			{
+				const daliasxframe_t *oldframep, *framep;
+				const skeletal_bone_t *bonematrix;
+				vec3_t frontv, backv, fmove;
+				int n;
+
+				oldframe = (frame + num_frames - 1) % num_frames;
+
+				if (i)
+				{
+					bonematrix = R_SkeletalBones(pheader, frame, oldframe,
+						0.75f, 0.25f);
+
+					start = clock();
+					R_SkeletalVerts(pheader, bonematrix, (float *)lerpbuff,
+						move, scale);
+					scalar += R_LerpBenchSeconds(start);
+#ifdef MESH_SIMD
+					start = clock();
+					R_SkeletalVertsSIMD(pheader, bonematrix, (float *)simdbuff,
+						move, scale);
+					vector += R_LerpBenchSeconds(start);
+#endif
+				}
+				else
+				{
+					framep = (daliasxframe_t *)((byte *)pheader + pheader->ofs_frames
+						+ frame * pheader->framesize);
+					oldframep = (daliasxframe_t *)((byte *)pheader + pheader->ofs_frames
+						+ oldframe * pheader->framesize);
+
+					for (n = 0; n < 3; n++)
+					{
+						fmove[n] = move[n] + 0.25f * oldframep->translate[n] +
+							0.75f * framep->translate[n];
+						frontv[n] = 0.75f * framep->scale[n];
+						backv[n] = 0.25f * oldframep->scale[n];
+					}
+
+					start = clock();
+					R_StaticVerts(loop & 1, pheader->num_xyz, framep->verts,
+						oldframep->verts, (float *)lerpbuff, fmove, frontv,
+						backv, scale);
+					scalar += R_LerpBenchSeconds(start);
+#ifdef MESH_SIMD
+					start = clock();
+					R_StaticVertsSIMD(loop & 1, pheader->num_xyz, framep->verts,
+						oldframep->verts, (float *)simdbuff, fmove, frontv,
+						backv, scale);
+					vector += R_LerpBenchSeconds(start);
+#endif
+				}
+
+#ifdef MESH_SIMD
+				for (n = 0; n < pheader->num_xyz && !mismatch; n++)
+				{
+					mismatch = memcmp(lerpbuff[n], simdbuff[n], sizeof(vec3_t)) != 0;
+				}
+#endif
+			}
+		}
+
+#ifdef MESH_SIMD
+		R_Printf(PRINT_ALL, "%s: scalar %.3f ms, " MESH_SIMD " %.3f ms%s\n",
+			i ? "skeletal" : "static", scalar * 1000.0, vector * 1000.0,
+			mismatch ? ", results differ" : "");
+#else
+		R_Printf(PRINT_ALL, "%s: scalar %.3f ms%s\n",
+			i ? "skeletal" : "static", scalar * 1000.0,
+			mismatch ? ", results differ" : "");
+#endif
+	}
+
+	free(simdbuff);
+	ri.FS_FreeFile(buffer);
 }
 
 void
@@ -575,8 +575,10 @@ LoadHiColorImage(const char *name, const char* namewe, const char *ext,
 		GetSWLInfo(name, &realwidth, &realheight);
 	}
 
-	/* try to load a tga, png or jpg (in that order/priority) */
-	if (  LoadSTB(namewe, "tga", &pic, &width, &height)
+	/* decoded already by R_PrefetchImages(), or try to
+	 * load a tga, png or jpg (in that order/priority) */
+	if (  R_TakePrefetchedImage(namewe, &pic, &width, &height)
+	   || LoadSTB(namewe, "tga", &pic, &width, &height)
 	   || LoadSTB(namewe, "png", &pic, &width, &height)
 	   || LoadSTB(namewe, "jpg", &pic, &width, &height) )
 	{
@@ -879,6 +879,16 @@ R_LoadPic(const char *name, byte *pic, int width, int realwidth,
 	{
 		int i;
 
+		i = R_ImageHashFind(name);
+
+		if (i >= 0)
+		{
+			/* we already have such image */
+			image = &gltextures[i];
+			image->registration_sequence = registration_sequence;
+			return image;
+		}
+
 		/* find a free image_t */
 		for (i = 0, image = gltextures; i < numgltextures; i++, image++)
 		{
@@ -886,13 +896,6 @@ R_LoadPic(const char *name, byte *pic, int width, int realwidth,
 			{
 				break;
 			}
-
-			if (!strcmp(image->name, name))
-			{
-				/* we already have such image */
-				image->registration_sequence = registration_sequence;
-				return image;
-			}
 		}
 
 		if (i == numgltextures)
@@ -917,6 +920,7 @@ R_LoadPic(const char *name, byte *pic, int width, int realwidth,
 	}
 
 	strcpy(image->name, name);
+	R_ImageHashAdd(image->name, image - gltextures);
 	image->registration_sequence = registration_sequence;
 
 	image->width = width;
@@ -1140,13 +1144,13 @@ R_FindImage(const char *originname, imagetype_t type)
 	namewe[len] = 0;
 
 	/* look for it */
-	for (i = 0, image = gltextures; i < numgltextures; i++, image++)
+	i = R_ImageHashFind(name);
+
+	if (i >= 0)
 	{
-		if (!strcmp(name, image->name))
-		{
-			image->registration_sequence = registration_sequence;
-			return image;
-		}
+		image = &gltextures[i];
+		image->registration_sequence = registration_sequence;
+		return image;
 	}
 
 	/*
@@ -1203,6 +1207,7 @@ R_FreeUnusedImages(void)
 
 		/* free it */
 		glDeleteTextures(1, (GLuint *)&image->texnum);
+		R_ImageHashRemove(i);
 		memset(image, 0, sizeof(*image));
 	}
 }
@@ -1336,4 +1341,6 @@ R_ShutdownImages(void)
 		glDeleteTextures(1, (GLuint *)&image->texnum);
 		memset(image, 0, sizeof(*image));
 	}
+
+	R_ImageHashClear();
 }
@@ -1245,6 +1245,7 @@ R_Register(void)
 	ri.Cmd_AddCommand("screenshot", R_ScreenShot);
 	ri.Cmd_AddCommand("modellist", Mod_Modellist_f);
 	ri.Cmd_AddCommand("gl_strings", R_Strings);
+	ri.Cmd_AddCommand("r_lerpbench", R_LerpBench_f);
 }
 
 #undef ONLY_ENABLED_IN_GL1
@@ -1712,6 +1713,7 @@ RI_Shutdown(void)
 	ri.Cmd_RemoveCommand("screenshot");
 	ri.Cmd_RemoveCommand("imagelist");
 	ri.Cmd_RemoveCommand("gl_strings");
+	ri.Cmd_RemoveCommand("r_lerpbench");
 
 	LM_FreeLightmapBuffers();
 	Mod_FreeAll();
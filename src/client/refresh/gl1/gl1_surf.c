@@ -569,6 +569,8 @@ R_RegenAllLightmaps()
 	static lmrect_t lmchange[MAX_LIGHTMAPS][MAX_LIGHTMAP_COPIES];
 	static qboolean altered[MAX_LIGHTMAPS][MAX_LIGHTMAP_COPIES];
 
+	lmrect_t dirty[MAX_LIGHTMAPS];
+	qboolean affected[MAX_LIGHTMAPS];
 	int i, lmtex;
 #ifndef YQ2_GL1_GLES
 	qboolean pixelstore_set = false;
@@ -643,9 +645,7 @@ dynamic_surf:
 			base = r_lms.lightmap_buffer[i];
 			base += (current.top * BLOCK_WIDTH + current.left) * LIGHTMAP_BYTES;
 
-			R_BuildLightMap(surf, base, BLOCK_WIDTH * LIGHTMAP_BYTES,
-				&r_newrefdef, r_modulate->value, gammatable,
-				gl_state.minlight_set ? minlight : NULL);
+			R_QueueLightMap(surf, base, BLOCK_WIDTH * LIGHTMAP_BYTES);
 
 			surf->dirty_lightmap = (surf->dlightframe == r_framecount);
 			if (!surf->dirty_lightmap || gl_config.tilerendering)
@@ -662,6 +662,28 @@ dynamic_surf:
 			R_JoinAreas(&current, &best);
 		}
 
+		dirty[i] = best;
+		affected[i] = affected_lightmap;
+	}
+
+	/* the surfaces don't share texels, build them all at once */
+	R_BuildQueuedLightMaps(&r_newrefdef, r_modulate->value, gammatable,
+		gl_state.minlight_set ? minlight : NULL);
+
+	for (i = 1; i < MAX_LIGHTMAPS; i++)
+	{
+		lmrect_t current, best;
+		byte *base;
+		qboolean affected_lightmap;
+
+		if (!r_lms.lightmap_surfaces[i] || !r_lms.lightmap_buffer[i])
+		{
+			continue;
+		}
+
+		best = dirty[i];
+		affected_lightmap = affected[i];
+
 		if (!gl_config.tilerendering && !affected_lightmap)
 		{
 			continue;
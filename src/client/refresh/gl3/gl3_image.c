@@ -435,6 +435,56 @@ GL3_Upload32(unsigned *data, int width, int height, qboolean mipmap)
 }
 
 
+/*
+ * Uploads the block compressed mip chain of a 32 bit texture from the
+ * texture cache. Returns false if it has to be uploaded uncompressed.
+ */
+static qboolean
+GL3_UploadCompressed(const char *name, const byte *data, int width,
+	int height, qboolean *has_alpha)
+{
+	compimage_t cimage;
+	GLenum format;
+	int i;
+
+	/* r_scale8bittextures changes the pixels while uploading */
+	if (!r_texcompress->value || !gl3config.texture_compression ||
+		r_scale8bittextures->value)
+	{
+		return false;
+	}
+
+	if (!ri.VID_ImageCompress(name, data, width, height, &cimage))
+	{
+		return false;
+	}
+
+	format = (cimage.format == TEXCOMP_BC1) ?
+		GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+	for (i = 0; i < cimage.nummips; i++)
+	{
+		glCompressedTexImage2D(GL_TEXTURE_2D, i, format,
+			Q_max(width >> i, 1), Q_max(height >> i, 1), 0,
+			cimage.mipsizes[i], cimage.mips[i]);
+	}
+
+	ri.VID_ImageCompressFree(&cimage);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gl_filter_min);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gl_filter_max);
+
+	if (gl3config.anisotropic && r_anisotropic->value)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+				Q_max(r_anisotropic->value, 1.f));
+	}
+
+	*has_alpha = (cimage.format == TEXCOMP_BC3);
+
+	return true;
+}
+
 /*
  * Returns has_alpha
  */
@@ -484,6 +534,16 @@ GL3_LoadPic(const char *name, byte *pic, int width, int realwidth,
 		nolerp = Utils_FilenameFiltered(name, nolerplist, ' ');
 	}
 
+	i = R_ImageHashFind(name);
+
+	if (i >= 0)
+	{
+		/* we already have such image */
+		image = &gl3textures[i];
+		image->registration_sequence = registration_sequence;
+		return image;
+	}
+
 	/* find a free gl3image_t */
 	for (i = 0, image = gl3textures; i < numgl3textures; i++, image++)
 	{
@@ -491,13 +551,6 @@ GL3_LoadPic(const char *name, byte *pic, int width, int realwidth,
 		{
 			break;
 		}
-
-		if (!strcmp(image->name, name))
-		{
-			/* we already have such image */
-			image->registration_sequence = registration_sequence;
-			return image;
-		}
 	}
 
 	if (i == numgl3textures)
@@ -520,6 +573,7 @@ GL3_LoadPic(const char *name, byte *pic, int width, int realwidth,
 	}
 
 	strcpy(image->name, name);
+	R_ImageHashAdd(image->name, i);
 	image->registration_sequence = registration_sequence;
 
 	image->width = width;
@@ -674,8 +728,14 @@ GL3_LoadPic(const char *name, byte *pic, int width, int realwidth,
 		}
 		else
 		{
-			image->has_alpha = GL3_Upload32((unsigned *)pic, width, height,
-						(image->type != it_pic && image->type != it_sky));
+			qboolean mipmap = (image->type != it_pic && image->type != it_sky);
+
+			if (!mipmap || !GL3_UploadCompressed(name, pic, width, height,
+					&image->has_alpha))
+			{
+				image->has_alpha = GL3_Upload32((unsigned *)pic, width, height,
+							mipmap);
+			}
 		}
 
 		image->upload_width = width; /* after power of 2 and scales */
@@ -752,13 +812,13 @@ GL3_FindImage(const char *originname, imagetype_t type)
 	namewe[len] = 0;
 
 	/* look for it */
-	for (i = 0, image = gl3textures; i < numgl3textures; i++, image++)
+	i = R_ImageHashFind(name);
+
+	if (i >= 0)
 	{
-		if (!strcmp(name, image->name))
-		{
-			image->registration_sequence = registration_sequence;
-			return image;
-		}
+		image = &gl3textures[i];
+		image->registration_sequence = registration_sequence;
+		return image;
 	}
 
 	/*
@@ -815,6 +875,7 @@ GL3_FreeUnusedImages(void)
 
 		/* free it */
 		glDeleteTextures(1, &image->texnum);
+		R_ImageHashRemove(i);
 		memset(image, 0, sizeof(*image));
 	}
 }
@@ -868,6 +929,8 @@ GL3_ShutdownImages(void)
 		memset(image, 0, sizeof(*image));
 	}
 
+	R_ImageHashClear();
+
 	for (i = 0; i < MAX_SCRAPS; i++)
 	{
 		if (gl3_scrap_textures[i])
@@ -191,6 +191,24 @@ GL3_Strings(void)
 	Com_Printf("\n");
 }
 
+static qboolean
+GL3_HasExtension(const char *name)
+{
+	GLint i, numExtensions;
+
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+
+	for (i = 0; i < numExtensions; i++)
+	{
+		if (!strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static void
 GL3_Register(void)
 {
@@ -251,6 +269,7 @@ GL3_Register(void)
 	ri.Cmd_AddCommand("screenshot", GL3_ScreenShot);
 	ri.Cmd_AddCommand("modellist", GL3_Mod_Modellist_f);
 	ri.Cmd_AddCommand("gl_strings", GL3_Strings);
+	ri.Cmd_AddCommand("r_lerpbench", R_LerpBench_f);
 }
 
 /*
@@ -478,6 +497,21 @@ GL3_Init(void)
 		Com_Printf("Not supported\n");
 	}
 
+	/* S3TC, for r_texcompress */
+	Com_Printf(" - S3TC Texture Compression: ");
+
+	gl3config.texture_compression =
+		GL3_HasExtension("GL_EXT_texture_compression_s3tc");
+
+	if (gl3config.texture_compression)
+	{
+		Com_Printf("Supported\n");
+	}
+	else
+	{
+		Com_Printf("Not supported\n");
+	}
+
 	if (gl3config.debug_output)
 	{
 		Com_Printf(" - OpenGL Debug Output: Supported ");
@@ -541,6 +575,7 @@ GL3_Shutdown(void)
 	ri.Cmd_RemoveCommand("screenshot");
 	ri.Cmd_RemoveCommand("imagelist");
 	ri.Cmd_RemoveCommand("gl_strings");
+	ri.Cmd_RemoveCommand("r_lerpbench");
 
 	// only call all these if we have an OpenGL context and the gl function pointers
 	// randomly chose one function that should always be there to test..
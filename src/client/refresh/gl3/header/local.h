@@ -94,6 +94,14 @@ static const int gl3_alpha_format = GL_RGBA;
 static const int gl3_tex_solid_format = GL_RGBA;
 static const int gl3_tex_alpha_format = GL_RGBA;
 
+// from GL_EXT_texture_compression_s3tc, not in the glad headers
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 extern unsigned gl3_rawpalette[256];
 extern unsigned d_8to24table[256];
 
@@ -115,6 +123,7 @@ typedef struct
 	qboolean anisotropic; // is GL_EXT_texture_filter_anisotropic supported?
 	qboolean debug_output; // is GL_ARB_debug_output supported?
 	qboolean stencil; // Do we have a stencil buffer?
+	qboolean texture_compression; // is GL_EXT_texture_compression_s3tc supported?
 
 	// ----
 
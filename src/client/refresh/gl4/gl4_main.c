@@ -187,6 +187,24 @@ GL4_Strings(void)
 	Com_Printf("\n");
 }
 
+static qboolean
+GL4_HasExtension(const char *name)
+{
+	GLint i, numExtensions;
+
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+
+	for (i = 0; i < numExtensions; i++)
+	{
+		if (!strcmp((const char*)glGetStringi(GL_EXTENSIONS, i), name))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static void
 GL4_Register(void)
 {
@@ -246,6 +264,7 @@ GL4_Register(void)
 	ri.Cmd_AddCommand("screenshot", GL4_ScreenShot);
 	ri.Cmd_AddCommand("modellist", GL4_Mod_Modellist_f);
 	ri.Cmd_AddCommand("gl_strings", GL4_Strings);
+	ri.Cmd_AddCommand("r_lerpbench", R_LerpBench_f);
 }
 
 /*
@@ -468,6 +487,21 @@ GL4_Init(void)
 		Com_Printf("Not supported\n");
 	}
 
+	/* S3TC, for r_texcompress */
+	Com_Printf(" - S3TC Texture Compression: ");
+
+	gl4config.texture_compression =
+		GL4_HasExtension("GL_EXT_texture_compression_s3tc");
+
+	if (gl4config.texture_compression)
+	{
+		Com_Printf("Supported\n");
+	}
+	else
+	{
+		Com_Printf("Not supported\n");
+	}
+
 	if (gl4config.debug_output)
 	{
 		Com_Printf(" - OpenGL Debug Output: Supported ");
@@ -531,6 +565,7 @@ GL4_Shutdown(void)
 	ri.Cmd_RemoveCommand("screenshot");
 	ri.Cmd_RemoveCommand("imagelist");
 	ri.Cmd_RemoveCommand("gl_strings");
+	ri.Cmd_RemoveCommand("r_lerpbench");
 
 	// only call all these if we have an OpenGL context and the gl function pointers
 	// randomly chose one function that should always be there to test..
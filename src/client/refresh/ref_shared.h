@@ -222,6 +222,7 @@ typedef struct surfcache_s
 	unsigned	height;            /* DEBUG only needed for debug */
 	float	mipscale;
 	struct image_s	*image;
+	int	batch;                     /* soft renderer surface batch using it */
 	byte	data[4];               /* width * height elements */
 } surfcache_t;
 
@@ -442,6 +443,17 @@ extern void R_FloodFillSkin(byte *skin, int skinwidth, int skinheight, const uns
 extern unsigned *R_Convert8to32(const byte *data, size_t width, size_t height, const unsigned *table_8to24);
 extern struct image_s *R_LoadImage(const char *name, const char* namewe, const char *ext,
 	imagetype_t type, loadimage_t load_image);
+
+/* Image registry, see files/images.c */
+#define MAX_PREFETCH_IMAGES 64
+extern void R_ImageHashClear(void);
+extern void R_ImageHashAdd(const char *name, int index);
+extern void R_ImageHashRemove(int index);
+extern int R_ImageHashFind(const char *name);
+extern void R_PrefetchImages(const char **names, int count);
+extern void R_FreePrefetchedImages(void);
+extern qboolean R_TakePrefetchedImage(const char *namewe, byte **pic,
+	int *width, int *height);
 extern void Mod_LoadQBSPNodes(const char *name, cplane_t *planes, int numplanes,
 	mleaf_t *leafs, int numleafs, mnode_t **nodes, int *numnodes, vec3_t mins, vec3_t maxs,
 	const byte *mod_base, const lump_t *l, int ident);
@@ -508,6 +520,7 @@ extern vec4_t *R_VertBufferRealloc(size_t num);
 extern float r_byteNormalScale[256];
 extern void R_VertBufferInit(void);
 extern void R_VertBufferFree(void);
+extern void R_LerpBench_f(void);
 extern void R_GenFanIndexes(unsigned short *data, unsigned from, unsigned to);
 extern void R_GenStripIndexes(unsigned short *data, unsigned from, unsigned to);
 
@@ -523,6 +536,9 @@ extern void R_SetCacheState(msurface_t *surf, const refdef_t *refdef);
 extern void R_BuildLightMap(const msurface_t *surf, byte *dest, int stride,
 	const refdef_t *r_newrefdef, float modulate, const byte *gammatable,
 	const byte *minlight);
+extern void R_QueueLightMap(const msurface_t *surf, byte *dest, int stride);
+extern void R_BuildQueuedLightMaps(const refdef_t *r_newrefdef, float modulate,
+	const byte *gammatable, const byte *minlight);
 extern void R_InitTemporaryLMBuffer(void);
 extern void R_FreeTemporaryLMBuffer(void);
 extern byte *R_GetTemporaryLMBuffer(size_t size);
@@ -577,6 +593,7 @@ extern cvar_t *r_skeletalanimation;
 extern cvar_t *r_shadows;
 extern cvar_t *r_showtris;
 extern cvar_t *r_speeds;
+extern cvar_t *r_texcompress;
 extern cvar_t *r_ttffont;
 extern cvar_t *r_zfix;
 extern cvar_t *r_validation;
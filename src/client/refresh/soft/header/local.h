@@ -220,6 +220,18 @@ typedef struct espan_s
 	int		u, v, count;
 	struct espan_s	*pnext;
 } espan_t;
+
+// texture mapping of a surface, what the span drawers need
+typedef struct
+{
+	const pixel_t	*cacheblock;
+	int		cachewidth;
+	float		sdivzstepu, tdivzstepu;
+	float		sdivzstepv, tdivzstepv;
+	float		sdivzorigin, tdivzorigin;
+	int		sadjust, tadjust;
+	int		bbextents, bbextentt;
+} spangrad_t;
 extern espan_t	*vid_polygon_spans; // space for spans in r_poly
 
 // used by the polygon drawer (sw_poly.c) and sprite setup code (sw_sprite.c)
@@ -306,10 +318,16 @@ extern float	d_sdivzstepu, d_tdivzstepu;
 extern float	d_sdivzstepv, d_tdivzstepv;
 extern float	d_sdivzorigin, d_tdivzorigin;
 
-void D_DrawSpansPow2(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv);
-void D_DrawZSpans(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv);
-void TurbulentPow2(espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv);
-void NonTurbulentPow2(espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv);
+// only the spans with vmin <= v < vmax are drawn
+void D_DrawSpansPow2(const espan_t *pspan, const spangrad_t *grad, float d_ziorigin,
+	float d_zistepu, float d_zistepv, int vmin, int vmax);
+void D_DrawZSpans(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv,
+	int vmin, int vmax);
+void D_DamageZSpans(const espan_t *pspan);
+void TurbulentPow2(const espan_t *pspan, const spangrad_t *grad, float d_ziorigin,
+	float d_zistepu, float d_zistepv, int vmin, int vmax);
+void NonTurbulentPow2(const espan_t *pspan, const spangrad_t *grad, float d_ziorigin,
+	float d_zistepu, float d_zistepv, int vmin, int vmax);
 
 surfcache_t *D_CacheSurface(const entity_t *currententity, msurface_t *surface, int miplevel);
 
@@ -375,6 +393,7 @@ extern cvar_t	*sw_surfcacheoverride;
 extern cvar_t	*sw_waterwarp;
 extern cvar_t	*sw_gunzposition;
 extern cvar_t	*sw_colorlight;
+extern cvar_t	*sw_threads;
 
 //=============================================================================
 
@@ -406,6 +425,7 @@ void R_DrawSolidClippedSubmodelPolygons(entity_t *currententity, const model_t *
 void R_DrawAliasModel(entity_t *currententity, const model_t *currentmodel);
 void R_BeginEdgeFrame(void);
 void R_ScanEdges(entity_t *currententity, const surf_t *surface);
+void D_FreeSurfaceJobs(void);
 void RI_PushDlights(const model_t *model);
 void R_RotateBmodel(const entity_t *currententity);
 void RI_BuildLightMap(drawsurf_t* drawsurf, const refdef_t *r_newrefdef, float modulate);
@@ -492,6 +512,7 @@ extern  void			*colormap;
 void Draw_InitLocal(void);
 void R_InitCaches(void);
 void D_FlushCaches(void);
+void D_FlushSurfJobsFor(const surfcache_t *cache);
 
 void	RE_BeginRegistration (const char *model);
 struct model_s	*RE_RegisterModel (const char *name);
@@ -536,6 +557,11 @@ extern qboolean	fastmoving;
 void VID_DamageZBuffer(int u, int v);
 qboolean VID_CheckDamageZBuffer(int u, int v, int ucount, int vcount);
 
+// Horizontal bands drawn by the worker threads
+qboolean R_ThreadedBands(void);
+void R_ParallelBands(int top, int bottom, void (*func)(void *data, int vmin, int vmax),
+	void *data);
+
 /*
 ====================================================================
 
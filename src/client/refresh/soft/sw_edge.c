@@ -724,6 +724,33 @@ static surfcache_t		*pcurrentcache;
 static vec3_t			transformed_modelorg;
 static vec3_t			world_transformed_modelorg;
 
+typedef enum
+{
+	SURFJOB_SOLID,
+	SURFJOB_SKY,
+	SURFJOB_BACKGROUND,
+	SURFJOB_TURBULENT,
+	SURFJOB_FLOWING
+} surfjobtype_t;
+
+/*
+ * A surface ready to have its spans drawn. With sw_threads the jobs
+ * of a D_DrawSurfaces() call are set up first, the surface cache and
+ * the view vectors are only touched here, then the workers draw them
+ * in horizontal bands. Spans never overlap, so the bands are drawn
+ * exactly like the whole screen would be.
+ */
+typedef struct
+{
+	const surf_t	*surf;
+	surfjobtype_t	type;
+	spangrad_t	grad;
+} surfjob_t;
+
+static surfjob_t	*surfjobs;
+static int		numsurfjobs, maxsurfjobs;
+static int		surfjobbatch = 1;	// stamped into the cache blocks in use
+
 /*
 =============
 D_MipLevelForScale
@@ -758,7 +785,7 @@ Simple single color fill with no texture mapping
 ==============
 */
 static void
-D_FlatFillSurface (surf_t *surf, pixel_t color)
+D_FlatFillSurface (const surf_t *surf, pixel_t color, int vmin, int vmax)
 {
 	espan_t	*span;
 
@@ -766,6 +793,9 @@ D_FlatFillSurface (surf_t *surf, pixel_t color)
 	{
 		pixel_t   *pdest;
 
+		if ((span->v < vmin) || (span->v >= vmax))
+			continue;
+
 		pdest = d_viewbuffer + vid_buffer_width*span->v + span->u;
 		memset(pdest,  color&0xFF, span->count * sizeof(pixel_t));
 	}
@@ -778,7 +808,7 @@ D_CalcGradients
 ==============
 */
 static void
-D_CalcGradients (msurface_t *pface, float d_ziorigin, float d_zistepu, float d_zistepv)
+D_CalcGradients (msurface_t *pface, spangrad_t *grad)
 {
 	float		mipscale;
 	vec3_t		p_temp1;
@@ -791,25 +821,25 @@ D_CalcGradients (msurface_t *pface, float d_ziorigin, float d_zistepu, float d_z
 	TransformVector(pface->texinfo->vecs[1], p_taxis);
 
 	t = xscaleinv * mipscale;
-	d_sdivzstepu = p_saxis[0] * t;
-	d_tdivzstepu = p_taxis[0] * t;
+	grad->sdivzstepu = p_saxis[0] * t;
+	grad->tdivzstepu = p_taxis[0] * t;
 
 	t = yscaleinv * mipscale;
-	d_sdivzstepv = -p_saxis[1] * t;
-	d_tdivzstepv = -p_taxis[1] * t;
+	grad->sdivzstepv = -p_saxis[1] * t;
+	grad->tdivzstepv = -p_taxis[1] * t;
 
-	d_sdivzorigin = p_saxis[2] * mipscale - xcenter * d_sdivzstepu -
-			ycenter * d_sdivzstepv;
-	d_tdivzorigin = p_taxis[2] * mipscale - xcenter * d_tdivzstepu -
-			ycenter * d_tdivzstepv;
+	grad->sdivzorigin = p_saxis[2] * mipscale - xcenter * grad->sdivzstepu -
+			ycenter * grad->sdivzstepv;
+	grad->tdivzorigin = p_taxis[2] * mipscale - xcenter * grad->tdivzstepu -
+			ycenter * grad->tdivzstepv;
 
 	VectorScale (transformed_modelorg, mipscale, p_temp1);
 
 	t = SHIFT16XYZ_MULT * mipscale;
-	sadjust = ((int)(DotProduct(p_temp1, p_saxis) * SHIFT16XYZ_MULT + 0.5)) -
+	grad->sadjust = ((int)(DotProduct(p_temp1, p_saxis) * SHIFT16XYZ_MULT + 0.5)) -
 			((pface->texturemins[0] << SHIFT16XYZ) >> miplevel)
 			+ pface->texinfo->vecs[0][3]*t;
-	tadjust = ((int)(DotProduct(p_temp1, p_taxis) * SHIFT16XYZ_MULT + 0.5)) -
+	grad->tadjust = ((int)(DotProduct(p_temp1, p_taxis) * SHIFT16XYZ_MULT + 0.5)) -
 			((pface->texturemins[1] << SHIFT16XYZ) >> miplevel)
 			+ pface->texinfo->vecs[1][3]*t;
 
@@ -819,15 +849,15 @@ D_CalcGradients (msurface_t *pface, float d_ziorigin, float d_zistepu, float d_z
 		float sscroll, tscroll;
 
 		R_FlowingScroll(&r_newrefdef, pface->texinfo->flags, &sscroll, &tscroll);
-		sadjust += SHIFT16XYZ_MULT * 2 * sscroll;
-		tadjust += SHIFT16XYZ_MULT * 2 * tscroll;
+		grad->sadjust += SHIFT16XYZ_MULT * 2 * sscroll;
+		grad->tadjust += SHIFT16XYZ_MULT * 2 * tscroll;
 	}
 
 	//
 	// -1 (-epsilon) so we never wander off the edge of the texture
 	//
-	bbextents = ((pface->extents[0] << SHIFT16XYZ) >> miplevel) - 1;
-	bbextentt = ((pface->extents[1] << SHIFT16XYZ) >> miplevel) - 1;
+	grad->bbextents = ((pface->extents[0] << SHIFT16XYZ) >> miplevel) - 1;
+	grad->bbextentt = ((pface->extents[1] << SHIFT16XYZ) >> miplevel) - 1;
 }
 
 
@@ -838,13 +868,12 @@ D_BackgroundSurf
 The grey background filler seen when there is a hole in the map
 ==============
 */
-static void
-D_BackgroundSurf (surf_t *s)
+static qboolean
+D_BackgroundSurf (surf_t *s, surfjob_t *job)
 {
-	D_FlatFillSurface (s, (int)sw_clearcolor->value & 0xFF);
-	// set up a gradient for the background surface that places it
-	// effectively at infinity distance from the viewpoint
-	D_DrawZSpans (s->spans, -0.9, 0, 0);
+	job->type = SURFJOB_BACKGROUND;
+
+	return true;
 }
 
 /*
@@ -852,13 +881,13 @@ D_BackgroundSurf (surf_t *s)
 D_TurbulentSurf
 =================
 */
-static void
-D_TurbulentSurf(surf_t *s)
+static qboolean
+D_TurbulentSurf(surf_t *s, surfjob_t *job)
 {
 	pface = s->msurf;
 	miplevel = 0;
-	cacheblock = pface->texinfo->image->pixels[0];
-	cachewidth = 64;
+	job->grad.cacheblock = pface->texinfo->image->pixels[0];
+	job->grad.cachewidth = 64;
 
 	if (s->insubmodel)
 	{
@@ -876,18 +905,16 @@ D_TurbulentSurf(surf_t *s)
 						// make entity passed in
 	}
 
-	D_CalcGradients (pface, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+	D_CalcGradients (pface, &job->grad);
 
 	//============
 	// textures that aren't warping are just flowing. Use NonTurbulentPow2 instead
 	if (!(pface->texinfo->flags & SURF_WARP))
-		NonTurbulentPow2 (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+		job->type = SURFJOB_FLOWING;
 	else
-		TurbulentPow2 (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+		job->type = SURFJOB_TURBULENT;
 	//============
 
-	D_DrawZSpans (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
-
 	if (s->insubmodel)
 	{
 		//
@@ -902,6 +929,8 @@ D_TurbulentSurf(surf_t *s)
 		VectorCopy(base_vright, vright);
 		R_TransformFrustum(modelorg, vright, vup, vpn);
 	}
+
+	return true;
 }
 
 /*
@@ -909,25 +938,25 @@ D_TurbulentSurf(surf_t *s)
 D_SkySurf
 ==============
 */
-static void
-D_SkySurf (surf_t *s)
+static qboolean
+D_SkySurf (surf_t *s, surfjob_t *job)
 {
 	pface = s->msurf;
 	miplevel = 0;
 	if (!pface->texinfo->image)
-		return;
-	cacheblock = pface->texinfo->image->pixels[0];
-	cachewidth = 256;
+		return false;
+	job->grad.cacheblock = pface->texinfo->image->pixels[0];
+	job->grad.cachewidth = 256;
 
-	D_CalcGradients (pface, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+	D_CalcGradients (pface, &job->grad);
 
-	D_DrawSpansPow2 (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+	job->type = SURFJOB_SKY;
 
-	// set up a gradient for the background surface that places it
-	// effectively at infinity distance from the viewpoint
-	D_DrawZSpans (s->spans, -0.9, 0, 0);
+	return true;
 }
 
+static void D_FlushSurfJobs(void);
+
 /*
 ==============
 D_SolidSurf
@@ -935,8 +964,8 @@ D_SolidSurf
 Normal surface cached, texture mapped surface
 ==============
 */
-static void
-D_SolidSurf (entity_t *currententity, surf_t *s)
+static qboolean
+D_SolidSurf (entity_t *currententity, surf_t *s, surfjob_t *job)
 {
 	float len1, len2, mipadjust;
 
@@ -965,17 +994,25 @@ D_SolidSurf (entity_t *currententity, surf_t *s)
 	}
 	miplevel = D_MipLevelForScale(s->nearzi * scale_for_mip * mipadjust);
 
+	// a surface seen twice in a batch, e.g. by two entities with one
+	// model, may be rebuilt with another texture frame: draw the
+	// jobs using the old data first
+	if (numsurfjobs && pface->cachespots[miplevel] &&
+		(pface->cachespots[miplevel]->batch == surfjobbatch))
+	{
+		D_FlushSurfJobs();
+	}
+
 	// FIXME: make this passed in to D_CacheSurface
 	pcurrentcache = D_CacheSurface (currententity, pface, miplevel);
+	pcurrentcache->batch = surfjobbatch;
 
-	cacheblock = (pixel_t *)pcurrentcache->data;
-	cachewidth = pcurrentcache->width;
-
-	D_CalcGradients (pface, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+	job->grad.cacheblock = (pixel_t *)pcurrentcache->data;
+	job->grad.cachewidth = pcurrentcache->width;
 
-	D_DrawSpansPow2 (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+	D_CalcGradients (pface, &job->grad);
 
-	D_DrawZSpans (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+	job->type = SURFJOB_SOLID;
 
 	if (s->insubmodel)
 	{
@@ -991,6 +1028,119 @@ D_SolidSurf (entity_t *currententity, surf_t *s)
 		VectorCopy(base_vright, vright);
 		R_TransformFrustum(modelorg, vright, vup, vpn);
 	}
+
+	return true;
+}
+
+/*
+==============
+D_DrawSurfJob
+
+Draws the spans of a surface with vmin <= v < vmax, can
+run on a worker thread
+==============
+*/
+static void
+D_DrawSurfJob (const surfjob_t *job, int vmin, int vmax)
+{
+	const surf_t *s = job->surf;
+
+	switch (job->type)
+	{
+		case SURFJOB_SOLID:
+			D_DrawSpansPow2 (s->spans, &job->grad, s->d_ziorigin,
+				s->d_zistepu, s->d_zistepv, vmin, vmax);
+			D_DrawZSpans (s->spans, s->d_ziorigin, s->d_zistepu,
+				s->d_zistepv, vmin, vmax);
+			break;
+
+		case SURFJOB_SKY:
+			D_DrawSpansPow2 (s->spans, &job->grad, s->d_ziorigin,
+				s->d_zistepu, s->d_zistepv, vmin, vmax);
+			// set up a gradient for the background surface that places it
+			// effectively at infinity distance from the viewpoint
+			D_DrawZSpans (s->spans, -0.9, 0, 0, vmin, vmax);
+			break;
+
+		case SURFJOB_BACKGROUND:
+			D_FlatFillSurface (s, (int)sw_clearcolor->value & 0xFF,
+				vmin, vmax);
+			// set up a gradient for the background surface that places it
+			// effectively at infinity distance from the viewpoint
+			D_DrawZSpans (s->spans, -0.9, 0, 0, vmin, vmax);
+			break;
+
+		case SURFJOB_TURBULENT:
+			TurbulentPow2 (s->spans, &job->grad, s->d_ziorigin,
+				s->d_zistepu, s->d_zistepv, vmin, vmax);
+			D_DrawZSpans (s->spans, s->d_ziorigin, s->d_zistepu,
+				s->d_zistepv, vmin, vmax);
+			break;
+
+		case SURFJOB_FLOWING:
+			NonTurbulentPow2 (s->spans, &job->grad, s->d_ziorigin,
+				s->d_zistepu, s->d_zistepv, vmin, vmax);
+			D_DrawZSpans (s->spans, s->d_ziorigin, s->d_zistepu,
+				s->d_zistepv, vmin, vmax);
+			break;
+	}
+}
+
+static void
+D_DrawSurfJobs (void *data, int vmin, int vmax)
+{
+	int i;
+
+	for (i = 0; i < numsurfjobs; i++)
+	{
+		D_DrawSurfJob (&surfjobs[i], vmin, vmax);
+	}
+}
+
+/*
+==============
+D_FlushSurfJobs
+
+Draws the jobs set up so far on the worker threads
+==============
+*/
+static void
+D_FlushSurfJobs (void)
+{
+	R_ParallelBands (r_refdef.vrect.y, r_refdef.vrectbottom,
+		D_DrawSurfJobs, NULL);
+
+	numsurfjobs = 0;
+	surfjobbatch++;
+}
+
+/*
+==============
+D_FlushSurfJobsFor
+
+The surface cache is about to free or merge the block, draw the
+jobs still reading from it first
+==============
+*/
+void
+D_FlushSurfJobsFor (const surfcache_t *cache)
+{
+	if (numsurfjobs && (cache->batch == surfjobbatch))
+	{
+		D_FlushSurfJobs();
+	}
+}
+
+void
+D_FreeSurfaceJobs (void)
+{
+	if (surfjobs)
+	{
+		free(surfjobs);
+	}
+	surfjobs = NULL;
+	numsurfjobs = 0;
+	maxsurfjobs = 0;
 }
 
 /*
@@ -1013,8 +1163,10 @@ D_DrawflatSurfaces (const surf_t *surface)
 
 		// make a stable color for each surface by taking the low
 		// bits of the msurface pointer
-		D_FlatFillSurface (s, color & 0xFF);
-		D_DrawZSpans (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+		D_FlatFillSurface (s, color & 0xFF, 0, vid_buffer_height);
+		D_DamageZSpans (s->spans);
+		D_DrawZSpans (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv,
+			0, vid_buffer_height);
 
 		color ++;
 	}
@@ -1037,23 +1189,65 @@ D_DrawSurfaces(entity_t *currententity, const surf_t *surface)
 
 	if (!sw_drawflat->value)
 	{
+		qboolean threaded;
 		surf_t *s;
 
+		threaded = R_ThreadedBands();
+
+		if (threaded && (maxsurfjobs < surface - surfaces))
+		{
+			D_FreeSurfaceJobs();
+
+			maxsurfjobs = surf_max - surfaces;
+			surfjobs = malloc(maxsurfjobs * sizeof(surfjob_t));
+			if (!surfjobs)
+			{
+				Com_Printf("%s: Couldn't malloc %d bytes\n",
+					 __func__, (int)(maxsurfjobs * sizeof(surfjob_t)));
+				maxsurfjobs = 0;
+				threaded = false;
+			}
+		}
+
 		for (s = &surfaces[1] ; s<surface ; s++)
 		{
+			surfjob_t job;
+			qboolean drawn;
+
 			if (!s->spans)
 				continue;
 
 			r_drawnpolycount++;
 
 			if (! (s->flags & (SURF_DRAWSKY|SURF_DRAWBACKGROUND|SURF_DRAWTURB) ) )
-				D_SolidSurf (currententity, s);
+				drawn = D_SolidSurf (currententity, s, &job);
 			else if (s->flags & SURF_DRAWSKY)
-				D_SkySurf (s);
+				drawn = D_SkySurf (s, &job);
 			else if (s->flags & SURF_DRAWBACKGROUND)
-				D_BackgroundSurf (s);
+				drawn = D_BackgroundSurf (s, &job);
 			else if (s->flags & SURF_DRAWTURB)
-				D_TurbulentSurf (s);
+				drawn = D_TurbulentSurf (s, &job);
+			else
+				drawn = false;
+
+			if (!drawn)
+				continue;
+
+			job.surf = s;
+			D_DamageZSpans (s->spans);
+
+			if (!threaded)
+			{
+				D_DrawSurfJob (&job, 0, vid_buffer_height);
+				continue;
+			}
+
+			surfjobs[numsurfjobs++] = job;
+		}
+
+		if (numsurfjobs)
+		{
+			D_FlushSurfJobs();
 		}
 	}
 	else
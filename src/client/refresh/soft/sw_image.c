@@ -93,6 +93,16 @@ R_FindFreeImage(const char *name)
 	image_t		*image;
 	int			i;
 
+	i = R_ImageHashFind(name);
+
+	if (i >= 0)
+	{
+		/* we already have such image */
+		image = &r_images[i];
+		image->registration_sequence = registration_sequence;
+		return image;
+	}
+
 	// find a free image_t
 	for (i=0, image=r_images ; i<numr_images ; i++,image++)
 	{
@@ -100,13 +110,6 @@ R_FindFreeImage(const char *name)
 		{
 			break;
 		}
-
-		if (!strcmp(image->name, name))
-		{
-			/* we already have such image */
-			image->registration_sequence = registration_sequence;
-			return image;
-		}
 	}
 
 	if (i == numr_images)
@@ -299,6 +302,7 @@ R_LoadPic8(const char *name, const byte *pic, int width, int realwidth, int heig
 	}
 
 	strcpy (image->name, name);
+	R_ImageHashAdd(image->name, image - r_images);
 	image->registration_sequence = registration_sequence;
 
 	image->width = width;
@@ -596,13 +600,13 @@ R_FindImage(const char *originname, imagetype_t type)
 	namewe[len] = 0;
 
 	// look for it
-	for (i=0, image=r_images ; i<numr_images ; i++,image++)
+	i = R_ImageHashFind(name);
+
+	if (i >= 0)
 	{
-		if (!strcmp(name, image->name))
-		{
-			image->registration_sequence = registration_sequence;
-			return image;
-		}
+		image = &r_images[i];
+		image->registration_sequence = registration_sequence;
+		return image;
 	}
 
 	//
@@ -645,6 +649,7 @@ R_FreeUnusedImages(void)
 			continue; // don't free pics
 		// free it
 		free (image->pixels[0]); // the other mip levels just follow
+		R_ImageHashRemove(i);
 		memset(image, 0, sizeof(*image));
 	}
 }
@@ -782,6 +787,8 @@ R_ShutdownImages(void)
 		memset(image, 0, sizeof(*image));
 	}
 
+	R_ImageHashClear();
+
 	if (d_16to8table)
 		free(d_16to8table);
 }
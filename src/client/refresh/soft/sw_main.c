@@ -137,6 +137,7 @@ static cvar_t	*sw_overbrightbits;
 cvar_t	*sw_custom_particles;
 cvar_t	*sw_texture_filtering;
 cvar_t	*sw_gunzposition;
+cvar_t	*sw_threads;
 static cvar_t	*sw_partialrefresh;
 
 // sw_vars.c
@@ -255,6 +256,73 @@ VID_WholeDamageZBuffer(void)
 	vid_zmaxv = vid_buffer_height;
 }
 
+/*
+================
+R_ThreadedBands
+
+True if the frame is drawn in bands by the worker threads
+================
+*/
+qboolean
+R_ThreadedBands(void)
+{
+	return sw_threads->value && (ri.Sys_NumWorkers() > 1);
+}
+
+#define MIN_BAND_HEIGHT 8
+
+typedef struct
+{
+	void (*func)(void *data, int vmin, int vmax);
+	void *data;
+	int top, bottom, height;
+} bandjob_t;
+
+static void
+R_BandJob(void *data, int index, int worker)
+{
+	const bandjob_t *job = data;
+	int vmin;
+
+	vmin = job->top + index * job->height;
+	job->func(job->data, vmin, Q_min(vmin + job->height, job->bottom));
+}
+
+/*
+================
+R_ParallelBands
+
+Calls func for horizontal bands covering the rows top to bottom - 1.
+With sw_threads the bands run on the worker threads, func must only
+write the rows it is given.
+================
+*/
+void
+R_ParallelBands(int top, int bottom, void (*func)(void *data, int vmin, int vmax),
+	void *data)
+{
+	bandjob_t job;
+	int bands;
+
+	if ((bottom - top < MIN_BAND_HEIGHT * 2) || !R_ThreadedBands())
+	{
+		func(data, top, bottom);
+		return;
+	}
+
+	/* a few bands per worker even out the load */
+	bands = ri.Sys_NumWorkers() * 4;
+
+	job.func = func;
+	job.data = data;
+	job.top = top;
+	job.bottom = bottom;
+	job.height = Q_max((bottom - top + bands - 1) / bands, MIN_BAND_HEIGHT);
+
+	bands = (bottom - top + job.height - 1) / job.height;
+	ri.Sys_ParallelFor(bands, R_BandJob, &job);
+}
+
 /*
 ================
 VID_DamageBuffer
@@ -350,6 +418,7 @@ R_RegisterVariables(void)
 	sw_custom_particles = ri.Cvar_Get("sw_custom_particles", "0", CVAR_ARCHIVE);
 	sw_texture_filtering = ri.Cvar_Get("sw_texture_filtering", "0", CVAR_ARCHIVE);
 	sw_gunzposition = ri.Cvar_Get("sw_gunzposition", "8", CVAR_ARCHIVE);
+	sw_threads = ri.Cvar_Get("sw_threads", "0", CVAR_ARCHIVE);
 
 	// On MacOS texture is cleaned up after render and code have to copy a whole
 	// screen to texture, other platforms save previous texture content and can be
@@ -366,6 +435,7 @@ R_RegisterVariables(void)
 	ri.Cmd_AddCommand("modellist", Mod_Modellist_f);
 	ri.Cmd_AddCommand("screenshot", R_ScreenShot_f);
 	ri.Cmd_AddCommand("imagelist", R_ImageList_f);
+	ri.Cmd_AddCommand("r_lerpbench", R_LerpBench_f);
 
 	r_mode->modified = true; // force us to do mode specific stuff later
 	vid_gamma->modified = true; // force us to rebuild the gamma table later
@@ -378,6 +448,7 @@ R_UnRegister(void)
 	ri.Cmd_RemoveCommand( "screenshot" );
 	ri.Cmd_RemoveCommand( "modellist" );
 	ri.Cmd_RemoveCommand( "imagelist" );
+	ri.Cmd_RemoveCommand( "r_lerpbench" );
 }
 
 static void RE_ShutdownContext(void);
@@ -2110,6 +2181,8 @@ RE_ShutdownContext(void)
 	}
 	r_warpbuffer = NULL;
 
+	D_FreeSurfaceJobs();
+
 	if (texture)
 	{
 		SDL_DestroyTexture(texture);
@@ -2129,53 +2202,48 @@ point math used in R_ScanEdges() overflows at width 2048 !!
 */
 char shift_size;
 
+typedef struct
+{
+	Uint32 *pixels;
+	int pitch;
+	int top;
+} copyframe_t;
+
 static void
-RE_CopyFrame(Uint32 *pixels, int pitch, SDL_Rect *rect)
+RE_CopyRows(void *data, int vmin, int vmax)
 {
+	const copyframe_t *copy = data;
 	const unsigned *sdl_palette;
+	int y;
 
 	sdl_palette = (unsigned *)sw_state.currentpalette;
 
-	/* no gaps between images rows */
-	if (pitch == vid_buffer_width)
+	for (y = vmin; y < vmax; y++)
 	{
-		const byte *src_max;
+		const pixel_t *src;
 		Uint32 *dst;
-		byte *src;
+		int x;
 
-		dst = pixels;
-		src = vid_buffer + rect->y * vid_buffer_width;
-		src_max = src + rect->h * vid_buffer_width;
+		src = vid_buffer + y * vid_buffer_width;
+		dst = copy->pixels + (y - copy->top) * copy->pitch;
 
-		while (src < src_max)
+		for (x = 0; x < vid_buffer_width; x++)
 		{
-			*dst = sdl_palette[*src];
-
-			src++;
-			dst++;
+			dst[x] = sdl_palette[src[x]];
 		}
 	}
-	else
-	{
-		int y, buffer_pos;
-		Uint32 *dst;
-
-		buffer_pos = rect->y * vid_buffer_width;
-		dst = pixels;
+}
 
-		for (y = rect->y; y < rect->y + rect->h; y++)
-		{
-			int x;
+static void
+RE_CopyFrame(Uint32 *pixels, int pitch, SDL_Rect *rect)
+{
+	copyframe_t copy;
 
-			for (x = 0; x < vid_buffer_width; x++)
-			{
-				dst[x] = sdl_palette[vid_buffer[buffer_pos]];
-				buffer_pos ++;
-			}
+	copy.pixels = pixels;
+	copy.pitch = pitch;
+	copy.top = rect->y;
 
-			dst += pitch;
-		}
-	}
+	R_ParallelBands(rect->y, rect->y + rect->h, RE_CopyRows, &copy);
 
 	if ((r_anisotropic->value > 0) && !fastmoving)
 	{
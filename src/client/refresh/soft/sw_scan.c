@@ -29,6 +29,38 @@
 byte	**warp_rowptr;
 int	*warp_column;
 
+/*
+=============
+D_WarpRows
+
+Warps the rows vmin to vmax - 1 of the view
+=============
+*/
+static void
+D_WarpRows(void *data, int vmin, int vmax)
+{
+	const int *turb;
+	pixel_t *dest;
+	int v;
+
+	turb = intsintable + ((int)(r_newrefdef.time*SPEED)&(CYCLE-1));
+	dest = vid_buffer + (r_newrefdef.y + vmin) * vid_buffer_width + r_newrefdef.x;
+
+	for (v=vmin ; v<vmax ; v++, dest += vid_buffer_width)
+	{
+		const int *col;
+		byte **row;
+		int u;
+
+		col = warp_column + turb[v];
+		row = warp_rowptr + v;
+		for (u=0 ; u<r_newrefdef.width ; u++)
+		{
+			dest[u] = row[turb[u]][col[u]];
+		}
+	}
+}
+
 /*
 =============
 D_WarpScreen
@@ -40,10 +72,7 @@ the sine warp, to keep the edges from wrapping
 void
 D_WarpScreen(void)
 {
-	const int *turb;
 	int w, h, u,v;
-	pixel_t *dest;
-	byte **row;
 
 	static int	cached_width, cached_height;
 
@@ -73,20 +102,7 @@ D_WarpScreen(void)
 		}
 	}
 
-	turb = intsintable + ((int)(r_newrefdef.time*SPEED)&(CYCLE-1));
-	dest = vid_buffer + r_newrefdef.y * vid_buffer_width + r_newrefdef.x;
-
-	for (v=0 ; v<h ; v++, dest += vid_buffer_width)
-	{
-		const int *col;
-
-		col = warp_column + turb[v];
-		row = warp_rowptr + v;
-		for (u=0 ; u<w ; u++)
-		{
-			dest[u] = row[turb[u]][col[u]];
-		}
-	}
+	R_ParallelBands(0, h, D_WarpRows, NULL);
 }
 
 
@@ -183,7 +199,8 @@ TurbulentPow2
 =============
 */
 void
-TurbulentPow2(espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv)
+TurbulentPow2(const espan_t *pspan, const spangrad_t *grad, float d_ziorigin,
+	float d_zistepu, float d_zistepv, int vmin, int vmax)
 {
 	float sdivzpow2stepu, tdivzpow2stepu, zipow2stepu;
 	int spanstep_shift, spanstep_value;
@@ -195,10 +212,10 @@ TurbulentPow2(espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv
 
 	r_turb_turb = sintable + ((int)(r_newrefdef.time*SPEED)&(CYCLE-1));
 
-	r_turb_pbase = (byte *)cacheblock;
+	r_turb_pbase = grad->cacheblock;
 
-	sdivzpow2stepu = d_sdivzstepu * spanstep_value;
-	tdivzpow2stepu = d_tdivzstepu * spanstep_value;
+	sdivzpow2stepu = grad->sdivzstepu * spanstep_value;
+	tdivzpow2stepu = grad->tdivzstepu * spanstep_value;
 	zipow2stepu = d_zistepu * spanstep_value;
 
 	do
@@ -207,6 +224,11 @@ TurbulentPow2(espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv
 		float sdivz, tdivz, zi, z, du, dv;
 		pixel_t	*r_turb_pdest;
 
+		if ((pspan->v < vmin) || (pspan->v >= vmax))
+		{
+			continue;
+		}
+
 		r_turb_pdest = d_viewbuffer + (vid_buffer_width * pspan->v) + pspan->u;
 
 		count = pspan->count;
@@ -215,20 +237,20 @@ TurbulentPow2(espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv
 		du = (float)pspan->u;
 		dv = (float)pspan->v;
 
-		sdivz = d_sdivzorigin + dv*d_sdivzstepv + du*d_sdivzstepu;
-		tdivz = d_tdivzorigin + dv*d_tdivzstepv + du*d_tdivzstepu;
+		sdivz = grad->sdivzorigin + dv*grad->sdivzstepv + du*grad->sdivzstepu;
+		tdivz = grad->tdivzorigin + dv*grad->tdivzstepv + du*grad->tdivzstepu;
 		zi = d_ziorigin + dv*d_zistepv + du*d_zistepu;
 		z = (float)SHIFT16XYZ_MULT / zi;	// prescale to 16.16 fixed-point
 
-		r_turb_s = (int)(sdivz * z) + sadjust;
-		if (r_turb_s > bbextents)
-			r_turb_s = bbextents;
+		r_turb_s = (int)(sdivz * z) + grad->sadjust;
+		if (r_turb_s > grad->bbextents)
+			r_turb_s = grad->bbextents;
 		else if (r_turb_s < 0)
 			r_turb_s = 0;
 
-		r_turb_t = (int)(tdivz * z) + tadjust;
-		if (r_turb_t > bbextentt)
-			r_turb_t = bbextentt;
+		r_turb_t = (int)(tdivz * z) + grad->tadjust;
+		if (r_turb_t > grad->bbextentt)
+			r_turb_t = grad->bbextentt;
 		else if (r_turb_t < 0)
 			r_turb_t = 0;
 
@@ -258,18 +280,18 @@ TurbulentPow2(espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv
 				zi += zipow2stepu;
 				z = (float)SHIFT16XYZ_MULT / zi;	// prescale to 16.16 fixed-point
 
-				snext = (int)(sdivz * z) + sadjust;
-				if (snext > bbextents)
-					snext = bbextents;
+				snext = (int)(sdivz * z) + grad->sadjust;
+				if (snext > grad->bbextents)
+					snext = grad->bbextents;
 				else if (snext < spanstep_value)
 					// prevent round-off error on <0 steps from
 					//  from causing overstepping & running off the
 					//  edge of the texture
 					snext = spanstep_value;
 
-				tnext = (int)(tdivz * z) + tadjust;
-				if (tnext > bbextentt)
-					tnext = bbextentt;
+				tnext = (int)(tdivz * z) + grad->tadjust;
+				if (tnext > grad->bbextentt)
+					tnext = grad->bbextentt;
 				else if (tnext < spanstep_value)
 					// guard against round-off error on <0 steps
 					tnext = spanstep_value;
@@ -286,22 +308,22 @@ TurbulentPow2(espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv
 				// span by division, biasing steps low so we don't run off the
 				// texture
 				spancountminus1 = (float)(r_turb_spancount - 1);
-				sdivz += d_sdivzstepu * spancountminus1;
-				tdivz += d_tdivzstepu * spancountminus1;
+				sdivz += grad->sdivzstepu * spancountminus1;
+				tdivz += grad->tdivzstepu * spancountminus1;
 				zi += d_zistepu * spancountminus1;
 				z = (float)SHIFT16XYZ_MULT / zi;	// prescale to 16.16 fixed-point
-				snext = (int)(sdivz * z) + sadjust;
-				if (snext > bbextents)
-					snext = bbextents;
+				snext = (int)(sdivz * z) + grad->sadjust;
+				if (snext > grad->bbextents)
+					snext = grad->bbextents;
 				else if (snext < spanstep_value)
 					// prevent round-off error on <0 steps from
 					//  from causing overstepping & running off the
 					//  edge of the texture
 					snext = spanstep_value;
 
-				tnext = (int)(tdivz * z) + tadjust;
-				if (tnext > bbextentt)
-					tnext = bbextentt;
+				tnext = (int)(tdivz * z) + grad->tadjust;
+				if (tnext > grad->bbextentt)
+					tnext = grad->bbextentt;
 				else if (tnext < spanstep_value)
 					// guard against round-off error on <0 steps
 					tnext = spanstep_value;
@@ -338,7 +360,8 @@ NonTurbulentPow2 - this is for drawing scrolling textures. they're warping water
 =============
 */
 void
-NonTurbulentPow2 (espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv)
+NonTurbulentPow2(const espan_t *pspan, const spangrad_t *grad, float d_ziorigin,
+	float d_zistepu, float d_zistepv, int vmin, int vmax)
 {
 	float sdivzpow2stepu, tdivzpow2stepu, zipow2stepu;
 	int spanstep_shift, spanstep_value;
@@ -350,10 +373,10 @@ NonTurbulentPow2 (espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zis
 
 	r_turb_turb = blanktable;
 
-	r_turb_pbase = (byte *)cacheblock;
+	r_turb_pbase = grad->cacheblock;
 
-	sdivzpow2stepu = d_sdivzstepu * spanstep_value;
-	tdivzpow2stepu = d_tdivzstepu * spanstep_value;
+	sdivzpow2stepu = grad->sdivzstepu * spanstep_value;
+	tdivzpow2stepu = grad->tdivzstepu * spanstep_value;
 	zipow2stepu = d_zistepu * spanstep_value;
 
 	do
@@ -362,6 +385,11 @@ NonTurbulentPow2 (espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zis
 		float sdivz, tdivz, zi, z, dv, du;
 		pixel_t	*r_turb_pdest;
 
+		if ((pspan->v < vmin) || (pspan->v >= vmax))
+		{
+			continue;
+		}
+
 		r_turb_pdest = d_viewbuffer + (vid_buffer_width * pspan->v) + pspan->u;
 
 		count = pspan->count;
@@ -370,20 +398,20 @@ NonTurbulentPow2 (espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zis
 		du = (float)pspan->u;
 		dv = (float)pspan->v;
 
-		sdivz = d_sdivzorigin + dv*d_sdivzstepv + du*d_sdivzstepu;
-		tdivz = d_tdivzorigin + dv*d_tdivzstepv + du*d_tdivzstepu;
+		sdivz = grad->sdivzorigin + dv*grad->sdivzstepv + du*grad->sdivzstepu;
+		tdivz = grad->tdivzorigin + dv*grad->tdivzstepv + du*grad->tdivzstepu;
 		zi = d_ziorigin + dv*d_zistepv + du*d_zistepu;
 		z = (float)SHIFT16XYZ_MULT / zi;	// prescale to 16.16 fixed-point
 
-		r_turb_s = (int)(sdivz * z) + sadjust;
-		if (r_turb_s > bbextents)
-			r_turb_s = bbextents;
+		r_turb_s = (int)(sdivz * z) + grad->sadjust;
+		if (r_turb_s > grad->bbextents)
+			r_turb_s = grad->bbextents;
 		else if (r_turb_s < 0)
 			r_turb_s = 0;
 
-		r_turb_t = (int)(tdivz * z) + tadjust;
-		if (r_turb_t > bbextentt)
-			r_turb_t = bbextentt;
+		r_turb_t = (int)(tdivz * z) + grad->tadjust;
+		if (r_turb_t > grad->bbextentt)
+			r_turb_t = grad->bbextentt;
 		else if (r_turb_t < 0)
 			r_turb_t = 0;
 
@@ -413,18 +441,18 @@ NonTurbulentPow2 (espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zis
 				zi += zipow2stepu;
 				z = (float)SHIFT16XYZ_MULT / zi;	// prescale to 16.16 fixed-point
 
-				snext = (int)(sdivz * z) + sadjust;
-				if (snext > bbextents)
-					snext = bbextents;
+				snext = (int)(sdivz * z) + grad->sadjust;
+				if (snext > grad->bbextents)
+					snext = grad->bbextents;
 				else if (snext < spanstep_value)
 					// prevent round-off error on <0 steps from
 					//  from causing overstepping & running off the
 					//  edge of the texture
 					snext = spanstep_value;
 
-				tnext = (int)(tdivz * z) + tadjust;
-				if (tnext > bbextentt)
-					tnext = bbextentt;
+				tnext = (int)(tdivz * z) + grad->tadjust;
+				if (tnext > grad->bbextentt)
+					tnext = grad->bbextentt;
 				else if (tnext < spanstep_value)
 					// guard against round-off error on <0 steps
 					tnext = spanstep_value;
@@ -441,22 +469,22 @@ NonTurbulentPow2 (espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zis
 				// span by division, biasing steps low so we don't run off the
 				// texture
 				spancountminus1 = (float)(r_turb_spancount - 1);
-				sdivz += d_sdivzstepu * spancountminus1;
-				tdivz += d_tdivzstepu * spancountminus1;
+				sdivz += grad->sdivzstepu * spancountminus1;
+				tdivz += grad->tdivzstepu * spancountminus1;
 				zi += d_zistepu * spancountminus1;
 				z = (float)SHIFT16XYZ_MULT / zi;	// prescale to 16.16 fixed-point
-				snext = (int)(sdivz * z) + sadjust;
-				if (snext > bbextents)
-					snext = bbextents;
+				snext = (int)(sdivz * z) + grad->sadjust;
+				if (snext > grad->bbextents)
+					snext = grad->bbextents;
 				else if (snext < spanstep_value)
 					// prevent round-off error on <0 steps from
 					//  from causing overstepping & running off the
 					//  edge of the texture
 					snext = spanstep_value;
 
-				tnext = (int)(tdivz * z) + tadjust;
-				if (tnext > bbextentt)
-					tnext = bbextentt;
+				tnext = (int)(tdivz * z) + grad->tadjust;
+				if (tnext > grad->bbextentt)
+					tnext = grad->bbextentt;
 				else if (tnext < spanstep_value)
 					// guard against round-off error on <0 steps
 					tnext = spanstep_value;
@@ -506,7 +534,8 @@ D_DrawSpan
 =============
 */
 static pixel_t *
-D_DrawSpan(pixel_t *pdest, const pixel_t *pbase, int s, int t, int sstep, int tstep, int spancount)
+D_DrawSpan(pixel_t *pdest, const pixel_t *pbase, int cachewidth, int s, int t,
+	int sstep, int tstep, int spancount)
 {
 	const pixel_t *tdest_max = pdest + spancount;
 
@@ -554,8 +583,8 @@ D_DrawSpanFiltered
 =============
 */
 static pixel_t *
-D_DrawSpanFiltered(pixel_t *pdest, pixel_t *pbase, int s, int t, int sstep, int tstep, int spancount,
-	   const espan_t *pspan)
+D_DrawSpanFiltered(pixel_t *pdest, const pixel_t *pbase, int cachewidth, int s, int t,
+	int sstep, int tstep, int spancount, const espan_t *pspan)
 {
 	do
 	{
@@ -591,10 +620,11 @@ D_DrawSpansPow2
 =============
 */
 void
-D_DrawSpansPow2(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv)
+D_DrawSpansPow2(const espan_t *pspan, const spangrad_t *grad, float d_ziorigin,
+	float d_zistepu, float d_zistepv, int vmin, int vmax)
 {
 	int 	spancount;
-	pixel_t	*pbase;
+	const pixel_t	*pbase;
 	int	snext, tnext;
 	float	sdivzpow2stepu, tdivzpow2stepu, zipow2stepu;
 	int	texture_filtering;
@@ -603,11 +633,11 @@ D_DrawSpansPow2(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d
 	spanstep_shift = D_DrawSpanGetStep(d_zistepu, d_zistepv);
 	spanstep_value = (1 << spanstep_shift);
 
-	pbase = (byte *)cacheblock;
+	pbase = grad->cacheblock;
 
 	texture_filtering = (int)sw_texture_filtering->value;
-	sdivzpow2stepu = d_sdivzstepu * spanstep_value;
-	tdivzpow2stepu = d_tdivzstepu * spanstep_value;
+	sdivzpow2stepu = grad->sdivzstepu * spanstep_value;
+	tdivzpow2stepu = grad->tdivzstepu * spanstep_value;
 	zipow2stepu = d_zistepu * spanstep_value;
 
 	do
@@ -616,6 +646,11 @@ D_DrawSpansPow2(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d
 		int	count, s, t;
 		float	sdivz, tdivz, zi, z, du, dv;
 
+		if ((pspan->v < vmin) || (pspan->v >= vmax))
+		{
+			continue;
+		}
+
 		pdest = d_viewbuffer + (vid_buffer_width * pspan->v) + pspan->u;
 
 		count = pspan->count;
@@ -624,20 +659,20 @@ D_DrawSpansPow2(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d
 		du = (float)pspan->u;
 		dv = (float)pspan->v;
 
-		sdivz = d_sdivzorigin + dv*d_sdivzstepv + du*d_sdivzstepu;
-		tdivz = d_tdivzorigin + dv*d_tdivzstepv + du*d_tdivzstepu;
+		sdivz = grad->sdivzorigin + dv*grad->sdivzstepv + du*grad->sdivzstepu;
+		tdivz = grad->tdivzorigin + dv*grad->tdivzstepv + du*grad->tdivzstepu;
 		zi = d_ziorigin + dv*d_zistepv + du*d_zistepu;
 		z = (float)SHIFT16XYZ_MULT / zi;	// prescale to 16.16 fixed-point
 
-		s = (int)(sdivz * z) + sadjust;
-		if (s > bbextents)
-			s = bbextents;
+		s = (int)(sdivz * z) + grad->sadjust;
+		if (s > grad->bbextents)
+			s = grad->bbextents;
 		else if (s < 0)
 			s = 0;
 
-		t = (int)(tdivz * z) + tadjust;
-		if (t > bbextentt)
-			t = bbextentt;
+		t = (int)(tdivz * z) + grad->tadjust;
+		if (t > grad->bbextentt)
+			t = grad->bbextentt;
 		else if (t < 0)
 			t = 0;
 
@@ -665,18 +700,18 @@ D_DrawSpansPow2(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d
 				zi += zipow2stepu;
 				z = (float)SHIFT16XYZ_MULT / zi;	// prescale to 16.16 fixed-point
 
-				snext = (int)(sdivz * z) + sadjust;
-				if (snext > bbextents)
-					snext = bbextents;
+				snext = (int)(sdivz * z) + grad->sadjust;
+				if (snext > grad->bbextents)
+					snext = grad->bbextents;
 				else if (snext < spanstep_value)
 					// prevent round-off error on <0 steps from
 					//  from causing overstepping & running off the
 					//  edge of the texture
 					snext = spanstep_value;
 
-				tnext = (int)(tdivz * z) + tadjust;
-				if (tnext > bbextentt)
-					tnext = bbextentt;
+				tnext = (int)(tdivz * z) + grad->tadjust;
+				if (tnext > grad->bbextentt)
+					tnext = grad->bbextentt;
 				else if (tnext < spanstep_value)
 					// guard against round-off error on <0 steps
 					tnext = spanstep_value;
@@ -693,22 +728,22 @@ D_DrawSpansPow2(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d
 				// span by division, biasing steps low so we don't run off the
 				// texture
 				spancountminus1 = (float)(spancount - 1);
-				sdivz += d_sdivzstepu * spancountminus1;
-				tdivz += d_tdivzstepu * spancountminus1;
+				sdivz += grad->sdivzstepu * spancountminus1;
+				tdivz += grad->tdivzstepu * spancountminus1;
 				zi += d_zistepu * spancountminus1;
 				z = (float)SHIFT16XYZ_MULT / zi;	// prescale to 16.16 fixed-point
-				snext = (int)(sdivz * z) + sadjust;
-				if (snext > bbextents)
-					snext = bbextents;
+				snext = (int)(sdivz * z) + grad->sadjust;
+				if (snext > grad->bbextents)
+					snext = grad->bbextents;
 				else if (snext < spanstep_value)
 					// prevent round-off error on <0 steps from
 					//  from causing overstepping & running off the
 					//  edge of the texture
 					snext = spanstep_value;
 
-				tnext = (int)(tdivz * z) + tadjust;
-				if (tnext > bbextentt)
-					tnext = bbextentt;
+				tnext = (int)(tdivz * z) + grad->tadjust;
+				if (tnext > grad->bbextentt)
+					tnext = grad->bbextentt;
 				else if (tnext < spanstep_value)
 					// guard against round-off error on <0 steps
 					tnext = spanstep_value;
@@ -723,13 +758,13 @@ D_DrawSpansPow2(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d
 			// Drawing phrase
 			if ((texture_filtering == 0) || fastmoving)
 			{
-				pdest = D_DrawSpan(pdest, pbase, s, t, sstep, tstep,
-						   spancount);
+				pdest = D_DrawSpan(pdest, pbase, grad->cachewidth,
+						   s, t, sstep, tstep, spancount);
 			}
 			else
 			{
-				pdest = D_DrawSpanFiltered(pdest, pbase, s, t, sstep, tstep,
-						   spancount, pspan);
+				pdest = D_DrawSpanFiltered(pdest, pbase, grad->cachewidth,
+						   s, t, sstep, tstep, spancount, pspan);
 			}
 			s = snext;
 			t = tnext;
@@ -738,13 +773,39 @@ D_DrawSpansPow2(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d
 	} while ((pspan = pspan->pnext) != NULL);
 }
 
+/*
+=============
+D_DamageZSpans
+
+Marks the z buffer under the spans that D_DrawZSpans() rewrites.
+Runs before the spans are drawn, so that the bands of a threaded
+frame only read the damaged area.
+=============
+*/
+void
+D_DamageZSpans(const espan_t *pspan)
+{
+	do
+	{
+		if (!VID_CheckDamageZBuffer(pspan->u, pspan->v, pspan->count, 0))
+		{
+			continue;
+		}
+
+		// solid map walls damage
+		VID_DamageZBuffer(pspan->u, pspan->v);
+		VID_DamageZBuffer(pspan->u + pspan->count, pspan->v);
+	} while ((pspan = pspan->pnext) != NULL);
+}
+
 /*
 =============
 D_DrawZSpans
 =============
 */
 void
-D_DrawZSpans(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv)
+D_DrawZSpans(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv,
+	int vmin, int vmax)
 {
 	zvalue_t	izistep;
 	int		safe_step;
@@ -762,15 +823,12 @@ D_DrawZSpans(const espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zi
 		float		zi;
 		float		du, dv;
 
-		if (!VID_CheckDamageZBuffer(pspan->u, pspan->v, pspan->count, 0))
+		if ((pspan->v < vmin) || (pspan->v >= vmax) ||
+			!VID_CheckDamageZBuffer(pspan->u, pspan->v, pspan->count, 0))
 		{
 			continue;
 		}
 
-		// solid map walls damage
-		VID_DamageZBuffer(pspan->u, pspan->v);
-		VID_DamageZBuffer(pspan->u + pspan->count, pspan->v);
-
 		pdest = d_pzbuffer + (vid_buffer_width * pspan->v) + pspan->u;
 
 		count = pspan->count;
@@ -305,6 +305,7 @@ R_InitCaches(void)
 	sc_base->next = NULL;
 	sc_base->owner = NULL;
 	sc_base->size = sc_size;
+	sc_base->batch = 0;
 }
 
 /*
@@ -330,6 +331,7 @@ D_FlushCaches(void)
 	sc_base->next = NULL;
 	sc_base->owner = NULL;
 	sc_base->size = sc_size;
+	sc_base->batch = 0;
 }
 
 /*
@@ -372,6 +374,7 @@ D_SCAlloc(int width, int size)
 
 	/* colect and free surfcache_t blocks until the rover block is large enough */
 	new = sc_rover;
+	D_FlushSurfJobsFor(sc_rover);
 	if (sc_rover->owner)
 	{
 		*sc_rover->owner = NULL;
@@ -388,6 +391,7 @@ D_SCAlloc(int width, int size)
 			return NULL;
 		}
 
+		D_FlushSurfJobsFor(sc_rover);
 		if (sc_rover->owner)
 		{
 			*sc_rover->owner = NULL;
@@ -405,6 +409,7 @@ D_SCAlloc(int width, int size)
 		sc_rover->next = new->next;
 		sc_rover->width = 0;
 		sc_rover->owner = NULL;
+		sc_rover->batch = 0;
 		new->next = sc_rover;
 		new->size = size;
 	}
@@ -422,6 +427,7 @@ D_SCAlloc(int width, int size)
 	}
 
 	new->owner = NULL; // should be set properly after return
+	new->batch = 0;
 
 	return new;
 }
@@ -1077,6 +1077,16 @@ Vk_LoadPic(const char *name, byte *pic, int width, int realwidth,
 	{
 		int i;
 
+		i = R_ImageHashFind(name);
+
+		if (i >= 0)
+		{
+			/* we already have such image */
+			image = &vktextures[i];
+			image->registration_sequence = registration_sequence;
+			return image;
+		}
+
 		/* find a free image_t */
 		for (i = 0, image = vktextures; i < numvktextures; i++, image++)
 		{
@@ -1084,13 +1094,6 @@ Vk_LoadPic(const char *name, byte *pic, int width, int realwidth,
 			{
 				break;
 			}
-
-			if (!strcmp(image->name, name))
-			{
-				/* we already have such image */
-				image->registration_sequence = registration_sequence;
-				return image;
-			}
 		}
 
 		if (i == numvktextures)
@@ -1113,6 +1116,7 @@ Vk_LoadPic(const char *name, byte *pic, int width, int realwidth,
 	}
 
 	strcpy(image->name, name);
+	R_ImageHashAdd(image->name, image - vktextures);
 	image->registration_sequence = registration_sequence;
 
 	// zero-clear Vulkan texture handle
@@ -1326,13 +1330,13 @@ Vk_FindImage(const char *originname, imagetype_t type)
 	namewe[len] = 0;
 
 	/* look for it */
-	for (i = 0, image = vktextures; i < numvktextures; i++, image++)
+	i = R_ImageHashFind(name);
+
+	if (i >= 0)
 	{
-		if (!strcmp(name, image->name))
-		{
-			image->registration_sequence = registration_sequence;
-			return image;
-		}
+		image = &vktextures[i];
+		image->registration_sequence = registration_sequence;
+		return image;
 	}
 
 	/*
@@ -1430,6 +1434,7 @@ Vk_FreeUnusedImages(void)
 
 		/* free it */
 		QVk_ReleaseTexture(&image->vk_texture, false);
+		R_ImageHashRemove(i);
 		memset(image, 0, sizeof(*image));
 
 		img_loaded --;
@@ -1453,6 +1458,7 @@ Vk_InitImages(void)
 	Scrap_Init();
 
 	numvktextures = 0;
+	R_ImageHashClear();
 	img_loaded = 0;
 	registration_sequence = 1;
 	image_max = 0;
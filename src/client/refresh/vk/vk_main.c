@@ -1113,6 +1113,7 @@ R_Register(void)
 	ri.Cmd_AddCommand("imagelist", Vk_ImageList_f);
 	ri.Cmd_AddCommand("screenshot", Vk_ScreenShot_f);
 	ri.Cmd_AddCommand("modellist", Mod_Modellist_f);
+	ri.Cmd_AddCommand("r_lerpbench", R_LerpBench_f);
 }
 
 /*
@@ -1259,6 +1260,7 @@ RE_Shutdown(void)
 	ri.Cmd_RemoveCommand("imagelist");
 	ri.Cmd_RemoveCommand("vk_strings");
 	ri.Cmd_RemoveCommand("vk_mem");
+	ri.Cmd_RemoveCommand("r_lerpbench");
 
 	QVk_WaitAndShutdownAll();
 
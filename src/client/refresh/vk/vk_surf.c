@@ -343,6 +343,120 @@ FlushLmChainBatch(int *pos_vect, int *index_pos)
 	*index_pos = 0;
 }
 
+/*
+ * Returns true if the lightmap of the surface changed, is_static
+ * is set if it goes into its own lightmap and not the dynamic one.
+ */
+static qboolean
+Vk_DynamicLightmap(const msurface_t *s, qboolean *is_static)
+{
+	int map;
+
+	if (!r_dynamic->value ||
+		(s->texinfo->flags & (SURF_SKY | SURF_TRANSPARENT | SURF_WARP)))
+	{
+		return false;
+	}
+
+	for (map = 0; map < MAXLIGHTMAPS && s->styles[map] != 255; map++)
+	{
+		if (r_newrefdef.lightstyles[s->styles[map]].white !=
+				s->cached_light[map])
+		{
+			break;
+		}
+	}
+
+	if ((map == MAXLIGHTMAPS || s->styles[map] == 255) &&
+		(s->dlightframe != r_framecount))
+	{
+		return false;
+	}
+
+	if (is_static)
+	{
+		*is_static = map < MAXLIGHTMAPS &&
+			(s->styles[map] >= 32 || s->styles[map] == 0) &&
+			(s->dlightframe != r_framecount);
+	}
+
+	return true;
+}
+
+/*
+ * Builds the changed lightmaps of the texture chains on the
+ * worker threads, one after the other into a temporary buffer.
+ * DrawLightmappedChains() uploads them in the same order.
+ */
+static const byte *
+Vk_BuildChainLightmaps(void)
+{
+	size_t size, offset;
+	msurface_t *s;
+	image_t *image;
+	byte *temp;
+	int i;
+
+	size = 0;
+
+	for (i = 0, image = vktextures; i < numvktextures; i++, image++)
+	{
+		if (!image->registration_sequence)
+		{
+			continue;
+		}
+
+		for (s = image->texturechain; s; s = s->texturechain)
+		{
+			if ((s->flags & SURF_DRAWTURB) || !s->polys ||
+				!Vk_DynamicLightmap(s, NULL))
+			{
+				continue;
+			}
+
+			size += ((s->extents[0] >> s->lmshift) + 1) *
+				((s->extents[1] >> s->lmshift) + 1) * LIGHTMAP_BYTES;
+		}
+	}
+
+	if (!size)
+	{
+		return NULL;
+	}
+
+	temp = R_GetTemporaryLMBuffer(size);
+	offset = 0;
+
+	for (i = 0, image = vktextures; i < numvktextures; i++, image++)
+	{
+		if (!image->registration_sequence)
+		{
+			continue;
+		}
+
+		for (s = image->texturechain; s; s = s->texturechain)
+		{
+			int smax, tmax;
+
+			if ((s->flags & SURF_DRAWTURB) || !s->polys ||
+				!Vk_DynamicLightmap(s, NULL))
+			{
+				continue;
+			}
+
+			smax = (s->extents[0] >> s->lmshift) + 1;
+			tmax = (s->extents[1] >> s->lmshift) + 1;
+
+			R_QueueLightMap(s, temp + offset, smax * LIGHTMAP_BYTES);
+			offset += smax * tmax * LIGHTMAP_BYTES;
+		}
+	}
+
+	R_BuildQueuedLightMaps(&r_newrefdef, r_modulate->value, NULL, NULL);
+
+	return temp;
+}
+
 /*
    ================
    DrawLightmappedChains
@@ -357,12 +471,15 @@ DrawLightmappedChains(const entity_t *currententity)
 	int i;
 	msurface_t *s;
 	image_t *image;
+	const byte *lightmaps;
 
 	struct {
 		float model[16];
 		float viewLightmaps;
 	} lmapPolyUbo;
 
+	lightmaps = Vk_BuildChainLightmaps();
+
 	lmapPolyUbo.viewLightmaps = r_lightmap->value ? 1.f : 0.f;
 	Mat_Identity(lmapPolyUbo.model);
 
@@ -393,8 +510,7 @@ DrawLightmappedChains(const entity_t *currententity)
 
 		for (s = image->texturechain; s; s = s->texturechain)
 		{
-			int map;
-			qboolean is_dynamic = false;
+			qboolean is_static;
 			unsigned lmtex;
 			float sscroll, tscroll;
 			const mpoly_t *p;
@@ -411,45 +527,14 @@ DrawLightmappedChains(const entity_t *currententity)
 
 			lmtex = s->lightmaptexturenum;
 
-			/* check for dynamic lightmap */
-			for (map = 0; map < MAXLIGHTMAPS && s->styles[map] != 255; map++)
+			if (Vk_DynamicLightmap(s, &is_static))
 			{
-				if (r_newrefdef.lightstyles[s->styles[map]].white !=
-						s->cached_light[map])
-				{
-					goto dynamic;
-				}
-			}
-
-			if (s->dlightframe == r_framecount)
-			{
-dynamic:
-				if (r_dynamic->value)
-				{
-					if (!(s->texinfo->flags &
-								(SURF_SKY | SURF_TRANSPARENT | SURF_WARP)))
-					{
-						is_dynamic = true;
-					}
-				}
-			}
-
-			if (is_dynamic)
-			{
-				int smax, tmax, size;
-				byte *temp;
+				int smax, tmax;
 
 				smax = (s->extents[0] >> s->lmshift) + 1;
 				tmax = (s->extents[1] >> s->lmshift) + 1;
 
-				size = smax * tmax * LIGHTMAP_BYTES;
-				temp = R_GetTemporaryLMBuffer(size);
-
-				R_BuildLightMap(s, temp, smax * 4,
-						&r_newrefdef, r_modulate->value, NULL, NULL);
-
-				if (map < MAXLIGHTMAPS && (s->styles[map] >= 32 || s->styles[map] == 0) &&
-						(s->dlightframe != r_framecount))
+				if (is_static)
 				{
 					R_SetCacheState(s, &r_newrefdef);
 					lmtex = s->lightmaptexturenum;
@@ -459,10 +544,12 @@ dynamic:
 					lmtex = s->lightmaptexturenum + DYNLIGHTMAP_OFFSET;
 				}
 
+				/* built by Vk_BuildChainLightmaps() in this order */
 				QVk_UpdateTextureData(
 						&vk_state.lightmap_textures[lmtex],
-						(byte*)temp, s->light_s, s->light_t,
+						lightmaps, s->light_s, s->light_t,
 						smax, tmax);
+				lightmaps += smax * tmax * LIGHTMAP_BYTES;
 			}
 
 			/* lightmap changed — flush current batch and rebind */
@@ -131,7 +131,7 @@ typedef enum {
 	RESTART_PARTIAL
 } ref_restart_t;
 
-#define	API_VERSION		8
+#define	API_VERSION		11
 #define EXPORT
 #define IMPORT
 
@@ -277,6 +277,20 @@ typedef struct
 	/* Rerelease: Get file from cache/converted */
 	int (IMPORT *Mod_LoadFile)(const char *path, void **buffer);
 	void (IMPORT *Mod_FreeFile)(const char *path);
+
+	/* worker threads of the engine, see Sys_ParallelFor() */
+	int (IMPORT *Sys_NumWorkers)(void);
+	void (IMPORT *Sys_ParallelFor)(int count,
+		void (*func)(void *data, int index, int worker), void *data);
+
+	/* decode tga, png and jpg files on the worker threads */
+	void (IMPORT *VID_ImagesDecode)(int count, const char **filenames,
+		byte **pics, int *widths, int *heights);
+
+	/* block compressed mip chain of a 32 bit texture, from the texture cache */
+	qboolean (IMPORT *VID_ImageCompress)(const char *name, const byte *pic,
+		int width, int height, compimage_t *image);
+	void (IMPORT *VID_ImageCompressFree)(compimage_t *image);
 } refimport_t;
 
 // this is the only function actually exported at the linker level
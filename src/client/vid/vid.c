@@ -459,6 +459,11 @@ VID_LoadRenderer(void)
 	rimport.VID_GetPalette = VID_GetPalette;
 	rimport.VID_GetPalette24to8 = VID_GetPalette24to8;
 	rimport.Vid_RequestRestart = VID_RequestRestart;
+	rimport.Sys_NumWorkers = Sys_NumWorkers;
+	rimport.Sys_ParallelFor = Sys_ParallelFor;
+	rimport.VID_ImagesDecode = Mod_DecodeImages;
+	rimport.VID_ImageCompress = Mod_CompressImage;
+	rimport.VID_ImageCompressFree = Mod_FreeCompressedImage;
 
 	// Exchange our export struct with the renderers import struct.
 	re = GetRefAPI(rimport);
@@ -700,7 +705,9 @@ R_RenderFrame(refdef_t *fd)
 {
 	if (ref_active)
 	{
+		PROF_BEGIN("R_RenderFrame");
 		re.RenderFrame(fd);
+		PROF_END();
 	}
 }
 
@@ -32,23 +32,29 @@
 
 #define MAX_ALIAS_NAME 32
 #define ALIAS_LOOP_COUNT 16
+#define CMD_HASH_SIZE 512 /* Power of two */
 
 typedef struct cmd_function_s
 {
 	struct cmd_function_s *next;
+	struct cmd_function_s *hash_next;
 	const char *name;
 	xcommand_t function;
 } cmd_function_t;
 
 static cmd_function_t *cmd_functions; /* possible commands to execute */
+static cmd_function_t *cmd_hash[CMD_HASH_SIZE];
 
 typedef struct cmdalias_s
 {
 	struct cmdalias_s *next;
+	struct cmdalias_s *hash_next;
 	char name[MAX_ALIAS_NAME];
 	char *value;
 } cmdalias_t;
 
+static cmdalias_t *cmd_alias_hash[CMD_HASH_SIZE];
+
 char retval[256];
 int alias_count; /* for detecting runaway loops */
 cmdalias_t *cmd_alias;
@@ -428,6 +434,47 @@ Cmd_Echo_f(void)
 	Com_Printf("\n");
 }
 
+/*
+ * Command and alias names are hashed case insensitive, so
+ * the same buckets serve Cmd_ExecuteString() and Cmd_Exists().
+ */
+static cmd_function_t *
+Cmd_FindCommand(const char *cmd_name, qboolean nocase)
+{
+	cmd_function_t *cmd;
+
+	cmd = cmd_hash[Q_strcasehash(cmd_name) & (CMD_HASH_SIZE - 1)];
+
+	for (; cmd; cmd = cmd->hash_next)
+	{
+		if (nocase ? !Q_strcasecmp(cmd_name, cmd->name) :
+			!strcmp(cmd_name, cmd->name))
+		{
+			return cmd;
+		}
+	}
+
+	return NULL;
+}
+
+static cmdalias_t *
+Cmd_FindAlias(const char *name, qboolean nocase)
+{
+	cmdalias_t *a;
+
+	a = cmd_alias_hash[Q_strcasehash(name) & (CMD_HASH_SIZE - 1)];
+
+	for (; a; a = a->hash_next)
+	{
+		if (nocase ? !Q_strcasecmp(name, a->name) : !strcmp(name, a->name))
+		{
+			return a;
+		}
+	}
+
+	return NULL;
+}
+
 /*
  * Creates a new command that executes
  * a command string (possibly ; seperated)
@@ -461,23 +508,26 @@ Cmd_Alias_f(void)
 	}
 
 	/* if the alias already exists, reuse it */
-	for (a = cmd_alias; a; a = a->next)
+	a = Cmd_FindAlias(s, false);
+
+	if (a)
 	{
-		if (!strcmp(s, a->name))
-		{
-			Z_Free(a->value);
-			break;
-		}
+		Z_Free(a->value);
 	}
-
-	if (!a)
+	else
 	{
+		cmdalias_t **bucket;
+
 		a = Z_Malloc(sizeof(cmdalias_t));
 		a->next = cmd_alias;
 		cmd_alias = a;
-	}
 
-	strcpy(a->name, s);
+		strcpy(a->name, s);
+
+		bucket = &cmd_alias_hash[Q_strcasehash(a->name) & (CMD_HASH_SIZE - 1)];
+		a->hash_next = *bucket;
+		*bucket = a;
+	}
 
 	/* copy the rest of the command line */
 	cmd[0] = 0; /* start out with a null string */
@@ -716,13 +766,10 @@ Cmd_AddCommand(const char *cmd_name, xcommand_t function)
 	}
 
 	/* fail if the command already exists */
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	if (Cmd_FindCommand(cmd_name, false))
 	{
-		if (!strcmp(cmd_name, cmd->name))
-		{
-			Com_Printf("Cmd_AddCommand: %s already defined\n", cmd_name);
-			return;
-		}
+		Com_Printf("Cmd_AddCommand: %s already defined\n", cmd_name);
+		return;
 	}
 
 	cmd = Z_Malloc(sizeof(cmd_function_t));
@@ -737,6 +784,10 @@ Cmd_AddCommand(const char *cmd_name, xcommand_t function)
 	}
 	cmd->next = *pos;
 	*pos = cmd;
+
+	pos = &cmd_hash[Q_strcasehash(cmd->name) & (CMD_HASH_SIZE - 1)];
+	cmd->hash_next = *pos;
+	*pos = cmd;
 }
 
 void
@@ -744,43 +795,34 @@ Cmd_RemoveCommand(const char *cmd_name)
 {
 	cmd_function_t *cmd, **back;
 
-	back = &cmd_functions;
+	cmd = Cmd_FindCommand(cmd_name, false);
 
-	while (1)
+	if (!cmd)
 	{
-		cmd = *back;
+		Com_Printf("Cmd_RemoveCommand: %s not added\n", cmd_name);
+		return;
+	}
 
-		if (!cmd)
-		{
-			Com_Printf("Cmd_RemoveCommand: %s not added\n", cmd_name);
-			return;
-		}
+	for (back = &cmd_functions; *back != cmd; back = &(*back)->next)
+	{
+	}
 
-		if (!strcmp(cmd_name, cmd->name))
-		{
-			*back = cmd->next;
-			Z_Free(cmd);
-			return;
-		}
+	*back = cmd->next;
 
-		back = &cmd->next;
+	for (back = &cmd_hash[Q_strcasehash(cmd->name) & (CMD_HASH_SIZE - 1)];
+		*back != cmd; back = &(*back)->hash_next)
+	{
 	}
+
+	*back = cmd->hash_next;
+
+	Z_Free(cmd);
 }
 
 qboolean
 Cmd_Exists(const char *cmd_name)
 {
-	const cmd_function_t *cmd;
-
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
-	{
-		if (!strcmp(cmd_name, cmd->name))
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return Cmd_FindCommand(cmd_name, false) != NULL;
 }
 
 const char *
@@ -1048,25 +1090,12 @@ Cmd_CompleteMapCommand(const char *partial)
 qboolean
 Cmd_IsComplete(const char *command)
 {
-	const cmd_function_t *cmd;
-	const cmdalias_t *a;
 	const cvar_t *cvar;
 
 	/* check for exact match */
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
-	{
-		if (!strcmp(command, cmd->name))
-		{
-			return true;
-		}
-	}
-
-	for (a = cmd_alias; a; a = a->next)
+	if (Cmd_FindCommand(command, false) || Cmd_FindAlias(command, false))
 	{
-		if (!strcmp(command, a->name))
-		{
-			return true;
-		}
+		return true;
 	}
 
 	for (cvar = cvar_vars; cvar; cvar = cvar->next)
@@ -1107,38 +1136,36 @@ Cmd_ExecuteString(char *text)
 	}
 
 	/* check functions */
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	cmd = Cmd_FindCommand(cmd_argv[0], true);
+
+	if (cmd)
 	{
-		if (!Q_strcasecmp(cmd_argv[0], cmd->name))
+		if (!cmd->function)
 		{
-			if (!cmd->function)
-			{
-				/* forward to server command */
-				Cmd_ExecuteString(va("cmd %s", text));
-			}
-			else
-			{
-				cmd->function();
-			}
-
-			return;
+			/* forward to server command */
+			Cmd_ExecuteString(va("cmd %s", text));
 		}
+		else
+		{
+			cmd->function();
+		}
+
+		return;
 	}
 
 	/* check alias */
-	for (a = cmd_alias; a; a = a->next)
+	a = Cmd_FindAlias(cmd_argv[0], true);
+
+	if (a)
 	{
-		if (!Q_strcasecmp(cmd_argv[0], a->name))
+		if (++alias_count == ALIAS_LOOP_COUNT)
 		{
-			if (++alias_count == ALIAS_LOOP_COUNT)
-			{
-				Com_Printf("ALIAS_LOOP_COUNT\n");
-				return;
-			}
-
-			Cbuf_InsertText(a->value);
+			Com_Printf("ALIAS_LOOP_COUNT\n");
 			return;
 		}
+
+		Cbuf_InsertText(a->value);
+		return;
 	}
 
 	/* check cvars */
@@ -1193,4 +1220,6 @@ Cmd_Shutdown(void)
 		Z_Free(cmd_alias);
 		cmd_alias = next;
 	}
+
+	memset(cmd_alias_hash, 0, sizeof(cmd_alias_hash));
 }
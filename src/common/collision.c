@@ -136,6 +136,47 @@ static size_t pxsrow_len = 0;
 #define CLUSTER_NOT_CACHED -2
 static int cached_pvs_cluster = CLUSTER_NOT_CACHED;
 static int cached_phs_cluster = CLUSTER_NOT_CACHED;
+
+/* Decompressed PVS and PHS rows of the current map. Row
+   cluster * 2 + DVIS_PVS / DVIS_PHS. Either all rows are
+   kept or a least recently used subset of them. */
+typedef struct
+{
+	byte *rows;
+	size_t rowsize; /* multiple of 8 bytes */
+	int numrows;
+	qboolean full;
+	/* LRU only, list of slots with the newest at head */
+	int *slotofrow;
+	int *rowofslot;
+	int *prev, *next;
+	int head, tail;
+	/* statistics */
+	unsigned int hits, misses;
+	long long decodetime;
+} cmviscache_t;
+
+static cmviscache_t cm_viscache;
+static cvar_t *cm_viscache_size;
+
+/* Maps converted by Mod_Load2QBSP() are kept in mapcache/ in the
+   game directory, so the next load can map them directly. */
+#define MAPCACHE_IDENT (('C' << 24) + ('P' << 16) + ('B' << 8) + 'Q') /* "QBPC" */
+#define MAPCACHE_VERSION 2 /* bump when the output of Mod_Load2QBSP() changes */
+
+typedef struct
+{
+	int ident;
+	int version;
+	int checksum;       /* of the source file */
+	int filelen;        /* of the source file */
+	int maptype;        /* the maptype cvar when converting */
+	int outmaptype;     /* what Mod_Load2QBSP() detected */
+	int length;         /* of the converted map following the header */
+	int materials;      /* of the textures/<name>.mat files baked in */
+} mapcacheheader_t;
+
+static cvar_t *cm_mapcache;
 static cbrush_t *box_brush;
 static cleaf_t *box_leaf;
 static cplane_t *box_planes = NULL;
@@ -145,7 +186,6 @@ static cvar_t *r_game;
 static int box_headnode;
 static int checkcount;
 static int floodvalid;
-static int leaf_topnode;
 static int trace_contents;
 static mapsurface_t nullsurface;
 static qboolean trace_ispoint; /* optimized case */
@@ -534,7 +574,7 @@ CM_PointLeafnum(const vec3_t p)
  */
 static void
 CM_BoxLeafnums_r(int nodenum, vec3_t leaf_mins, vec3_t leaf_maxs,
-	int *leaf_list, int *leaf_count, int leaf_maxcount)
+	int *leaf_list, int *leaf_count, int leaf_maxcount, int *leaf_topnode)
 {
 	while (1)
 	{
@@ -573,13 +613,13 @@ CM_BoxLeafnums_r(int nodenum, vec3_t leaf_mins, vec3_t leaf_maxs,
 		else
 		{
 			/* go down both */
-			if (leaf_topnode == -1)
+			if (*leaf_topnode == -1)
 			{
-				leaf_topnode = nodenum;
+				*leaf_topnode = nodenum;
 			}
 
 			CM_BoxLeafnums_r(node->children[0], leaf_mins, leaf_maxs, leaf_list,
-				leaf_count, leaf_maxcount);
+				leaf_count, leaf_maxcount, leaf_topnode);
 			nodenum = node->children[1];
 		}
 	}
@@ -590,11 +630,10 @@ CM_BoxLeafnums_headnode(vec3_t leaf_mins, vec3_t leaf_maxs, int *leaf_list,
 		int leaf_maxcount, int headnode, int *topnode)
 {
 	int leaf_count = 0;
-
-	leaf_topnode = -1;
+	int leaf_topnode = -1;
 
 	CM_BoxLeafnums_r(headnode, leaf_mins, leaf_maxs, leaf_list,
-		&leaf_count, leaf_maxcount);
+		&leaf_count, leaf_maxcount, &leaf_topnode);
 
 	if (topnode)
 	{
@@ -1781,6 +1820,511 @@ CMod_LoadEntityString(const char *name, const char **map_entitystring, int *nume
 	*map_entitystring = (const char *)cmod_base + l->fileofs;
 }
 
+static void
+CM_FreeVisCache(void)
+{
+	free(cm_viscache.rows);
+	free(cm_viscache.slotofrow);
+	free(cm_viscache.rowofslot);
+	free(cm_viscache.prev);
+	free(cm_viscache.next);
+
+	memset(&cm_viscache, 0, sizeof(cm_viscache));
+}
+
+static void
+CM_DecompressVisRow(int row, byte *out)
+{
+	long long start;
+
+	start = Sys_Microseconds();
+
+	Mod_DecompressVis((byte *)cmod->map_vis +
+			cmod->map_vis->bitofs[row >> 1][row & 1], out,
+			(byte *)cmod->map_vis + cmod->numvisibility,
+			(cmod->numclusters + 7) >> 3);
+
+	cm_viscache.decodetime += Sys_Microseconds() - start;
+}
+
+/*
+ * Decompresses all PVS and PHS rows of the current map if they
+ * fit into cm_viscache KiB, otherwise sets up that much space
+ * for recently used rows.
+ */
+static void
+CM_InitVisCache(void)
+{
+	size_t budget, total;
+	int i, numrows;
+
+	CM_FreeVisCache();
+
+	if (!cmod->map_vis || (cmod->numclusters <= 0) ||
+		(cm_viscache_size->value <= 0))
+	{
+		return;
+	}
+
+	budget = (size_t)cm_viscache_size->value * 1024;
+	numrows = cmod->numclusters * 2;
+	cm_viscache.rowsize = ((cmod->numclusters + 63) & ~63) / 8;
+	total = cm_viscache.rowsize * numrows;
+
+	cm_viscache.full = (total <= budget);
+
+	if (!cm_viscache.full)
+	{
+		numrows = Q_max(budget / cm_viscache.rowsize, 2);
+	}
+
+	cm_viscache.numrows = numrows;
+	cm_viscache.rows = calloc(numrows, cm_viscache.rowsize);
+	YQ2_COM_CHECK_OOM(cm_viscache.rows, "calloc()",
+		numrows * cm_viscache.rowsize)
+	if (!cm_viscache.rows)
+	{
+		/* unaware about YQ2_ATTR_NORETURN_FUNCPTR? */
+		return;
+	}
+
+	if (cm_viscache.full)
+	{
+		for (i = 0; i < numrows; i++)
+		{
+			CM_DecompressVisRow(i, cm_viscache.rows + i * cm_viscache.rowsize);
+		}
+
+		return;
+	}
+
+	cm_viscache.slotofrow = malloc(cmod->numclusters * 2 * sizeof(int));
+	cm_viscache.rowofslot = malloc(numrows * sizeof(int));
+	cm_viscache.prev = malloc(numrows * sizeof(int));
+	cm_viscache.next = malloc(numrows * sizeof(int));
+
+	if (!cm_viscache.slotofrow || !cm_viscache.rowofslot ||
+		!cm_viscache.prev || !cm_viscache.next)
+	{
+		CM_FreeVisCache();
+		Com_Error(ERR_FATAL, "%s: can't allocate LRU of %d rows",
+			__func__, numrows);
+		return;
+	}
+
+	memset(cm_viscache.slotofrow, 0xff, cmod->numclusters * 2 * sizeof(int));
+
+	for (i = 0; i < numrows; i++)
+	{
+		cm_viscache.rowofslot[i] = -1;
+		cm_viscache.prev[i] = i - 1;
+		cm_viscache.next[i] = (i + 1 < numrows) ? i + 1 : -1;
+	}
+
+	cm_viscache.head = 0;
+	cm_viscache.tail = numrows - 1;
+}
+
+/*
+ * Returns the decompressed row of cluster from the cache,
+ * NULL if there's no cache for the current map.
+ */
+static const byte *
+CM_CachedCluster(int cluster, int type, size_t *size)
+{
+	int row, slot;
+
+	if (!cm_viscache.rows || (cluster < 0) || (cluster >= cmod->numclusters))
+	{
+		return NULL;
+	}
+
+	row = cluster * 2 + type;
+	*size = cm_viscache.rowsize;
+
+	if (cm_viscache.full)
+	{
+		cm_viscache.hits++;
+		return cm_viscache.rows + row * cm_viscache.rowsize;
+	}
+
+	slot = cm_viscache.slotofrow[row];
+
+	if (slot >= 0)
+	{
+		cm_viscache.hits++;
+	}
+	else
+	{
+		/* reuse the oldest slot */
+		slot = cm_viscache.tail;
+
+		if (cm_viscache.rowofslot[slot] >= 0)
+		{
+			cm_viscache.slotofrow[cm_viscache.rowofslot[slot]] = -1;
+		}
+
+		cm_viscache.rowofslot[slot] = row;
+		cm_viscache.slotofrow[row] = slot;
+
+		CM_DecompressVisRow(row, cm_viscache.rows + slot * cm_viscache.rowsize);
+		cm_viscache.misses++;
+	}
+
+	/* move to head */
+	if (slot != cm_viscache.head)
+	{
+		int prev, next;
+
+		prev = cm_viscache.prev[slot];
+		next = cm_viscache.next[slot];
+
+		cm_viscache.next[prev] = next;
+
+		if (next >= 0)
+		{
+			cm_viscache.prev[next] = prev;
+		}
+		else
+		{
+			cm_viscache.tail = prev;
+		}
+
+		cm_viscache.prev[slot] = -1;
+		cm_viscache.next[slot] = cm_viscache.head;
+		cm_viscache.prev[cm_viscache.head] = slot;
+		cm_viscache.head = slot;
+	}
+
+	return cm_viscache.rows + slot * cm_viscache.rowsize;
+}
+
+static void
+CM_VisStats_f(void)
+{
+	unsigned int lookups;
+
+	if (!cm_viscache.rows)
+	{
+		Com_Printf("PVS/PHS cache is disabled or no map is loaded.\n");
+		return;
+	}
+
+	lookups = cm_viscache.hits + cm_viscache.misses;
+
+	Com_Printf("PVS/PHS %s: %d rows of " YQ2_COM_PRIdS " bytes, %d clusters\n",
+		cm_viscache.full ? "matrix" : "LRU cache", cm_viscache.numrows,
+		cm_viscache.rowsize, cmod->numclusters);
+	Com_Printf("%u lookups, %u hits, %u misses, %.1f%% hit rate\n",
+		lookups, cm_viscache.hits, cm_viscache.misses,
+		lookups ? cm_viscache.hits * 100.0 / lookups : 0.0);
+	Com_Printf("%.3f ms spent decompressing\n",
+		cm_viscache.decodetime / 1000.0);
+}
+
+static void
+CM_MapCacheName(const char *name, char *out, size_t size)
+{
+	char base[MAX_QPATH];
+
+	COM_StripExtension(name, base);
+	Com_sprintf(out, size, "mapcache/%s.qbsp", base);
+}
+
+/*
+ * Checksums the textures/<name>.mat files Mod_Load2QBSP() copies into
+ * the texinfos of a converted map, missing ones included. They may
+ * come from another game directory or pack than the map itself. Maps
+ * use a texture in many texinfos, each one is only loaded once.
+ */
+static int
+CM_MapCacheMaterials(const byte *map, size_t length)
+{
+	typedef struct
+	{
+		const xtexinfo_t *texinfo; /* NULL for empty slots */
+		unsigned checksum;
+	} matslot_t;
+
+	const dheader_t *header;
+	const xtexinfo_t *texinfos, *in;
+	matslot_t *slots;
+	unsigned materials;
+	size_t i, count, numslots;
+
+	header = (const dheader_t *)map;
+
+	if ((header->lumps[LUMP_TEXINFO].fileofs < 0) ||
+		(header->lumps[LUMP_TEXINFO].filelen < 0) ||
+		((size_t)header->lumps[LUMP_TEXINFO].fileofs +
+			header->lumps[LUMP_TEXINFO].filelen > length))
+	{
+		return 0;
+	}
+
+	texinfos = (const xtexinfo_t *)(map + header->lumps[LUMP_TEXINFO].fileofs);
+	count = header->lumps[LUMP_TEXINFO].filelen / sizeof(xtexinfo_t);
+
+	/* open addressing, at most half full */
+	numslots = 1;
+
+	while (numslots < count * 2)
+	{
+		numslots <<= 1;
+	}
+
+	slots = calloc(numslots, sizeof(*slots));
+
+	if (!slots)
+	{
+		Com_Error(ERR_FATAL, "%s: can't allocate %d slots",
+			__func__, (int)numslots);
+		return 0;
+	}
+
+	materials = 0;
+
+	for (i = 0, in = texinfos; i < count; i++, in++)
+	{
+		char material_path[80];
+		matslot_t *slot;
+		size_t h;
+
+		materials *= 33;
+
+		if (!in->texture[0])
+		{
+			continue;
+		}
+
+		snprintf(material_path, sizeof(material_path), "textures/%.*s.mat",
+			(int)sizeof(in->texture), in->texture);
+
+		h = Q_strcasehash(material_path) & (numslots - 1);
+
+		while (slots[h].texinfo && strncmp(slots[h].texinfo->texture,
+				in->texture, sizeof(in->texture)))
+		{
+			h = (h + 1) & (numslots - 1);
+		}
+
+		slot = &slots[h];
+
+		if (!slot->texinfo)
+		{
+			byte *raw;
+			int len;
+
+			slot->texinfo = in;
+			slot->checksum = 0;
+
+			len = FS_LoadFile(material_path, (void **)&raw);
+			if (len > 0)
+			{
+				/* only that much ends up in the map */
+				len = Q_min(sizeof(in->material) - 1, len);
+				slot->checksum = Com_BlockChecksum(raw, len) | 1;
+
+				FS_FreeFile(raw);
+			}
+		}
+
+		materials ^= slot->checksum;
+	}
+
+	free(slots);
+
+	return (int)materials;
+}
+
+/*
+ * Returns the mapped cache file of a map if it was converted from
+ * the same file with the same maptype and materials, NULL otherwise.
+ * The converted map follows the header. Only the cache in the game
+ * directory is used, that's the one CM_WriteMapCache() updates.
+ */
+static const byte *
+CM_ReadMapCache(const char *name, int checksum, int filelen,
+	maptype_t *maptype, size_t *length)
+{
+	const mapcacheheader_t *header;
+	char cachename[MAX_QPATH];
+	const byte *buf;
+	int size;
+
+	if (!cm_mapcache->value)
+	{
+		return NULL;
+	}
+
+	CM_MapCacheName(name, cachename, sizeof(cachename));
+	size = FS_MapGamedirFile(cachename, (const void **)&buf);
+
+	if (!buf)
+	{
+		return NULL;
+	}
+
+	header = (const mapcacheheader_t *)buf;
+
+	if ((size < (int)sizeof(*header)) ||
+		(header->ident != MAPCACHE_IDENT) ||
+		(header->version != MAPCACHE_VERSION) ||
+		(header->checksum != checksum) ||
+		(header->filelen != filelen) ||
+		(header->maptype != *maptype) ||
+		(header->length != size - (int)sizeof(*header)) ||
+		(header->materials != CM_MapCacheMaterials(buf + sizeof(*header),
+			header->length)))
+	{
+		Com_DPrintf("%s: %s is outdated\n", __func__, cachename);
+		FS_UnmapFile(buf);
+		return NULL;
+	}
+
+	*maptype = header->outmaptype;
+	*length = header->length;
+
+	return buf;
+}
+
+static void
+CM_WriteMapCache(const char *name, int checksum, int filelen,
+	maptype_t maptype, maptype_t outmaptype, const byte *data, size_t length)
+{
+	char cachename[MAX_QPATH], path[MAX_OSPATH], tmppath[MAX_OSPATH];
+	mapcacheheader_t header;
+	qboolean ok;
+	FILE *f;
+
+	if (!cm_mapcache->value)
+	{
+		return;
+	}
+
+	CM_MapCacheName(name, cachename, sizeof(cachename));
+	Com_sprintf(path, sizeof(path), "%s/%s", FS_Gamedir(), cachename);
+	Com_sprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+
+	FS_CreatePath(tmppath);
+	f = Q_fopen(tmppath, "wb");
+
+	if (!f)
+	{
+		Com_DPrintf("%s: Couldn't write %s\n", __func__, tmppath);
+		return;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.ident = MAPCACHE_IDENT;
+	header.version = MAPCACHE_VERSION;
+	header.checksum = checksum;
+	header.filelen = filelen;
+	header.maptype = maptype;
+	header.outmaptype = outmaptype;
+	header.length = (int)length;
+	header.materials = CM_MapCacheMaterials(data, length);
+
+	ok = (fwrite(&header, sizeof(header), 1, f) == 1) &&
+		(fwrite(data, length, 1, f) == 1);
+	ok = (fclose(f) == 0) && ok;
+
+	if (!ok || FS_ReplaceFile(tmppath, path))
+	{
+		Com_DPrintf("%s: Couldn't write %s\n", __func__, path);
+		Sys_Remove(tmppath);
+	}
+}
+
+/*
+ * Converts a map to the QBSP layout or takes it from the map cache.
+ * Returns the converted map and the buffer to release with
+ * FS_UnmapFile() if it came from the cache, NULL otherwise.
+ */
+static byte *
+CM_ConvertMap(const char *name, const byte *filebuf, int filelen,
+	int checksum, size_t *length, const byte **cachebuf)
+{
+	maptype_t maptype, outmaptype;
+	byte *converted;
+
+	/* Can't detect will use provided */
+	maptype = r_maptype->value;
+	outmaptype = maptype;
+
+	*cachebuf = CM_ReadMapCache(name, checksum, filelen, &outmaptype, length);
+
+	if (*cachebuf)
+	{
+		Com_DPrintf("%s: Using the converted %s from the map cache\n",
+			__func__, name);
+		return (byte *)*cachebuf + sizeof(mapcacheheader_t);
+	}
+
+	converted = Mod_Load2QBSP(name, filebuf, filelen, length, &outmaptype);
+	CM_WriteMapCache(name, checksum, filelen, maptype, outmaptype,
+		converted, *length);
+
+	return converted;
+}
+
+/*
+ * Fills the map cache with all maps, so that
+ * none of them has to be converted when loaded.
+ */
+static void
+CM_MapCacheBuild_f(void)
+{
+	int i, converted, cached, failed;
+	strlist_t maps;
+
+	if (!cm_mapcache->value)
+	{
+		Com_Printf("The map cache is disabled, set cm_mapcache to 1.\n");
+		return;
+	}
+
+	maps = FS_ListFiles2("maps/*.bsp", 0, 0);
+	converted = cached = failed = 0;
+
+	for (i = 0; i < maps.num; i++)
+	{
+		const byte *filebuf, *cachebuf;
+		size_t length;
+		byte *data;
+		int filelen;
+
+		filelen = FS_MapFile(maps.data[i], (const void **)&filebuf);
+
+		if (!filebuf || filelen <= 0)
+		{
+			failed++;
+			continue;
+		}
+
+		data = CM_ConvertMap(maps.data[i], filebuf, filelen,
+			LittleLong(Com_BlockChecksum(filebuf, filelen)), &length,
+			&cachebuf);
+		FS_UnmapFile(filebuf);
+
+		if (cachebuf)
+		{
+			FS_UnmapFile(cachebuf);
+			cached++;
+		}
+		else
+		{
+			free(data);
+			converted++;
+		}
+	}
+
+	StrList_Free(&maps);
+
+	Com_Printf("%i maps converted, %i already cached, %i unreadable.\n",
+		converted, cached, failed);
+}
+
 static void
 CM_ModFree(model_t *cmod)
 {
@@ -1806,6 +2350,11 @@ CM_ModInit(void)
 	map_noareas = Cvar_Get("map_noareas", "0", 0);
 	r_maptype = Cvar_Get("maptype", "0", CVAR_ARCHIVE);
 	r_game = Cvar_Get("game", "", CVAR_LATCH | CVAR_SERVERINFO);
+	cm_viscache_size = Cvar_Get("cm_viscache", "32768", 0);
+	cm_mapcache = Cvar_Get("cm_mapcache", "1", CVAR_ARCHIVE);
+
+	Cmd_AddCommand("cm_visstats", CM_VisStats_f);
+	Cmd_AddCommand("cm_mapcache_build", CM_MapCacheBuild_f);
 }
 
 void
@@ -1841,6 +2390,8 @@ CM_ModFreeAll(void)
 	cached_pvs_cluster = CLUSTER_NOT_CACHED;
 	cached_phs_cluster = CLUSTER_NOT_CACHED;
 
+	CM_FreeVisCache();
+
 	Com_Printf("Server models free up\n");
 }
 
@@ -1848,12 +2399,12 @@ static void
 CM_LoadCachedMap(const char *name, model_t *mod)
 {
 	size_t length, hunkSize;
-	byte *cmod_base, *filebuf;
-	maptype_t maptype;
+	const byte *filebuf, *cachebuf;
+	byte *cmod_base;
 	dheader_t *header;
 	int filelen;
 
-	filelen = FS_LoadFile(name, (void **)&filebuf);
+	filelen = FS_MapFile(name, (const void **)&filebuf);
 
 	if (!filebuf || filelen <= 0)
 	{
@@ -1863,11 +2414,9 @@ CM_LoadCachedMap(const char *name, model_t *mod)
 
 	mod->checksum = LittleLong(Com_BlockChecksum(filebuf, filelen));
 
-	/* Can't detect will use provided */
-	maptype = r_maptype->value;
-
-	cmod_base = Mod_Load2QBSP(name, (byte *)filebuf, filelen, &length, &maptype);
-	FS_FreeFile(filebuf);
+	cmod_base = CM_ConvertMap(name, filebuf, filelen, mod->checksum,
+		&length, &cachebuf);
+	FS_UnmapFile(filebuf);
 
 	header = (dheader_t *)cmod_base;
 
@@ -1950,7 +2499,14 @@ CM_LoadCachedMap(const char *name, model_t *mod)
 	Com_DPrintf("Allocated %d from expected " YQ2_COM_PRIdS " hunk size\n",
 		mod->extradatasize, hunkSize);
 
-	free(cmod_base);
+	if (cachebuf)
+	{
+		FS_UnmapFile(cachebuf);
+	}
+	else
+	{
+		free(cmod_base);
+	}
 
 	if ((mod->numleafs > pxsrow_len) || !pvsrow || !phsrow || !ptsrow)
 	{
@@ -2021,6 +2577,7 @@ CM_LoadMap(const char *name, qboolean clientload, unsigned *checksum)
 		memset(&empty_model, 0, sizeof(empty_model));
 		*checksum = 0;
 		cmod = &empty_model;
+		CM_FreeVisCache();
 		return &cmod->map_cmodels[0]; /* cinematic servers won't have anything at all */
 	}
 
@@ -2093,12 +2650,51 @@ CM_LoadMap(const char *name, qboolean clientload, unsigned *checksum)
 	memset(cmod->portalopen, 0, sizeof(qboolean) * cmod->numareaportals);
 	FloodAreaConnections();
 
+	CM_InitVisCache();
+
 	Com_DPrintf("%s: Loaded map: %s: %d Kb in %.2fs\n",
 		__func__, name, cmod->extradatasize / 1024,
 		(Sys_Milliseconds() - sec_start) / 1000.0);
 	return cmod->map_cmodels;
 }
 
+/*
+ * Loads a map into the cache without making it the current one,
+ * CM_LoadMap() takes it from there. Returns the entity string.
+ */
+const char *
+CM_PrefetchMap(const char *name)
+{
+	model_t *mod;
+	int i;
+
+	mod = NULL;
+
+	for (i = 0; i < MAX_MOD_KNOWN; i++)
+	{
+		if (!strcmp(models[i].name, name))
+		{
+			return models[i].map_entitystring;
+		}
+
+		if (!mod && !models[i].name[0])
+		{
+			mod = &models[i];
+		}
+	}
+
+	if (!mod)
+	{
+		/* the one CM_LoadMap() would replace next, never the current */
+		mod = &models[(model_num + 1) % MAX_MOD_KNOWN];
+		CM_ModFree(mod);
+	}
+
+	CM_LoadCachedMap(name, mod);
+
+	return mod->extradatasize ? mod->map_entitystring : NULL;
+}
+
 cmodel_t *
 CM_InlineModel(const char *name)
 {
@@ -2250,6 +2846,13 @@ const byte *
 CM_ClusterPVS(int cluster, size_t *size)
 {
 	const byte *result;
+
+	result = CM_CachedCluster(cluster, DVIS_PVS, size);
+	if (result)
+	{
+		return result;
+	}
+
 	*size = pxsrow_len / 8;
 	if (cluster == cached_pvs_cluster)
 	{
@@ -2264,6 +2867,13 @@ const byte *
 CM_ClusterPHS(int cluster, size_t *size)
 {
 	const byte *result;
+
+	result = CM_CachedCluster(cluster, DVIS_PHS, size);
+	if (result)
+	{
+		return result;
+	}
+
 	*size = pxsrow_len / 8;
 	if (cluster == cached_phs_cluster)
 	{
@@ -2274,6 +2884,27 @@ CM_ClusterPHS(int cluster, size_t *size)
 	return result;
 }
 
+/*
+ * Same as CM_ClusterPVS and CM_ClusterPHS, but leaves the shared row
+ * buffers and the LRU alone so it is safe to call from worker threads.
+ * Rows come from the vis cache when the whole map fits into it and are
+ * decompressed into buffer otherwise, which must hold CM_ClusterPTS
+ * bytes.
+ */
+const byte *
+CM_ClusterVis(int cluster, int type, byte *buffer, size_t *size)
+{
+	if (cm_viscache.full && (cluster >= 0) && (cluster < cmod->numclusters))
+	{
+		*size = cm_viscache.rowsize;
+		return cm_viscache.rows +
+			(cluster * 2 + type) * cm_viscache.rowsize;
+	}
+
+	*size = pxsrow_len / 8;
+	return CM_Cluster(cluster, type, buffer, *size);
+}
+
 byte *
 CM_ClusterPTS(size_t *size)
 {
@@ -28,6 +28,12 @@
 
 cvar_t *cvar_vars;
 
+/* Open addressing index into cvar_vars, the list
+   itself stays sorted for cvarlist and completion. */
+static cvar_t **cvar_hash;
+static size_t cvar_hashsize; /* Power of two */
+static size_t cvar_count;
+
 
 typedef struct
 {
@@ -175,17 +181,72 @@ Cvar_InfoValidate(const char *s)
 	return true;
 }
 
+static void
+Cvar_HashLink(cvar_t *var)
+{
+	size_t h;
+
+	h = Q_strcasehash(var->name) & (cvar_hashsize - 1);
+
+	while (cvar_hash[h])
+	{
+		h = (h + 1) & (cvar_hashsize - 1);
+	}
+
+	cvar_hash[h] = var;
+}
+
+static void
+Cvar_HashAdd(cvar_t *var)
+{
+	cvar_count++;
+
+	/* Keep the load factor below 1/2 */
+	if (cvar_count * 2 > cvar_hashsize)
+	{
+		cvar_t *cur;
+
+		if (cvar_hash)
+		{
+			Z_Free(cvar_hash);
+		}
+
+		cvar_hashsize = cvar_hashsize ? cvar_hashsize * 2 : 512;
+		cvar_hash = Z_Malloc(cvar_hashsize * sizeof(cvar_t *));
+
+		/* var is already in cvar_vars */
+		for (cur = cvar_vars; cur; cur = cur->next)
+		{
+			Cvar_HashLink(cur);
+		}
+
+		return;
+	}
+
+	Cvar_HashLink(var);
+}
+
 static cvar_t *
 Cvar_FindVar(const char *var_name)
 {
 	cvar_t *var;
+	size_t h;
 
-	for (var = cvar_vars; var; var = var->next)
+	if (!cvar_hash)
+	{
+		return NULL;
+	}
+
+	h = Q_strcasehash(var_name) & (cvar_hashsize - 1);
+
+	while ((var = cvar_hash[h]) != NULL)
 	{
 		if (!strcmp(var_name, var->name))
 		{
 			return var;
 		}
+
+		h = (h + 1) & (cvar_hashsize - 1);
 	}
 
 	return NULL;
@@ -278,6 +339,8 @@ Cvar_AddToList(const char *var_name, const char *var_value, int flags)
 	var->next = *pos;
 	*pos = var;
 
+	Cvar_HashAdd(var);
+
 	return var;
 }
 
@@ -963,6 +1026,15 @@ Cvar_FreeList(void)
 	}
 
 	cvar_vars = NULL;
+
+	if (cvar_hash)
+	{
+		Z_Free(cvar_hash);
+	}
+
+	cvar_hash = NULL;
+	cvar_hashsize = 0;
+	cvar_count = 0;
 }
 
 void
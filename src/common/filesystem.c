@@ -29,6 +29,13 @@
 #include <libgen.h>
 #endif
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include "header/common.h"
 #include "header/glob.h"
 
@@ -44,6 +51,7 @@
 #define MAX_FILENAME 128
 #define MAX_MODS 32
 #define MAX_PAKS 100
+#define MAX_PACK_ZIPHANDLES 4
 
 #ifdef SYSTEMWIDE
  #ifndef SYSTEMDIR
@@ -64,6 +72,7 @@ typedef struct
 	fsMode_t mode;
 	FILE *file;           /* Only one will be used. */
 	unzFile *zip;        /* (file or zip) */
+	struct fsPack_s *pack; /* Pack the file is in, gets zip back on close */
 	int compressed_size; /* Should be zero for original PAK files */
 	fsPackCompress_t format;
 } fsHandle_t;
@@ -80,12 +89,12 @@ typedef struct
 {
 	char name[MAX_FILENAME];
 	size_t size;
-	size_t offset;     /* Ignored in PK3 files. */
+	size_t offset;     /* Central directory position in PK3 files. */
 	size_t compressed_size; /* Should be zero for original PAK files */
 	fsPackCompress_t format;
 } fsPackFile_t;
 
-typedef struct
+typedef struct fsPack_s
 {
 	char name[MAX_OSPATH];
 	size_t numFiles;
@@ -93,6 +102,10 @@ typedef struct
 	unzFile *pk3;
 	qboolean isProtectedPak;
 	fsPackFile_t *files;
+	int *hash;         /* Open addressing, index into files or -1 */
+	size_t hashSize;   /* Power of two */
+	unzFile *zipHandles[MAX_PACK_ZIPHANDLES]; /* Idle PK3 read handles */
+	int numZipHandles;
 } fsPack_t;
 
 typedef struct fsSearchPath_s
@@ -142,11 +155,44 @@ cvar_t *fs_basedir;
 cvar_t *fs_cddir;
 cvar_t *fs_gamedirvar;
 cvar_t *fs_debug;
+cvar_t *fs_mmap;
 
 fsHandle_t *FS_GetFileByHandle(fileHandle_t f);
 
 // --------
 
+// Index of all files in all packs of the search path,
+// maps a case folded name to the pack winning it.
+typedef struct
+{
+	const char *name;       /* Points into the pack directory. */
+	fsSearchPath_t *search; /* Winning pack. */
+	int file;               /* Index into search->pack->files. */
+} fsIndexEntry_t;
+
+static fsIndexEntry_t *fs_index;
+static size_t fs_indexSize; /* Power of two. */
+static size_t fs_indexNum;
+static unsigned int fs_indexHits;
+static unsigned int fs_indexMisses;
+
+// --------
+
+// Files handed out by FS_MapFile(). The mapping itself
+// is page aligned, data points to the file inside of it.
+typedef struct
+{
+	void *base;
+	size_t length;
+	const byte *data;
+} fsMapping_t;
+
+static fsMapping_t fs_mappings[MAX_HANDLES];
+static unsigned int fs_mappedFiles;
+static unsigned int fs_copiedFiles;
+
+// --------
+
 // Raw search path, the actual search
 // bath is build from this one.
 typedef struct fsRawPath_s {
@@ -291,6 +337,24 @@ FS_CreatePath(const char *path)
 	}
 }
 
+/*
+ * Moves a file over another one. Readers see either the old or the
+ * new file, never none. Where renaming over an existing file fails,
+ * i.e. on Windows, the old one is removed first. Returns 0 on success.
+ */
+int
+FS_ReplaceFile(const char *from, const char *to)
+{
+	if (!Sys_Rename(from, to))
+	{
+		return 0;
+	}
+
+	Sys_Remove(to);
+
+	return Sys_Rename(from, to);
+}
+
 void
 FS_DPrintf(const char *format, ...)
 {
@@ -362,6 +426,42 @@ FS_GetFileByHandle(fileHandle_t f)
 	return &fs_handles[f - 1];
 }
 
+/*
+ * Returns an idle read handle of the given PK3. The central
+ * directory is only parsed when the pool runs dry.
+ */
+static unzFile *
+FS_PackGetZipHandle(fsPack_t *pack)
+{
+	if (pack->numZipHandles > 0)
+	{
+		pack->numZipHandles--;
+		return pack->zipHandles[pack->numZipHandles];
+	}
+
+#ifdef _WIN32
+	return unzOpen2(pack->name, &zlib_file_api);
+#else
+	return unzOpen(pack->name);
+#endif
+}
+
+/*
+ * Puts a PK3 read handle back into the pool of its pack.
+ */
+static void
+FS_PackReleaseZipHandle(fsPack_t *pack, unzFile *zip)
+{
+	if (pack && (pack->numZipHandles < MAX_PACK_ZIPHANDLES))
+	{
+		pack->zipHandles[pack->numZipHandles] = zip;
+		pack->numZipHandles++;
+		return;
+	}
+
+	unzClose(zip);
+}
+
 /*
  * Other dll's can't just call fclose() on files returned by FS_FOpenFile.
  */
@@ -379,7 +479,7 @@ FS_FCloseFile(fileHandle_t f)
 	else if (handle->zip)
 	{
 		unzCloseCurrentFile(handle->zip);
-		unzClose(handle->zip);
+		FS_PackReleaseZipHandle(handle->pack, handle->zip);
 	}
 
 	memset(handle, 0, sizeof(*handle));
@@ -395,42 +495,224 @@ FS_SortPackCompare(const void *p1, const void *p2)
 	return Q_stricmp(file1->name, file2->name);
 }
 
+/*
+ * Sorts the directory of a pack and builds the name
+ * index used by FS_PackQuickSearch(). Duplicated names
+ * keep the first entry after sorting.
+ */
 static void
 FS_SortPack(fsPack_t *pak)
 {
+	size_t i;
+
 	qsort(pak->files, pak->numFiles, sizeof(fsPackFile_t), FS_SortPackCompare);
+
+	pak->hashSize = 2;
+	while (pak->hashSize < pak->numFiles * 2)
+	{
+		pak->hashSize <<= 1;
+	}
+
+	pak->hash = Z_Malloc(pak->hashSize * sizeof(int));
+	memset(pak->hash, 0xff, pak->hashSize * sizeof(int));
+
+	for (i = 0; i < pak->numFiles; i++)
+	{
+		size_t h;
+
+		h = Q_strcasehash(pak->files[i].name) & (pak->hashSize - 1);
+
+		while (pak->hash[h] >= 0)
+		{
+			if (!Q_stricmp(pak->files[pak->hash[h]].name, pak->files[i].name))
+			{
+				break;
+			}
+
+			h = (h + 1) & (pak->hashSize - 1);
+		}
+
+		if (pak->hash[h] < 0)
+		{
+			pak->hash[h] = i;
+		}
+	}
 }
 
 static int
 FS_PackQuickSearch(const fsPack_t *pak, const char *name)
 {
-	int start, end;
+	size_t h;
+
+	if (!pak->hash)
+	{
+		return -1;
+	}
+
+	h = Q_strcasehash(name) & (pak->hashSize - 1);
+
+	while (pak->hash[h] >= 0)
+	{
+		if (!Q_stricmp(pak->files[pak->hash[h]].name, name))
+		{
+			return pak->hash[h];
+		}
+
+		h = (h + 1) & (pak->hashSize - 1);
+	}
+
+	return -1;
+}
+
+/*
+ * Adds all files of a pack to the global index. Files already
+ * indexed are replaced only if override is set, i.e. the pack
+ * was put in front of the search path.
+ */
+static void
+FS_IndexAddPack(fsSearchPath_t *search, qboolean override)
+{
+	const fsPack_t *pack = search->pack;
+	int i;
+
+	if ((fs_indexNum + pack->numFiles) * 2 > fs_indexSize)
+	{
+		fsIndexEntry_t *old = fs_index;
+		size_t oldSize = fs_indexSize;
+		size_t j;
+
+		if (!fs_indexSize)
+		{
+			fs_indexSize = 256;
+		}
+
+		while ((fs_indexNum + pack->numFiles) * 2 > fs_indexSize)
+		{
+			fs_indexSize <<= 1;
+		}
+
+		fs_index = Z_Malloc(fs_indexSize * sizeof(fsIndexEntry_t));
+
+		/* Rehash, entries are unique so no need to compare. */
+		for (j = 0; j < oldSize; j++)
+		{
+			size_t h;
+
+			if (!old[j].name)
+			{
+				continue;
+			}
 
-	start = 0;
-	end = pak->numFiles - 1;
+			h = Q_strcasehash(old[j].name) & (fs_indexSize - 1);
 
-	while (start <= end)
+			while (fs_index[h].name)
+			{
+				h = (h + 1) & (fs_indexSize - 1);
+			}
+
+			fs_index[h] = old[j];
+		}
+
+		if (old)
+		{
+			Z_Free(old);
+		}
+	}
+
+	for (i = 0; i < pack->numFiles; i++)
 	{
-		int i, res;
+		const char *name = pack->files[i].name;
+		size_t h;
 
-		i = start + (end - start) / 2;
+		h = Q_strcasehash(name) & (fs_indexSize - 1);
 
-		res = Q_stricmp(pak->files[i].name, name);
-		if (res == 0)
+		while (fs_index[h].name)
 		{
-			return i;
+			if (!Q_stricmp(fs_index[h].name, name))
+			{
+				break;
+			}
+
+			h = (h + 1) & (fs_indexSize - 1);
 		}
-		else if (res < 0)
+
+		if (fs_index[h].name)
 		{
-			start = i + 1;
+			if (!override || (fs_index[h].search == search))
+			{
+				continue;
+			}
 		}
 		else
 		{
-			end = i - 1;
+			fs_indexNum++;
 		}
+
+		fs_index[h].name = name;
+		fs_index[h].search = search;
+		fs_index[h].file = i;
 	}
+}
 
-	return -1;
+static void
+FS_FreeIndex(void)
+{
+	if (fs_index)
+	{
+		Z_Free(fs_index);
+	}
+
+	fs_index = NULL;
+	fs_indexSize = 0;
+	fs_indexNum = 0;
+}
+
+/*
+ * Rebuilds the global index from scratch. Packs are added
+ * in search path order, so the first one containing a file
+ * wins it, just like a walk over the search path does.
+ */
+static void
+FS_BuildIndex(void)
+{
+	fsSearchPath_t *search;
+
+	FS_FreeIndex();
+
+	for (search = fs_searchPaths; search; search = search->next)
+	{
+		if (search->pack)
+		{
+			FS_IndexAddPack(search, false);
+		}
+	}
+}
+
+static const fsIndexEntry_t *
+FS_IndexLookup(const char *name)
+{
+	size_t h;
+
+	if (!fs_index)
+	{
+		return NULL;
+	}
+
+	h = Q_strcasehash(name) & (fs_indexSize - 1);
+
+	while (fs_index[h].name)
+	{
+		if (!Q_stricmp(fs_index[h].name, name))
+		{
+			fs_indexHits++;
+			return &fs_index[h];
+		}
+
+		h = (h + 1) & (fs_indexSize - 1);
+	}
+
+	fs_indexMisses++;
+	return NULL;
 }
 
 /*
@@ -444,6 +726,7 @@ FS_FOpenFile(const char *rawname, fileHandle_t *f, qboolean gamedir_only)
 	fsHandle_t *handle;
 	fsPack_t *pack;
 	fsSearchPath_t *search;
+	const fsIndexEntry_t *indexed = NULL;
 	int input, output;
 
 	*f = 0;
@@ -511,7 +794,16 @@ FS_FOpenFile(const char *rawname, fileHandle_t *f, qboolean gamedir_only)
 	Q_strlcpy(handle->name, name, sizeof(handle->name));
 	handle->mode = FS_READ;
 
-	/* Search through the path, one element at a time. */
+	/* Packs are never searched with gamedir_only,
+	   there's no need to ask the index. */
+	if (!gamedir_only)
+	{
+		indexed = FS_IndexLookup(handle->name);
+	}
+
+	/* Search through the path, one element at a time. Packs
+	   not winning the file in the index can be skipped, only
+	   the directories before the winner must still be tried. */
 	for (search = fs_searchPaths; search; search = search->next)
 	{
 		if (gamedir_only)
@@ -541,7 +833,16 @@ FS_FOpenFile(const char *rawname, fileHandle_t *f, qboolean gamedir_only)
 			int i;
 
 			pack = search->pack;
-			i = FS_PackQuickSearch(pack, handle->name);
+
+			if (fs_index)
+			{
+				i = (indexed && (indexed->search == search)) ?
+					indexed->file : -1;
+			}
+			else
+			{
+				i = FS_PackQuickSearch(pack, handle->name);
+			}
 
 			if (i >= 0)
 			{
@@ -571,6 +872,7 @@ FS_FOpenFile(const char *rawname, fileHandle_t *f, qboolean gamedir_only)
 
 					if (handle->file)
 					{
+						handle->pack = pack;
 						handle->compressed_size = pack->files[i].compressed_size;
 						handle->format = pack->files[i].format;
 						if (fseek(handle->file, pack->files[i].offset, SEEK_SET))
@@ -590,23 +892,23 @@ FS_FOpenFile(const char *rawname, fileHandle_t *f, qboolean gamedir_only)
 						file_from_protected_pak = true;
 					}
 
-#ifdef _WIN32
-					handle->zip = unzOpen2(pack->name, &zlib_file_api);
-#else
-					handle->zip = unzOpen(pack->name);
-#endif
+					handle->zip = FS_PackGetZipHandle(pack);
 
 					if (handle->zip)
 					{
-						if (unzLocateFile(handle->zip, handle->name, 2) == UNZ_OK)
+						/* Jump straight to the directory entry,
+						   no need to scan the zip for the name. */
+						if (unzSetOffset64(handle->zip, pack->files[i].offset) == UNZ_OK)
 						{
 							if (unzOpenCurrentFile(handle->zip) == UNZ_OK)
 							{
+								handle->pack = pack;
 								return pack->files[i].size;
 							}
 						}
 
 						unzClose(handle->zip);
+						handle->zip = NULL;
 					}
 				}
 
@@ -1013,6 +1315,8 @@ FS_LoadFile2(const char *path, void **buffer, int pad)
 	fileHandle_t f;
 	int size;
 
+	PROF_BEGIN("FS_LoadFile");
+
 	size = FS_FOpenFile(path, &f, false);
 
 	if (size <= 0)
@@ -1027,6 +1331,7 @@ FS_LoadFile2(const char *path, void **buffer, int pad)
 			*buffer = NULL;
 		}
 
+		PROF_END();
 		return size;
 	}
 
@@ -1038,6 +1343,7 @@ FS_LoadFile2(const char *path, void **buffer, int pad)
 
 	FS_FCloseFile(f);
 
+	PROF_END();
 	return size;
 }
 
@@ -1047,6 +1353,347 @@ FS_LoadFile(const char *path, void **buffer)
 	return FS_LoadFile2(path, buffer, 1); /* safety null byte */
 }
 
+/*
+ * Maps size bytes at offset of the given file copy on write,
+ * so callers patching the data in place don't hurt anyone.
+ */
+static const byte *
+FS_MapRange(FILE *f, size_t offset, size_t size)
+{
+	fsMapping_t *mapping = NULL;
+	size_t granularity, start;
+	void *base;
+	int i;
+
+	for (i = 0; i < MAX_HANDLES; i++)
+	{
+		if (!fs_mappings[i].data)
+		{
+			mapping = &fs_mappings[i];
+			break;
+		}
+	}
+
+	if (!mapping)
+	{
+		return NULL;
+	}
+
+#ifdef _WIN32
+	{
+		SYSTEM_INFO info;
+		HANDLE filemapping;
+
+		GetSystemInfo(&info);
+		granularity = info.dwAllocationGranularity;
+		start = offset - (offset % granularity);
+
+		filemapping = CreateFileMapping((HANDLE)_get_osfhandle(_fileno(f)),
+			NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+		if (!filemapping)
+		{
+			return NULL;
+		}
+
+		base = MapViewOfFile(filemapping, FILE_MAP_COPY,
+			(DWORD)((unsigned long long)start >> 32), (DWORD)start,
+			offset - start + size);
+		CloseHandle(filemapping);
+
+		if (!base)
+		{
+			return NULL;
+		}
+	}
+#else
+	granularity = sysconf(_SC_PAGESIZE);
+	start = offset - (offset % granularity);
+
+	base = mmap(NULL, offset - start + size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE, fileno(f), start);
+
+	if (base == MAP_FAILED)
+	{
+		return NULL;
+	}
+#endif
+
+	mapping->base = base;
+	mapping->length = offset - start + size;
+	mapping->data = (byte *)base + (offset - start);
+
+	return mapping->data;
+}
+
+/*
+ * Returns where the data of an uncompressed file starts in
+ * its pack, or false if it can't be read from the pack directly.
+ */
+static qboolean
+FS_MapOffset(fsHandle_t *handle, size_t *offset)
+{
+	if (!handle->pack || handle->compressed_size)
+	{
+		return false;
+	}
+
+	if (handle->file)
+	{
+		long pos;
+
+		pos = ftell(handle->file);
+		if (pos < 0)
+		{
+			return false;
+		}
+
+		*offset = pos;
+	}
+	else if (handle->zip)
+	{
+		unz_file_info64 info;
+
+		if (unzGetCurrentFileInfo64(handle->zip, &info,
+				NULL, 0, NULL, 0, NULL, 0) != UNZ_OK)
+		{
+			return false;
+		}
+
+		/* Stored and not encrypted. */
+		if (info.compression_method || (info.flag & 1))
+		{
+			return false;
+		}
+
+		*offset = unzGetCurrentFileZStreamPos64(handle->zip);
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Like FS_LoadFile(), but uncompressed files from packs aren't
+ * copied. The buffer points straight into a mapping of the pack
+ * instead. Everything else falls back to a copy, so the buffer
+ * must always be released with FS_UnmapFile(). Mapped buffers
+ * aren't null terminated, don't use this for text files.
+ */
+int
+FS_MapFile(const char *path, const void **buffer)
+{
+	fsHandle_t *handle;
+	fileHandle_t f;
+	size_t offset;
+	void *copy;
+	int size;
+
+	*buffer = NULL;
+
+	size = FS_FOpenFile(path, &f, false);
+
+	if (size <= 0)
+	{
+		if (!size)
+		{
+			FS_FCloseFile(f);
+		}
+
+		return size;
+	}
+
+	handle = FS_GetFileByHandle(f);
+
+	/* Model and map loaders cast the buffer to int and
+	   float pointers, unaligned data must be copied. */
+	if (fs_mmap->value && FS_MapOffset(handle, &offset) &&
+		((offset % sizeof(int)) == 0))
+	{
+		if (handle->file)
+		{
+			*buffer = FS_MapRange(handle->file, offset, size);
+		}
+		else
+		{
+			FILE *pk3;
+
+			pk3 = Q_fopen(handle->pack->name, "rb");
+
+			if (pk3)
+			{
+				*buffer = FS_MapRange(pk3, offset, size);
+				fclose(pk3);
+			}
+		}
+	}
+
+	if (*buffer)
+	{
+		fs_mappedFiles++;
+	}
+	else
+	{
+		copy = Z_Malloc(size + 1);
+		FS_Read(copy, size, f);
+		*buffer = copy;
+
+		fs_copiedFiles++;
+	}
+
+	FS_FCloseFile(f);
+
+	return size;
+}
+
+/*
+ * FS_MapFile() for a file in the game directory only, the search
+ * path isn't used. Unlike files outside of packs these are mapped,
+ * so only use it for files that are replaced by renaming a new one
+ * over them and never written in place.
+ */
+int
+FS_MapGamedirFile(const char *path, const void **buffer)
+{
+	char ospath[MAX_OSPATH];
+	void *copy;
+	FILE *f;
+	int size;
+
+	*buffer = NULL;
+
+	Com_sprintf(ospath, sizeof(ospath), "%s/%s", FS_Gamedir(), path);
+	f = Q_fopen(ospath, "rb");
+
+	if (!f)
+	{
+		return -1;
+	}
+
+	size = FS_FileLength(f);
+
+	if (size <= 0)
+	{
+		fclose(f);
+		return size;
+	}
+
+	if (fs_mmap->value)
+	{
+		*buffer = FS_MapRange(f, 0, size);
+	}
+
+	if (*buffer)
+	{
+		fs_mappedFiles++;
+	}
+	else
+	{
+		copy = Z_Malloc(size + 1);
+
+		if (fread(copy, size, 1, f) != 1)
+		{
+			Z_Free(copy);
+			fclose(f);
+			return -1;
+		}
+
+		*buffer = copy;
+
+		fs_copiedFiles++;
+	}
+
+	fclose(f);
+
+	return size;
+}
+
+/*
+ * Releases a buffer returned by FS_MapFile(). Buffers from
+ * FS_LoadFile() are accepted, too.
+ */
+void
+FS_UnmapFile(const void *buffer)
+{
+	int i;
+
+	if (buffer == NULL)
+	{
+		FS_DPrintf("%s: NULL buffer.\n", __func__);
+		return;
+	}
+
+	for (i = 0; i < MAX_HANDLES; i++)
+	{
+		if (fs_mappings[i].data == buffer)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(fs_mappings[i].base);
+#else
+			munmap(fs_mappings[i].base, fs_mappings[i].length);
+#endif
+			memset(&fs_mappings[i], 0, sizeof(fs_mappings[i]));
+			return;
+		}
+	}
+
+	Z_Free((void *)buffer);
+}
+
+/*
+ * Opens a file for a thread that can't use the file system. The
+ * returned stream is its own and positioned at the start of the
+ * data, close it with fclose(). Compressed files in packs can
+ * only be read through the file system, NULL is returned for them.
+ */
+FILE *
+FS_FOpenRaw(const char *path, int *size)
+{
+	fsHandle_t *handle;
+	fileHandle_t f;
+	size_t offset;
+	FILE *raw;
+
+	*size = FS_FOpenFile(path, &f, false);
+
+	if (*size <= 0)
+	{
+		if (!*size)
+		{
+			FS_FCloseFile(f);
+		}
+
+		return NULL;
+	}
+
+	handle = FS_GetFileByHandle(f);
+	raw = NULL;
+
+	if (!handle->pack)
+	{
+		/* a file of its own, take the stream */
+		raw = handle->file;
+		handle->file = NULL;
+	}
+	else if (FS_MapOffset(handle, &offset))
+	{
+		raw = Q_fopen(handle->pack->name, "rb");
+
+		if (raw && fseek(raw, offset, SEEK_SET))
+		{
+			fclose(raw);
+			raw = NULL;
+		}
+	}
+
+	FS_FCloseFile(f);
+
+	return raw;
+}
+
 void
 FS_FreeFile(void *buffer)
 {
@@ -1085,6 +1732,8 @@ FS_FreeSearchPaths(fsSearchPath_t *start, const fsSearchPath_t *end)
 	{
 		if (cur->pack)
 		{
+			int i;
+
 			if (cur->pack->pak)
 			{
 				fclose(cur->pack->pak);
@@ -1095,6 +1744,25 @@ FS_FreeSearchPaths(fsSearchPath_t *start, const fsSearchPath_t *end)
 				unzClose(cur->pack->pk3);
 			}
 
+			for (i = 0; i < cur->pack->numZipHandles; i++)
+			{
+				unzClose(cur->pack->zipHandles[i]);
+			}
+
+			/* Files still open close their zip on their own. */
+			for (i = 0; i < MAX_HANDLES; i++)
+			{
+				if (fs_handles[i].pack == cur->pack)
+				{
+					fs_handles[i].pack = NULL;
+				}
+			}
+
+			if (cur->pack->hash)
+			{
+				Z_Free(cur->pack->hash);
+			}
+
 			Z_Free(cur->pack->files);
 			Z_Free(cur->pack);
 		}
@@ -2068,8 +2736,11 @@ FS_LoadPK3(const char *packPath)
 		unzGetCurrentFileInfo(handle, &info, fileName, sizeof(fileName),
 				NULL, 0, NULL, 0);
 		Q_strlcpy(files[i].name, fileName, sizeof(files[i].name));
-		files[i].offset = -1; /* Not used in ZIP files */
+		/* Remember the directory entry, reopening is a seek then. */
+		files[i].offset = unzGetOffset64(handle);
 		files[i].size = info.uncompressed_size;
+		files[i].compressed_size = 0;
+		files[i].format = PAK_MODE_Q2;
 		i++;
 		status = unzGoToNextFile(handle);
 	}
@@ -2172,6 +2843,10 @@ FS_Path_f(void)
 	Com_Printf("----------------------\n");
 
 	Com_Printf("%i files in PAK/PK2/PK3/ZIP files.\n", totalFiles);
+	Com_Printf(YQ2_COM_PRIdS " unique files in index, %u hits, %u misses.\n",
+		fs_indexNum, fs_indexHits, fs_indexMisses);
+	Com_Printf("%u files mapped, %u files copied.\n",
+		fs_mappedFiles, fs_copiedFiles);
 }
 
 /*
@@ -2663,6 +3338,9 @@ FS_AddPAKFromGamedir(const char *pak)
 			search->next = fs_searchPaths;
 			fs_searchPaths = search;
 
+			// It's the first search path now.
+			FS_IndexAddPack(search, true);
+
 			return true;
 		}
 	}
@@ -3041,6 +3719,9 @@ FS_BuildGameSpecificSearchPath(const char *dir)
 		}
 	}
 
+	// The old index points into freed packs.
+	FS_BuildIndex();
+
 	// Create the game directory.
 	Sys_Mkdir(fs_gamedir);
 
@@ -3203,6 +3884,7 @@ FS_InitFilesystem(void)
 	fs_cddir = Cvar_Get("cddir", "", CVAR_NOSET);
 	fs_gamedirvar = Cvar_Get("game", "", CVAR_LATCH | CVAR_SERVERINFO);
 	fs_debug = Cvar_Get("fs_debug", "0", 0);
+	fs_mmap = Cvar_Get("fs_mmap", "1", 0);
 
 	// Deprecation warning, can be removed at a later time.
 	if (strcmp(fs_basedir->string, ".") != 0)
@@ -3225,6 +3907,7 @@ FS_InitFilesystem(void)
 	FS_BuildRawPath();
 	FS_AddKPFpack();
 	FS_BuildGenericSearchPath();
+	FS_BuildIndex();
 
 	if (fs_gamedirvar->string[0] != '\0')
 	{
@@ -3246,6 +3929,7 @@ FS_InitFilesystem(void)
 void
 FS_ShutdownFilesystem(void)
 {
+	FS_FreeIndex();
 	fs_searchPaths = FS_FreeSearchPaths(fs_searchPaths, NULL);
 	fs_rawPath = FS_FreeRawPaths(fs_rawPath, NULL);
 
@@ -358,6 +358,7 @@ Qcommon_Init(int argc, char **argv)
 	// The filesystems needs to be initialized after the cvars.
 	FS_InitFilesystem();
 	Mod_AliasesInit();
+	Mod_TexCacheInit();
 	CM_ModInit();
 
 	// Add and execute configuration files.
@@ -405,6 +406,7 @@ Qcommon_Init(int argc, char **argv)
 	Sys_Init();
 	NET_Init();
 	Netchan_Init();
+	Prof_Init();
 	SV_Init();
 	SV_LocalizationInit();
 #ifndef DEDICATED_ONLY
@@ -691,9 +693,17 @@ Qcommon_Frame(int usec)
 	}
 
 
+	// Start a new profiler frame.
+	if (packetframe || renderframe) {
+		Prof_Frame();
+	}
+
+
 	// Run the serverframe.
 	if (packetframe) {
+		PROF_BEGIN("SV_Frame");
 		SV_Frame(servertimedelta);
+		PROF_END();
 		servertimedelta = 0;
 	}
 
@@ -706,7 +716,9 @@ Qcommon_Frame(int usec)
 
 	// Run the client frame.
 	if (packetframe || renderframe) {
+		PROF_BEGIN("CL_Frame");
 		CL_Frame(packetdelta, renderdelta, clienttimedelta, packetframe, renderframe);
+		PROF_END();
 		clienttimedelta = 0;
 	}
 
@@ -819,7 +831,11 @@ Qcommon_Frame(int usec)
 
 	// Run the serverframe.
 	if (packetframe) {
+		Prof_Frame();
+
+		PROF_BEGIN("SV_Frame");
 		SV_Frame(servertimedelta);
+		PROF_END();
 		servertimedelta = 0;
 
 		// Reset deltas if necessary.
@@ -831,9 +847,11 @@ Qcommon_Frame(int usec)
 void
 Qcommon_Shutdown(void)
 {
+	Sys_ShutdownWorkers();
 	CM_ModFreeAll();
 	Mod_AliasesFreeAll();
 	SV_LocalizationFree();
+	Prof_Shutdown();
 	FS_ShutdownFilesystem();
 	Cvar_Fini();
 
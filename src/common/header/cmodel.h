@@ -59,7 +59,7 @@ extern void Mod_LoadVisibility(const char *name, dvis_t **vis, int *numvisibilit
 	const byte *mod_base, const lump_t *l);
 extern void Mod_LoadPlanes(const char *name, cplane_t **planes, int *numplanes,
 	const byte *mod_base, const lump_t *l);
-extern byte *Mod_Load2QBSP(const char *name, byte *inbuf, size_t filesize,
+extern byte *Mod_Load2QBSP(const char *name, const byte *inbuf, size_t filesize,
 	size_t *out_len, maptype_t *maptype);
 extern float Mod_RadiusFromBounds(const vec3_t mins, const vec3_t maxs);
 extern void Mod_DecompressVis(const byte *in, byte *out, const byte* numvisibility,
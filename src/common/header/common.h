@@ -594,6 +594,9 @@ void NET_Config(qboolean multiplayer);
 qboolean NET_GetPacket(netsrc_t sock, netadr_t *net_from,
 		sizebuf_t *net_message);
 void NET_SendPacket(netsrc_t sock, int length, const void *data, netadr_t to);
+void NET_BatchBegin(netsrc_t sock);
+void NET_BatchFlush(netsrc_t sock);
+void NET_SetLoopbackSize(int packets);
 
 qboolean NET_CompareAdr(netadr_t a, netadr_t b);
 qboolean NET_CompareBaseAdr(netadr_t a, netadr_t b);
@@ -639,6 +642,15 @@ typedef struct
 	/* message is copied to this buffer when it is first transfered */
 	int reliable_length;
 	byte reliable_buf[MAX_MSGLEN - 16];         /* unacked reliable message */
+
+	/* fragmentation and compression, negotiated at connect */
+	qboolean extended;              /* peer understands the flag bits */
+	qboolean compression;           /* deflate outgoing payloads */
+	int fragmentsize;               /* max datagram size, 0 = unlimited */
+
+	int fragment_sequence;          /* sequence being reassembled */
+	int fragment_length;
+	byte fragment_buf[MAX_MSGLEN];
 } netchan_t;
 
 extern netadr_t net_from;
@@ -647,6 +659,8 @@ extern byte net_message_buffer[MAX_MSGLEN];
 
 void Netchan_Init(void);
 void Netchan_Setup(netsrc_t sock, netchan_t *chan, netadr_t adr, int qport);
+void Netchan_SetExtended(netchan_t *chan, int fragmentsize);
+int Netchan_FragmentSize(void);
 
 qboolean Netchan_NeedReliable(const netchan_t *chan);
 void Netchan_Transmit(netchan_t *chan, int length, const byte *data);
@@ -662,6 +676,7 @@ qboolean Netchan_CanReliable(const netchan_t *chan);
 
 const byte* CM_GetRawMap(int *len);
 cmodel_t *CM_LoadMap(const char *name, qboolean clientload, unsigned *checksum);
+const char *CM_PrefetchMap(const char *name);
 cmodel_t *CM_InlineModel(const char *name);       /* *1, *2, etc */
 int CM_MapSurfacesNum(void);
 mapsurface_t* CM_MapSurfaces(int surfnum);
@@ -690,6 +705,7 @@ trace_t CM_TransformedBoxTrace(const vec3_t start, const vec3_t end,
 const byte *CM_ClusterPVS(int cluster, size_t *size);
 const byte *CM_ClusterPHS(int cluster, size_t *size);
 byte *CM_ClusterPTS(size_t *size);
+const byte *CM_ClusterVis(int cluster, int type, byte *buffer, size_t *size);
 
 int CM_PointLeafnum(const vec3_t p);
 
@@ -721,6 +737,32 @@ const dmdxframegroup_t *Mod_GetModelInfo(const char *name, int *num,
 void Mod_GetModelFrameInfo(const char *name, int num, float *mins, float *maxs);
 void Mod_LoadImageWithPalette(const char *filename, byte **pic, byte **palette,
 	int *width, int *height, int *bitsPerPixel);
+void Mod_DecodeImages(int count, const char **filenames, byte **pics,
+	int *widths, int *heights);
+
+/* block compressed mip chains, see models/texcache.c */
+#define TEXCOMP_MAXMIPS 15
+
+typedef enum
+{
+	TEXCOMP_BC1,    /* opaque, 8 bytes per 4x4 block */
+	TEXCOMP_BC3     /* with alpha, 16 bytes per 4x4 block */
+} texcompformat_t;
+
+typedef struct
+{
+	texcompformat_t format;
+	int nummips;                        /* down to 1x1 */
+	const byte *mips[TEXCOMP_MAXMIPS];  /* largest first */
+	int mipsizes[TEXCOMP_MAXMIPS];
+	const void *buffer;
+	qboolean mapped;
+} compimage_t;
+
+void Mod_TexCacheInit(void);
+qboolean Mod_CompressImage(const char *name, const byte *pic, int width,
+	int height, compimage_t *image);
+void Mod_FreeCompressedImage(compimage_t *image);
 byte * Mod_LoadEmbededLMP(const char *mod_name, int *width, int *height,
 	int *bitsPerPixel);
 /* PLAYER MOVEMENT CODE */
@@ -781,6 +823,14 @@ const char *FS_Gamedir(void);
 const char *FS_NextPath(const char *prevPath);
 int FS_LoadFile2(const char *path, void **buffer, int pad);
 int FS_LoadFile(const char *path, void **buffer);
+/* read only view of a file, may point straight into the pack. Not
+ * null terminated and must be released with FS_UnmapFile */
+int FS_MapFile(const char *path, const void **buffer);
+int FS_MapGamedirFile(const char *path, const void **buffer);
+void FS_UnmapFile(const void *buffer);
+/* stdio stream of its own for other threads, NULL for
+ * compressed files in packs */
+FILE *FS_FOpenRaw(const char *path, int *size);
 #define FS_FileExists(path) (FS_LoadFile2(path, NULL, 0) >= 0)
 qboolean FS_FileInGamedir(const char *file);
 qboolean FS_AddPAKFromGamedir(const char *pak);
@@ -794,6 +844,7 @@ strlist_t FS_ListMods(void);
 
 void FS_FreeFile(void *buffer);
 void FS_CreatePath(const char *path);
+int FS_ReplaceFile(const char *from, const char *to);
 
 /* MISC */
 
@@ -871,6 +922,20 @@ extern int time_after_game;
 extern int time_before_ref;
 extern int time_after_ref;
 
+/* frame profiler, zones are recorded while the profile cvar is set */
+extern qboolean prof_active;
+
+void Prof_Init(void);
+void Prof_Shutdown(void);
+void Prof_Frame(void);
+void Prof_BeginZone(const char *name);
+void Prof_EndZone(void);
+
+#define PROF_BEGIN(name) \
+	do { if (prof_active) { Prof_BeginZone(name); } } while (0)
+#define PROF_END() \
+	do { if (prof_active) { Prof_EndZone(); } } while (0)
+
 #include "zone.h"
 
 void Qcommon_Init(int argc, char **argv);
@@ -880,6 +945,7 @@ void Qcommon_Shutdown(void);
 
 #define NUMVERTEXNORMALS 162
 extern vec3_t bytedirs[NUMVERTEXNORMALS];
+int DirToByte(const vec3_t dir);
 
 /* this is in the client code, but can be used for debugging from server */
 void SCR_DebugGraph(float value, int color);
@@ -940,6 +1006,15 @@ void Sys_SetHighDPIMode(void);
 const char *Sys_GetBinaryDir(void);
 void Sys_SetupFPU(void);
 
+// thread.c
+int Sys_NumWorkers(void);
+void Sys_ParallelFor(int count, void (*func)(void *data, int index, int worker),
+		void *data);
+void Sys_ShutdownWorkers(void);
+void *Sys_StartThread(void (*func)(void *data), void *data);
+qboolean Sys_ThreadDone(void *thread);
+void Sys_JoinThread(void *thread);
+
 /* ======================================================================= */
 
 /* stringlist_t API
@@ -355,6 +355,9 @@ int Q_strcasecmp(const char *s1, const char *s2);
 int Q_strncasecmp(const char *s1, const char *s2, size_t n);
 char *Q_strcasestr(const char *haystack, const char *needle);
 
+/* case insensitive string hash, matches Q_stricmp() */
+unsigned int Q_strcasehash(const char *s);
+
 /* portable string lowercase / uppercase */
 void Q_strlwr(char *s);
 void Q_strupr(char *s);
@@ -38,6 +38,7 @@ void *Z_Realloc(void *ptr, size_t size);
 void *Z_TagRealloc(void *ptr, size_t size, unsigned short tag);
 
 size_t Z_BlockSize(const void *ptr);
+void Z_Allocations(size_t *count, size_t *bytes);
 
 void Z_Stats_f (void);
 
@@ -2275,7 +2275,7 @@ Mod_Load2QBSPSizeByRules(const rule_t *rules, size_t numrules, dheader_t *outhea
 }
 
 byte *
-Mod_Load2QBSP(const char *name, byte *inbuf, size_t filesize, size_t *out_len,
+Mod_Load2QBSP(const char *name, const byte *inbuf, size_t filesize, size_t *out_len,
 	maptype_t *maptype)
 {
 	/* max lump count * lumps + ident + version */
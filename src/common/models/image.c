@@ -35,8 +35,12 @@
 #define STBI_MALLOC(sz)    malloc(sz)
 #define STBI_REALLOC(p,sz) realloc(p,sz)
 #define STBI_FREE(p)       free(p)
-// Switch of the thread local stuff. Breaks mingw under Windows.
+// Images are decoded on worker threads, the failure reason must be
+// thread local. That breaks mingw under Windows, don't record it there.
+#ifdef __MINGW32__
 #define STBI_NO_THREAD_LOCALS
+#define STBI_NO_FAILURE_STRINGS
+#endif
 // include implementation part of stb_image into this file
 #define STB_IMAGE_IMPLEMENTATION
 #include "../../client/refresh/files/stb_image.h"
@@ -898,8 +902,11 @@ Mod_RawDecodeImageWithPalette(const char *filename, const byte *raw, int len,
 
 			if (*pic == NULL)
 			{
+				const char *reason;
+
+				reason = stbi_failure_reason();
 				Com_DPrintf("%s couldn't load data from %s: %s!\n",
-					__func__, filename, stbi_failure_reason());
+					__func__, filename, reason ? reason : "unknown error");
 			}
 		}
 
@@ -926,13 +933,13 @@ void
 Mod_LoadImageWithPalette(const char *filename, byte **pic, byte **palette,
 	int *width, int *height, int *bitsPerPixel)
 {
+	const byte *raw;
 	int len;
-	byte *raw;
 
 	*pic = NULL;
 
 	/* load the file */
-	len = FS_LoadFile(filename, (void **)&raw);
+	len = FS_MapFile(filename, (const void **)&raw);
 	if (!raw || len <= 0)
 	{
 		size_t i;
@@ -944,7 +951,7 @@ Mod_LoadImageWithPalette(const char *filename, byte **pic, byte **palette,
 			{
 				Com_DPrintf("%s: tring to replace %s to %s.\n",
 					__func__, filename, img_replacements[i].new);
-				len = FS_LoadFile(img_replacements[i].new, (void **)&raw);
+				len = FS_MapFile(img_replacements[i].new, (const void **)&raw);
 				break;
 			}
 		}
@@ -974,12 +981,95 @@ Mod_LoadImageWithPalette(const char *filename, byte **pic, byte **palette,
 
 	if (len <= sizeof(int))
 	{
-		FS_FreeFile(raw);
+		FS_UnmapFile(raw);
 		return;
 	}
 
 	Mod_RawDecodeImageWithPalette(filename, raw, len, pic, palette, width, height,
 		bitsPerPixel);
 
-	FS_FreeFile(raw);
+	FS_UnmapFile(raw);
+}
+
+typedef struct
+{
+	const byte **raw;
+	int *lens;
+	byte **pics;
+	int *widths, *heights;
+} decodejob_t;
+
+static void
+Mod_DecodeImageJob(void *data, int index, int worker)
+{
+	const decodejob_t *job = data;
+	int bitsPerPixel;
+
+	if (!job->raw[index])
+	{
+		return;
+	}
+
+	job->pics[index] = stbi_load_from_memory(job->raw[index],
+		job->lens[index], &job->widths[index], &job->heights[index],
+		&bitsPerPixel, STBI_rgb_alpha);
+}
+
+/*
+ * Decodes files stb_image reads (tga, png, jpg) to RGBA on the worker
+ * threads. The files are mapped and unmapped by the calling thread,
+ * the workers don't touch the filesystem. Pics that couldn't be
+ * decoded are NULL, the others have to be free()d by the caller.
+ */
+void
+Mod_DecodeImages(int count, const char **filenames, byte **pics,
+	int *widths, int *heights)
+{
+	decodejob_t job;
+	int i;
+
+	if (count <= 0)
+	{
+		return;
+	}
+
+	job.raw = malloc(count * (sizeof(*job.raw) + sizeof(*job.lens)));
+	YQ2_COM_CHECK_OOM(job.raw, "malloc()",
+		count * (sizeof(*job.raw) + sizeof(*job.lens)))
+	if (!job.raw)
+	{
+		/* unaware about YQ2_ATTR_NORETURN_FUNCPTR? */
+		return;
+	}
+
+	job.lens = (int *)(job.raw + count);
+	job.pics = pics;
+	job.widths = widths;
+	job.heights = heights;
+
+	for (i = 0; i < count; i++)
+	{
+		pics[i] = NULL;
+		widths[i] = heights[i] = 0;
+
+		job.lens[i] = FS_MapFile(filenames[i], (const void **)&job.raw[i]);
+
+		if (job.raw[i] && (job.lens[i] <= sizeof(int)))
+		{
+			FS_UnmapFile(job.raw[i]);
+			job.raw[i] = NULL;
+		}
+	}
+
+	Sys_ParallelFor(count, Mod_DecodeImageJob, &job);
+
+	for (i = 0; i < count; i++)
+	{
+		if (job.raw[i])
+		{
+			FS_UnmapFile(job.raw[i]);
+		}
+	}
+
+	free(job.raw);
 }
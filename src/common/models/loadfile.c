@@ -441,7 +441,7 @@ Mod_LoadFileWithoutExtModel(const char *namewe, size_t tlen, void **buffer)
 	/* Check Quake 3 model */
 	Q_strlcpy(newname, namewe, sizeof(newname));
 	Q_strlcpy(newname + tlen, ".mdr", sizeof(newname));
-	filesize = FS_LoadFile(newname, buffer);
+	filesize = FS_MapFile(newname, (const void **)buffer);
 	if (filesize > 0)
 	{
 		Com_DPrintf("%s: %s loaded as mdr/md4 (Star Trek: Elite Force)\n",
@@ -452,7 +452,7 @@ Mod_LoadFileWithoutExtModel(const char *namewe, size_t tlen, void **buffer)
 	/* Check Quake 3 model */
 	Q_strlcpy(newname, namewe, sizeof(newname));
 	Q_strlcpy(newname + tlen, ".md3", sizeof(newname));
-	filesize = FS_LoadFile(newname, buffer);
+	filesize = FS_MapFile(newname, (const void **)buffer);
 	if (filesize > 0)
 	{
 		Com_DPrintf("%s: %s loaded as md3 (Quake 3)\n",
@@ -463,7 +463,7 @@ Mod_LoadFileWithoutExtModel(const char *namewe, size_t tlen, void **buffer)
 	/* Check Heretic2 model */
 	Q_strlcpy(newname, namewe, sizeof(newname));
 	Q_strlcat(newname, ".fm", sizeof(newname));
-	filesize = FS_LoadFile(newname, buffer);
+	filesize = FS_MapFile(newname, (const void **)buffer);
 	if (filesize > 0)
 	{
 		Com_DPrintf("%s: %s loaded as fm (Heretic 2)\n",
@@ -493,7 +493,7 @@ Mod_LoadFileWithoutExtModel(const char *namewe, size_t tlen, void **buffer)
 
 	/* Check Quake 2 model */
 	Q_strlcpy(newname + tlen, ".md2", sizeof(newname));
-	filesize = FS_LoadFile(newname, buffer);
+	filesize = FS_MapFile(newname, (const void **)buffer);
 	if (filesize > 0)
 	{
 		Com_DPrintf("%s: %s loaded as md2 (Quake 2/Anachronox)\n",
@@ -503,7 +503,7 @@ Mod_LoadFileWithoutExtModel(const char *namewe, size_t tlen, void **buffer)
 
 	/* Check Kingpin model */
 	Q_strlcpy(newname + tlen, ".mdx", sizeof(newname));
-	filesize = FS_LoadFile(newname, buffer);
+	filesize = FS_MapFile(newname, (const void **)buffer);
 	if (filesize > 0)
 	{
 		Com_DPrintf("%s: %s loaded as mdx (Kingpin)\n",
@@ -513,7 +513,7 @@ Mod_LoadFileWithoutExtModel(const char *namewe, size_t tlen, void **buffer)
 
 	/* Check Daikatana model */
 	Q_strlcpy(newname + tlen, ".dkm", sizeof(newname));
-	filesize = FS_LoadFile(newname, buffer);
+	filesize = FS_MapFile(newname, (const void **)buffer);
 	if (filesize > 0)
 	{
 		Com_DPrintf("%s: %s loaded as dkm (Daikatana)\n",
@@ -523,7 +523,7 @@ Mod_LoadFileWithoutExtModel(const char *namewe, size_t tlen, void **buffer)
 
 	/* Check Quake model */
 	Q_strlcpy(newname + tlen, ".mdl", sizeof(newname));
-	filesize = FS_LoadFile(newname, buffer);
+	filesize = FS_MapFile(newname, (const void **)buffer);
 	if (filesize > 0)
 	{
 		Com_DPrintf("%s: %s loaded as mdl (Quake/Half-Life)\n",
@@ -612,7 +612,7 @@ Mod_LoadAndStoreModel(const char *name)
 		!strcmp(ext, "sp2") ||
 		!strcmp(ext, "spr"))
 	{
-		filesize = FS_LoadFile(name, &buffer);
+		filesize = FS_MapFile(name, (const void **)&buffer);
 	}
 	else if (!strcmp(ext, "png") || !strcmp(ext, "tga"))
 	{
@@ -677,8 +677,8 @@ Mod_LoadAndStoreModel(const char *name)
 		mod = Mod_StoreModel(name, filesize, buffer);
 		if (buffer)
 		{
-			/* free old buffer */
-			FS_FreeFile(buffer);
+			/* free old buffer, mapped or loaded */
+			FS_UnmapFile(buffer);
 		}
 
 		return mod;
@@ -0,0 +1,1022 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * Texture cache. 32 bit textures are block compressed with their whole
+ * mip chain, BC1 if they are opaque and BC3 otherwise, so renderers can
+ * upload them without converting or generating mipmaps. The compressed
+ * chains are kept in texcache/ in the game directory, behind a header
+ * with a hash of the source pixels. A texture is compressed again when
+ * its pixels change. mod_texcache_build fills the cache in advance.
+ *
+ * =======================================================================
+ */
+
+#include "../header/common.h"
+
+#define TEXCACHE_IDENT (('C' << 24) + ('T' << 16) + ('B' << 8) + 'Y') /* "YBTC" */
+#define TEXCACHE_VERSION 1 /* bump when the encoder output changes */
+
+#define TEXCACHE_BUILDBATCH 8
+
+typedef struct
+{
+	int ident;
+	int version;
+	int format;
+	int width;
+	int height;
+	int nummips;
+	unsigned hash[2];   /* of the source pixels */
+	int length;         /* of the mip chain following the header */
+	int pad;
+} texcacheheader_t;
+
+typedef struct
+{
+	const byte *pic;    /* RGBA */
+	int width, height;
+	byte *out;
+} texcomplevel_t;
+
+typedef struct
+{
+	texcompformat_t format;
+	int nummips;
+	texcomplevel_t levels[TEXCOMP_MAXMIPS];
+	int firstrow[TEXCOMP_MAXMIPS + 1];  /* block rows before each level */
+} texcompjob_t;
+
+static cvar_t *mod_texcache;
+
+/*
+ * Returns the number of mip levels and their
+ * sizes, 0 if the texture is too large.
+ */
+static int
+Mod_TexCacheLevels(int width, int height, texcompformat_t format,
+	int *sizes)
+{
+	int blocksize, nummips;
+
+	blocksize = (format == TEXCOMP_BC1) ? 8 : 16;
+
+	for (nummips = 0; nummips < TEXCOMP_MAXMIPS; nummips++)
+	{
+		sizes[nummips] = ((width + 3) / 4) * ((height + 3) / 4) * blocksize;
+
+		if ((width == 1) && (height == 1))
+		{
+			return nummips + 1;
+		}
+
+		width = Q_max(width >> 1, 1);
+		height = Q_max(height >> 1, 1);
+	}
+
+	return 0;
+}
+
+static void
+Mod_TexCacheHash(const byte *pic, size_t size, unsigned *hash)
+{
+	unsigned long long h;
+	size_t i;
+
+	h = 14695981039346656037ull;
+
+	for (i = 0; i + 8 <= size; i += 8)
+	{
+		unsigned long long v;
+
+		memcpy(&v, pic + i, sizeof(v));
+		h = (h ^ v) * 1099511628211ull;
+		h ^= h >> 29;
+	}
+
+	for ( ; i < size; i++)
+	{
+		h = (h ^ pic[i]) * 1099511628211ull;
+	}
+
+	hash[0] = (unsigned)h;
+	hash[1] = (unsigned)(h >> 32);
+}
+
+static unsigned short
+Mod_TexCacheTo565(const float *color)
+{
+	int r, g, b;
+
+	r = (int)(Q_clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+	g = (int)(Q_clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+	b = (int)(Q_clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+
+	return (r << 11) | (g << 5) | b;
+}
+
+static void
+Mod_TexCacheFrom565(unsigned short c, int *color)
+{
+	color[0] = ((c >> 8) & 0xf8) | (c >> 13);
+	color[1] = ((c >> 3) & 0xfc) | ((c >> 9) & 0x03);
+	color[2] = ((c << 3) & 0xf8) | ((c >> 2) & 0x07);
+}
+
+/*
+ * Picks the nearest of the four colors between c0 and c1
+ * for every pixel, returns the squared error.
+ */
+static int
+Mod_TexCacheColorIndices(const byte block[16][4], unsigned short c0,
+	unsigned short c1, unsigned *indices)
+{
+	int palette[4][3];
+	int i, j, error;
+
+	Mod_TexCacheFrom565(c0, palette[0]);
+	Mod_TexCacheFrom565(c1, palette[1]);
+
+	for (j = 0; j < 3; j++)
+	{
+		palette[2][j] = (2 * palette[0][j] + palette[1][j]) / 3;
+		palette[3][j] = (palette[0][j] + 2 * palette[1][j]) / 3;
+	}
+
+	*indices = 0;
+	error = 0;
+
+	for (i = 0; i < 16; i++)
+	{
+		int best, besterror;
+
+		best = 0;
+		besterror = 3 * 256 * 256; /* more than any distance */
+
+		for (j = 0; j < 4; j++)
+		{
+			int dr, dg, db, e;
+
+			dr = block[i][0] - palette[j][0];
+			dg = block[i][1] - palette[j][1];
+			db = block[i][2] - palette[j][2];
+			e = dr * dr + dg * dg + db * db;
+
+			if (e < besterror)
+			{
+				best = j;
+				besterror = e;
+			}
+		}
+
+		*indices |= (unsigned)best << (i * 2);
+		error += besterror;
+	}
+
+	return error;
+}
+
+/*
+ * Solves for the two end colors that fit the
+ * indices best, returns false if they can't.
+ */
+static qboolean
+Mod_TexCacheRefineColors(const byte block[16][4], unsigned indices,
+	unsigned short *c0, unsigned short *c1)
+{
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	float aa, bb, ab, ax[3], bx[3], det, a[3], b[3];
+	int i, j;
+
+	aa = bb = ab = 0;
+	VectorClear(ax);
+	VectorClear(bx);
+
+	for (i = 0; i < 16; i++)
+	{
+		float wa, wb;
+
+		wa = weights[(indices >> (i * 2)) & 3];
+		wb = 1.0f - wa;
+
+		aa += wa * wa;
+		bb += wb * wb;
+		ab += wa * wb;
+
+		for (j = 0; j < 3; j++)
+		{
+			ax[j] += wa * block[i][j];
+			bx[j] += wb * block[i][j];
+		}
+	}
+
+	det = aa * bb - ab * ab;
+
+	if (fabsf(det) < 0.0001f)
+	{
+		return false;
+	}
+
+	for (j = 0; j < 3; j++)
+	{
+		a[j] = (ax[j] * bb - bx[j] * ab) / det;
+		b[j] = (bx[j] * aa - ax[j] * ab) / det;
+	}
+
+	*c0 = Mod_TexCacheTo565(a);
+	*c1 = Mod_TexCacheTo565(b);
+
+	return true;
+}
+
+/*
+ * The end colors are the pixels furthest apart along the
+ * principal axis of the block, then refined once.
+ */
+static void
+Mod_TexCacheColorBlock(const byte block[16][4], byte *out)
+{
+	float mean[3], cov[6], axis[3], color[3], mint, maxt;
+	unsigned short c0, c1, r0, r1;
+	unsigned indices, rindices;
+	int i, j, min, max, error;
+
+	VectorClear(mean);
+
+	for (i = 0; i < 16; i++)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			mean[j] += block[i][j];
+		}
+	}
+
+	VectorScale(mean, 1.0f / 16.0f, mean);
+	memset(cov, 0, sizeof(cov));
+
+	for (i = 0; i < 16; i++)
+	{
+		float r, g, b;
+
+		r = block[i][0] - mean[0];
+		g = block[i][1] - mean[1];
+		b = block[i][2] - mean[2];
+
+		cov[0] += r * r;
+		cov[1] += r * g;
+		cov[2] += r * b;
+		cov[3] += g * g;
+		cov[4] += g * b;
+		cov[5] += b * b;
+	}
+
+	/* power iteration, from the column of the largest variance */
+	if ((cov[0] >= cov[3]) && (cov[0] >= cov[5]))
+	{
+		VectorSet(axis, cov[0], cov[1], cov[2]);
+	}
+	else if (cov[3] >= cov[5])
+	{
+		VectorSet(axis, cov[1], cov[3], cov[4]);
+	}
+	else
+	{
+		VectorSet(axis, cov[2], cov[4], cov[5]);
+	}
+
+	for (i = 0; i < 4; i++)
+	{
+		float x, y, z, len;
+
+		x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+
+		len = Q_max(fabsf(x), Q_max(fabsf(y), fabsf(z)));
+
+		if (len < 0.0001f)
+		{
+			break;
+		}
+
+		VectorSet(axis, x / len, y / len, z / len);
+	}
+
+	min = max = 0;
+	mint = maxt = DotProduct(block[0], axis);
+
+	for (i = 1; i < 16; i++)
+	{
+		float t;
+
+		t = block[i][0] * axis[0] + block[i][1] * axis[1] +
+			block[i][2] * axis[2];
+
+		if (t < mint)
+		{
+			mint = t;
+			min = i;
+		}
+
+		if (t > maxt)
+		{
+			maxt = t;
+			max = i;
+		}
+	}
+
+	VectorSet(color, block[max][0], block[max][1], block[max][2]);
+	c0 = Mod_TexCacheTo565(color);
+	VectorSet(color, block[min][0], block[min][1], block[min][2]);
+	c1 = Mod_TexCacheTo565(color);
+
+	error = Mod_TexCacheColorIndices(block, c0, c1, &indices);
+
+	if (error && Mod_TexCacheRefineColors(block, indices, &r0, &r1) &&
+		(Mod_TexCacheColorIndices(block, r0, r1, &rindices) < error))
+	{
+		c0 = r0;
+		c1 = r1;
+		indices = rindices;
+	}
+
+	/* c0 > c1 selects four colors, equal ones only have c0 left */
+	if (c0 < c1)
+	{
+		unsigned short tmp;
+
+		tmp = c0;
+		c0 = c1;
+		c1 = tmp;
+		indices ^= 0x55555555;
+	}
+	else if (c0 == c1)
+	{
+		indices = 0;
+	}
+
+	out[0] = c0 & 255;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 255;
+	out[3] = c1 >> 8;
+	out[4] = indices & 255;
+	out[5] = (indices >> 8) & 255;
+	out[6] = (indices >> 16) & 255;
+	out[7] = indices >> 24;
+}
+
+/*
+ * Alpha is stored as the lowest and highest value of the
+ * block and the nearest of the eight values between them.
+ */
+static void
+Mod_TexCacheAlphaBlock(const byte block[16][4], byte *out)
+{
+	unsigned long long bits;
+	int i, min, max;
+
+	min = max = block[0][3];
+
+	for (i = 1; i < 16; i++)
+	{
+		min = Q_min(min, block[i][3]);
+		max = Q_max(max, block[i][3]);
+	}
+
+	bits = 0;
+
+	if (max > min)
+	{
+		for (i = 0; i < 16; i++)
+		{
+			unsigned long long code;
+			int t;
+
+			t = ((block[i][3] - min) * 14 + (max - min)) / ((max - min) * 2);
+			code = (t == 7) ? 0 : (t == 0) ? 1 : 8 - t;
+			bits |= code << (i * 3);
+		}
+	}
+
+	out[0] = max;
+	out[1] = min;
+
+	for (i = 0; i < 6; i++)
+	{
+		out[2 + i] = (bits >> (i * 8)) & 255;
+	}
+}
+
+static void
+Mod_TexCacheEncodeRow(void *data, int index, int worker)
+{
+	const texcompjob_t *job = data;
+	const texcomplevel_t *level;
+	int blocksize, by, bx, x, y, l;
+	byte *out;
+
+	for (l = 0; index >= job->firstrow[l + 1]; l++)
+	{
+	}
+
+	level = &job->levels[l];
+	by = index - job->firstrow[l];
+	blocksize = (job->format == TEXCOMP_BC1) ? 8 : 16;
+	out = level->out + by * ((level->width + 3) / 4) * blocksize;
+
+	for (bx = 0; bx < level->width; bx += 4, out += blocksize)
+	{
+		byte block[16][4];
+
+		/* blocks over the edge repeat the last pixels */
+		for (y = 0; y < 4; y++)
+		{
+			const byte *row;
+
+			row = level->pic +
+				Q_min(by * 4 + y, level->height - 1) * level->width * 4;
+
+			for (x = 0; x < 4; x++)
+			{
+				memcpy(block[y * 4 + x],
+					row + Q_min(bx + x, level->width - 1) * 4, 4);
+			}
+		}
+
+		if (job->format == TEXCOMP_BC1)
+		{
+			Mod_TexCacheColorBlock(block, out);
+		}
+		else
+		{
+			Mod_TexCacheAlphaBlock(block, out);
+			Mod_TexCacheColorBlock(block, out + 8);
+		}
+	}
+}
+
+static void
+Mod_TexCacheDownsample(const byte *in, int width, int height, byte *out)
+{
+	int outwidth, outheight, x, y, c;
+
+	outwidth = Q_max(width >> 1, 1);
+	outheight = Q_max(height >> 1, 1);
+
+	for (y = 0; y < outheight; y++)
+	{
+		const byte *row0, *row1;
+
+		row0 = in + Q_min(y * 2, height - 1) * width * 4;
+		row1 = in + Q_min(y * 2 + 1, height - 1) * width * 4;
+
+		for (x = 0; x < outwidth; x++, out += 4)
+		{
+			int x0, x1;
+
+			x0 = Q_min(x * 2, width - 1) * 4;
+			x1 = Q_min(x * 2 + 1, width - 1) * 4;
+
+			for (c = 0; c < 4; c++)
+			{
+				out[c] = (row0[x0 + c] + row0[x1 + c] +
+					row1[x0 + c] + row1[x1 + c] + 2) >> 2;
+			}
+		}
+	}
+}
+
+/*
+ * Builds the mip chain of pic and compresses every level
+ * into out, the blocks are compressed on the worker threads.
+ */
+static void
+Mod_TexCacheEncode(const byte *pic, int width, int height,
+	texcompformat_t format, int nummips, const int *sizes, byte *out)
+{
+	texcompjob_t job;
+	size_t mipsize;
+	byte *mips;
+	int i, w, h;
+
+	/* all levels below the first */
+	mipsize = 0;
+
+	for (i = 1, w = width, h = height; i < nummips; i++)
+	{
+		w = Q_max(w >> 1, 1);
+		h = Q_max(h >> 1, 1);
+		mipsize += (size_t)w * h * 4;
+	}
+
+	mips = NULL;
+
+	if (mipsize)
+	{
+		mips = malloc(mipsize);
+		YQ2_COM_CHECK_OOM(mips, "malloc()", mipsize)
+		if (!mips)
+		{
+			/* unaware about YQ2_ATTR_NORETURN_FUNCPTR? */
+			return;
+		}
+	}
+
+	job.format = format;
+	job.nummips = nummips;
+	job.firstrow[0] = 0;
+
+	for (i = 0, w = width, h = height; i < nummips; i++)
+	{
+		texcomplevel_t *level = &job.levels[i];
+
+		if (i)
+		{
+			const texcomplevel_t *prev = &job.levels[i - 1];
+
+			level->pic = (i == 1) ? mips :
+				prev->pic + (size_t)prev->width * prev->height * 4;
+			Mod_TexCacheDownsample(prev->pic, prev->width, prev->height,
+				(byte *)level->pic);
+		}
+		else
+		{
+			level->pic = pic;
+		}
+
+		level->width = w;
+		level->height = h;
+		level->out = out;
+
+		job.firstrow[i + 1] = job.firstrow[i] + (h + 3) / 4;
+		out += sizes[i];
+		w = Q_max(w >> 1, 1);
+		h = Q_max(h >> 1, 1);
+	}
+
+	Sys_ParallelFor(job.firstrow[nummips], Mod_TexCacheEncodeRow, &job);
+
+	free(mips);
+}
+
+static qboolean
+Mod_TexCacheName(const char *name, char *out, size_t size)
+{
+	char base[MAX_QPATH];
+
+	/* generated textures aren't cached */
+	if ((strlen(name) >= sizeof(base)) || strchr(name, '*') ||
+		strstr(name, ".."))
+	{
+		return false;
+	}
+
+	COM_StripExtension(name, base);
+	Com_sprintf(out, size, "texcache/%s.btc", base);
+
+	return true;
+}
+
+/*
+ * Returns the mapped cache file of a texture if it
+ * was compressed from the same pixels, NULL otherwise.
+ * Only the cache in the game directory is used, that's
+ * the one Mod_WriteTexCache() updates.
+ */
+static const byte *
+Mod_ReadTexCache(const char *cachename, int width, int height,
+	texcompformat_t format, int nummips, int length, const unsigned *hash)
+{
+	const texcacheheader_t *header;
+	const byte *buf;
+	int size;
+
+	size = FS_MapGamedirFile(cachename, (const void **)&buf);
+
+	if (!buf)
+	{
+		return NULL;
+	}
+
+	header = (const texcacheheader_t *)buf;
+
+	if ((size < (int)sizeof(*header)) ||
+		(header->ident != TEXCACHE_IDENT) ||
+		(header->version != TEXCACHE_VERSION) ||
+		(header->format != format) ||
+		(header->width != width) ||
+		(header->height != height) ||
+		(header->nummips != nummips) ||
+		(header->hash[0] != hash[0]) ||
+		(header->hash[1] != hash[1]) ||
+		(header->length != length) ||
+		(header->length != size - (int)sizeof(*header)))
+	{
+		Com_DPrintf("%s: %s is outdated\n", __func__, cachename);
+		FS_UnmapFile(buf);
+		return NULL;
+	}
+
+	return buf;
+}
+
+static void
+Mod_WriteTexCache(const char *cachename, int width, int height,
+	texcompformat_t format, int nummips, const unsigned *hash,
+	const byte *data, int length)
+{
+	char path[MAX_OSPATH], tmppath[MAX_OSPATH];
+	texcacheheader_t header;
+	qboolean ok;
+	FILE *f;
+
+	Com_sprintf(path, sizeof(path), "%s/%s", FS_Gamedir(), cachename);
+	Com_sprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+
+	FS_CreatePath(tmppath);
+	f = Q_fopen(tmppath, "wb");
+
+	if (!f)
+	{
+		Com_DPrintf("%s: Couldn't write %s\n", __func__, tmppath);
+		return;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.ident = TEXCACHE_IDENT;
+	header.version = TEXCACHE_VERSION;
+	header.format = format;
+	header.width = width;
+	header.height = height;
+	header.nummips = nummips;
+	header.hash[0] = hash[0];
+	header.hash[1] = hash[1];
+	header.length = length;
+
+	ok = (fwrite(&header, sizeof(header), 1, f) == 1) &&
+		(fwrite(data, length, 1, f) == 1);
+	ok = (fclose(f) == 0) && ok;
+
+	if (!ok || FS_ReplaceFile(tmppath, path))
+	{
+		Com_DPrintf("%s: Couldn't write %s\n", __func__, path);
+		Sys_Remove(tmppath);
+	}
+}
+
+static texcompformat_t
+Mod_TexCacheFormat(const byte *pic, int width, int height)
+{
+	size_t i, size;
+
+	size = (size_t)width * height * 4;
+
+	for (i = 3; i < size; i += 4)
+	{
+		if (pic[i] != 255)
+		{
+			return TEXCOMP_BC3;
+		}
+	}
+
+	return TEXCOMP_BC1;
+}
+
+/*
+ * Returns the block compressed mip chain of an RGBA texture, from the
+ * texture cache or compressed now. name is the name of the texture,
+ * its extension doesn't matter. Has to be freed with
+ * Mod_FreeCompressedImage().
+ */
+qboolean
+Mod_CompressImage(const char *name, const byte *pic, int width, int height,
+	compimage_t *image)
+{
+	char cachename[MAX_OSPATH];
+	const byte *buf;
+	unsigned hash[2];
+	int i, length;
+	qboolean cache;
+	byte *data;
+
+	memset(image, 0, sizeof(*image));
+
+	if (!pic || (width <= 0) || (height <= 0))
+	{
+		return false;
+	}
+
+	image->format = Mod_TexCacheFormat(pic, width, height);
+	image->nummips = Mod_TexCacheLevels(width, height, image->format,
+		image->mipsizes);
+
+	if (!image->nummips)
+	{
+		return false;
+	}
+
+	length = 0;
+
+	for (i = 0; i < image->nummips; i++)
+	{
+		length += image->mipsizes[i];
+	}
+
+	Mod_TexCacheHash(pic, (size_t)width * height * 4, hash);
+
+	cache = mod_texcache->value &&
+		Mod_TexCacheName(name, cachename, sizeof(cachename));
+	buf = NULL;
+
+	if (cache)
+	{
+		buf = Mod_ReadTexCache(cachename, width, height, image->format,
+			image->nummips, length, hash);
+	}
+
+	if (buf)
+	{
+		image->buffer = buf;
+		image->mapped = true;
+		data = (byte *)buf + sizeof(texcacheheader_t);
+	}
+	else
+	{
+		data = malloc(length);
+		YQ2_COM_CHECK_OOM(data, "malloc()", length)
+		if (!data)
+		{
+			/* unaware about YQ2_ATTR_NORETURN_FUNCPTR? */
+			return false;
+		}
+
+		Mod_TexCacheEncode(pic, width, height, image->format,
+			image->nummips, image->mipsizes, data);
+
+		if (cache)
+		{
+			Mod_WriteTexCache(cachename, width, height, image->format,
+				image->nummips, hash, data, length);
+		}
+
+		image->buffer = data;
+	}
+
+	for (i = 0; i < image->nummips; i++)
+	{
+		image->mips[i] = data;
+		data += image->mipsizes[i];
+	}
+
+	return true;
+}
+
+void
+Mod_FreeCompressedImage(compimage_t *image)
+{
+	if (!image->buffer)
+	{
+		return;
+	}
+
+	if (image->mapped)
+	{
+		FS_UnmapFile(image->buffer);
+	}
+	else
+	{
+		free((void *)image->buffer);
+	}
+
+	image->buffer = NULL;
+}
+
+/*
+ * Adds the directory and its subdirectories to dirs. Pack
+ * listings have no directories, only the files in them.
+ */
+static void
+Mod_TexCacheDirs(const char *dir, strlist_t *dirs)
+{
+	char findname[MAX_QPATH];
+	strlist_t list;
+	size_t len;
+	int i;
+
+	StrList_Append(dirs, dir);
+
+	Com_sprintf(findname, sizeof(findname), "%s/*", dir);
+	list = FS_ListFiles2(findname, 0, 0);
+	len = strlen(dir) + 1;
+
+	for (i = 0; i < list.num; i++)
+	{
+		char *slash;
+
+		slash = Q_strchrs(list.data[i] + len, "/\\");
+
+		if (slash)
+		{
+			*slash = '\0';
+		}
+
+		if (!StrList_Contains(dirs, list.data[i]))
+		{
+			StrList_Append(dirs, list.data[i]);
+		}
+	}
+
+	StrList_Free(&list);
+}
+
+/*
+ * mod_texcache_build [dir]
+ * Compresses the tga, png and jpg textures in the directory and its
+ * subdirectories, textures by default, and reports the encoding
+ * throughput and the memory saved against uncompressed mip chains.
+ */
+static void
+Mod_TexCacheBuild_f(void)
+{
+	static const char *exts[] = { "tga", "png", "jpg" };
+
+	strlist_t dirs, names, files;
+	long long encodetime;
+	double rgbabytes, compbytes, pixels;
+	int i, j, k, failed;
+
+	if (Cmd_Argc() > 2)
+	{
+		Com_Printf("Usage: mod_texcache_build [dir]\n");
+		return;
+	}
+
+	if (!mod_texcache->value)
+	{
+		Com_Printf("The texture cache is disabled, set mod_texcache to 1.\n");
+		return;
+	}
+
+	StrList_Init(&dirs, 0);
+	StrList_Init(&names, 0);
+	StrList_Init(&files, 0);
+
+	Mod_TexCacheDirs((Cmd_Argc() == 2) ? Cmd_Argv(1) : "textures", &dirs);
+
+	/* same priority as the renderers, tga before png before jpg */
+	for (i = 0; i < dirs.num; i++)
+	{
+		size_t len = strlen(dirs.data[i]) + 1;
+
+		for (j = 0; j < ARRLEN(exts); j++)
+		{
+			char findname[MAX_QPATH], namewe[MAX_QPATH];
+			strlist_t list;
+
+			Com_sprintf(findname, sizeof(findname), "%s/*.%s",
+				dirs.data[i], exts[j]);
+			list = FS_ListFiles2(findname, 0, 0);
+
+			for (k = 0; k < list.num; k++)
+			{
+				if (Q_strchrs(list.data[k] + len, "/\\") ||
+					(strlen(list.data[k]) >= sizeof(namewe)))
+				{
+					continue;
+				}
+
+				COM_StripExtension(list.data[k], namewe);
+
+				if (!StrList_Contains(&names, namewe))
+				{
+					StrList_Append(&names, namewe);
+					StrList_Append(&files, list.data[k]);
+				}
+			}
+
+			StrList_Free(&list);
+		}
+	}
+
+	encodetime = 0;
+	rgbabytes = compbytes = pixels = 0;
+	failed = 0;
+
+	for (i = 0; i < files.num; i += TEXCACHE_BUILDBATCH)
+	{
+		int widths[TEXCACHE_BUILDBATCH], heights[TEXCACHE_BUILDBATCH];
+		byte *pics[TEXCACHE_BUILDBATCH];
+		int count;
+
+		count = Q_min(files.num - i, TEXCACHE_BUILDBATCH);
+		Mod_DecodeImages(count, (const char **)files.data + i, pics,
+			widths, heights);
+
+		for (j = 0; j < count; j++)
+		{
+			int sizes[TEXCOMP_MAXMIPS], nummips, length, w, h;
+			char cachename[MAX_OSPATH];
+			texcompformat_t format;
+			unsigned hash[2];
+			long long start;
+			byte *data;
+
+			if (!pics[j])
+			{
+				failed++;
+				continue;
+			}
+
+			format = Mod_TexCacheFormat(pics[j], widths[j], heights[j]);
+			nummips = Mod_TexCacheLevels(widths[j], heights[j], format, sizes);
+
+			if (!nummips ||
+				!Mod_TexCacheName(files.data[i + j], cachename,
+					sizeof(cachename)))
+			{
+				free(pics[j]);
+				failed++;
+				continue;
+			}
+
+			length = 0;
+			w = widths[j];
+			h = heights[j];
+
+			for (k = 0; k < nummips; k++)
+			{
+				length += sizes[k];
+				rgbabytes += (double)w * h * 4;
+				w = Q_max(w >> 1, 1);
+				h = Q_max(h >> 1, 1);
+			}
+
+			data = malloc(length);
+			YQ2_COM_CHECK_OOM(data, "malloc()", length)
+			if (!data)
+			{
+				/* unaware about YQ2_ATTR_NORETURN_FUNCPTR? */
+				free(pics[j]);
+				break;
+			}
+
+			start = Sys_Microseconds();
+			Mod_TexCacheEncode(pics[j], widths[j], heights[j], format,
+				nummips, sizes, data);
+			encodetime += Sys_Microseconds() - start;
+
+			Mod_TexCacheHash(pics[j], (size_t)widths[j] * heights[j] * 4,
+				hash);
+			Mod_WriteTexCache(cachename, widths[j], heights[j], format,
+				nummips, hash, data, length);
+
+			pixels += (double)widths[j] * heights[j];
+			compbytes += length;
+
+			free(data);
+			free(pics[j]);
+		}
+	}
+
+	Com_Printf("%i textures, %.1f Mpixels compressed in %.1f ms, "
+		"%.1f Mpixels/s.\n", files.num - failed, pixels / 1000000.0,
+		encodetime / 1000.0,
+		encodetime ? pixels / encodetime : 0.0);
+	Com_Printf("%.1f MiB as RGBA with mipmaps, %.1f MiB compressed, "
+		"%.1f MiB saved.\n", rgbabytes / (1024 * 1024),
+		compbytes / (1024 * 1024), (rgbabytes - compbytes) / (1024 * 1024));
+
+	if (failed)
+	{
+		Com_Printf("%i textures unreadable.\n", failed);
+	}
+
+	StrList_Free(&files);
+	StrList_Free(&names);
+	StrList_Free(&dirs);
+}
+
+void
+Mod_TexCacheInit(void)
+{
+	mod_texcache = Cvar_Get("mod_texcache", "1", CVAR_ARCHIVE);
+
+	Cmd_AddCommand("mod_texcache_build", Mod_TexCacheBuild_f);
+}
@@ -194,6 +194,190 @@ vec3_t bytedirs[NUMVERTEXNORMALS] = {
 
 static const entity_xstate_t es_nullstate = {0};
 
+/*
+ * Directions are quantized with a cube map: each face of the cube is
+ * split into DIR_GRID x DIR_GRID cells and every cell lists the
+ * bytedirs that can be the closest one to a direction inside of it,
+ * up to DIR_CANDIDATES. Only those are compared, the result is the
+ * same as when comparing all of them. Cells with more candidates
+ * compare all bytedirs.
+ */
+#define DIR_GRID 16
+#define DIR_CANDIDATES 8
+
+typedef struct
+{
+	byte count; /* 0 = too many, compare all */
+	byte dirs[DIR_CANDIDATES];
+} dircell_t;
+
+static dircell_t dir_cells[6][DIR_GRID][DIR_GRID];
+static qboolean dir_cellsinit;
+
+static double
+DirAngle(const double *a, const double *b)
+{
+	double d, la, lb;
+
+	d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	la = sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+	lb = sqrt(b[0] * b[0] + b[1] * b[1] + b[2] * b[2]);
+
+	return acos(Q_clamp(d / (la * lb), -1.0, 1.0));
+}
+
+static void
+DirCellDir(int face, double u, double v, double *dir)
+{
+	int axis = face >> 1;
+
+	dir[axis] = (face & 1) ? -1.0 : 1.0;
+	dir[(axis + 1) % 3] = u;
+	dir[(axis + 2) % 3] = v;
+}
+
+static void
+DirInitCells(void)
+{
+	int face, i, j, k, n;
+
+	for (face = 0; face < 6; face++)
+	{
+		for (i = 0; i < DIR_GRID; i++)
+		{
+			for (j = 0; j < DIR_GRID; j++)
+			{
+				double u0, v0, size, center[3], corner[3], norm[3];
+				double angles[NUMVERTEXNORMALS], radius, best;
+				dircell_t *cell = &dir_cells[face][i][j];
+
+				size = 2.0 / DIR_GRID;
+				u0 = -1.0 + i * size;
+				v0 = -1.0 + j * size;
+				DirCellDir(face, u0 + size / 2, v0 + size / 2, center);
+
+				/* the corners are the farthest from the center */
+				radius = 0;
+
+				for (k = 0; k < 4; k++)
+				{
+					DirCellDir(face, u0 + (k & 1) * size,
+						v0 + (k >> 1) * size, corner);
+					radius = Q_max(radius, DirAngle(center, corner));
+				}
+
+				best = M_PI;
+
+				for (n = 0; n < NUMVERTEXNORMALS; n++)
+				{
+					norm[0] = bytedirs[n][0];
+					norm[1] = bytedirs[n][1];
+					norm[2] = bytedirs[n][2];
+
+					angles[n] = DirAngle(center, norm);
+					best = Q_min(best, angles[n]);
+				}
+
+				/* a direction in the cell is at most radius away from the
+				   center, so its closest dir can't be farther than
+				   best + 2 * radius from the center */
+				cell->count = 0;
+
+				for (n = 0; n < NUMVERTEXNORMALS; n++)
+				{
+					if (angles[n] > best + 2 * radius + 0.001)
+					{
+						continue;
+					}
+
+					if (cell->count == DIR_CANDIDATES)
+					{
+						cell->count = 0;
+						break;
+					}
+
+					cell->dirs[cell->count++] = n;
+				}
+			}
+		}
+	}
+
+	dir_cellsinit = true;
+}
+
+/*
+ * Returns the index of the bytedir closest to dir,
+ * 0 for null vectors.
+ */
+int
+DirToByte(const vec3_t dir)
+{
+	const dircell_t *cell;
+	int i, best, axis, face, u, v;
+	float bestd, ax[3], scale;
+
+	if (!dir_cellsinit)
+	{
+		DirInitCells();
+	}
+
+	ax[0] = fabsf(dir[0]);
+	ax[1] = fabsf(dir[1]);
+	ax[2] = fabsf(dir[2]);
+
+	axis = (ax[0] >= ax[1]) ? ((ax[0] >= ax[2]) ? 0 : 2) :
+		((ax[1] >= ax[2]) ? 1 : 2);
+
+	/* catches NaN, too */
+	if (!(ax[axis] > 0))
+	{
+		return 0;
+	}
+
+	face = axis * 2 + (dir[axis] < 0);
+	scale = 0.5f * DIR_GRID / ax[axis];
+	u = (int)((dir[(axis + 1) % 3] + ax[axis]) * scale);
+	v = (int)((dir[(axis + 2) % 3] + ax[axis]) * scale);
+	cell = &dir_cells[face][Q_clamp(u, 0, DIR_GRID - 1)]
+		[Q_clamp(v, 0, DIR_GRID - 1)];
+
+	bestd = 0;
+	best = 0;
+
+	if (!cell->count)
+	{
+		for (i = 0; i < NUMVERTEXNORMALS; i++)
+		{
+			float d;
+
+			d = DotProduct(dir, bytedirs[i]);
+
+			if (d > bestd)
+			{
+				bestd = d;
+				best = i;
+			}
+		}
+
+		return best;
+	}
+
+	for (i = 0; i < cell->count; i++)
+	{
+		float d;
+
+		d = DotProduct(dir, bytedirs[cell->dirs[i]]);
+
+		if (d > bestd)
+		{
+			bestd = d;
+			best = cell->dirs[i];
+		}
+	}
+
+	return best;
+}
+
 size_t
 MSG_ConfigString_Size(const char *s)
 {
@@ -819,32 +1003,13 @@ MSG_WriteDeltaUsercmd(sizebuf_t *buf, const usercmd_t *from, const usercmd_t *cm
 void
 MSG_WriteDir(sizebuf_t *sb, const vec3_t dir)
 {
-	int i, best;
-	float bestd;
-
 	if (!dir)
 	{
 		MSG_WriteByte(sb, 0);
 		return;
 	}
 
-	bestd = 0;
-	best = 0;
-
-	for (i = 0; i < NUMVERTEXNORMALS; i++)
-	{
-		float d;
-
-		d = DotProduct(dir, bytedirs[i]);
-
-		if (d > bestd)
-		{
-			bestd = d;
-			best = i;
-		}
-	}
-
-	MSG_WriteByte(sb, best);
+	MSG_WriteByte(sb, DirToByte(dir));
 }
 
 void
@@ -28,6 +28,12 @@
 
 #include "header/common.h"
 
+#ifdef USE_SYSTEM_MINIZIP
+#include <zlib.h>
+#else
+#include "unzip/miniz/miniz.h"
+#endif
+
 /*
  * packet header
  * -------------
@@ -81,16 +87,83 @@
  * frame, such as during the connection stage while waiting for the
  * client to load, then a packet only needs to be delivered if there is
  * something in the unacknowledged reliable
+ *
+ * Extended channels
+ * -----------------
+ * If both sides agreed on it at connect, bit 30 of the sequence marks
+ * a fragment and bit 30 of the acknowledge sequence marks a deflated
+ * payload. A fragment carries a 16 bit offset after the header, bit 15
+ * of the offset is set on all but the last fragment of a packet. The
+ * fragments of a packet share its sequence number and must arrive in
+ * order, a lost fragment drops the whole packet. The payload is
+ * compressed as a whole before it's fragmented.
  */
 
+#define NETCHAN_FRAGMENT (1U << 30)
+#define NETCHAN_COMPRESSED (1U << 30)
+#define NETCHAN_MOREFRAGMENTS 0x8000
+
+/* don't bother to deflate anything smaller */
+#define NETCHAN_COMPRESS_MIN 64
+
+#define NETCHAN_MIN_MTU 256
+
 cvar_t *showpackets;
 cvar_t *showdrop;
 cvar_t *qport;
 
+static cvar_t *net_mtu;
+static cvar_t *net_compress;
+
+static z_stream netchan_deflate;
+static z_stream netchan_inflate;
+static qboolean netchan_deflate_init;
+static qboolean netchan_inflate_init;
+static byte netchan_zbuf[MAX_MSGLEN];
+
+static struct
+{
+	size_t packets;
+	size_t compressed;
+	size_t bytes_in;        /* payload before compression */
+	size_t bytes_out;       /* payload after compression */
+	size_t fragmented;
+	size_t fragments;
+	size_t recv_fragments;
+	size_t recv_reassembled;
+	size_t recv_dropped;
+	size_t recv_inflated;
+	size_t recv_errors;
+} netchan_stats;
+
 netadr_t net_from;
 sizebuf_t net_message;
 byte net_message_buffer[MAX_MSGLEN];
 
+static void
+Netchan_Stats_f(void)
+{
+	size_t saved;
+
+	saved = netchan_stats.bytes_in - netchan_stats.bytes_out;
+
+	Com_Printf(YQ2_COM_PRIdS " packets sent, " YQ2_COM_PRIdS
+		" deflated\n", netchan_stats.packets, netchan_stats.compressed);
+	Com_Printf(YQ2_COM_PRIdS " payload bytes, " YQ2_COM_PRIdS
+		" on the wire, " YQ2_COM_PRIdS " saved (%.1f%%)\n",
+		netchan_stats.bytes_in, netchan_stats.bytes_out, saved,
+		netchan_stats.bytes_in ?
+			100.0f * saved / netchan_stats.bytes_in : 0.0f);
+	Com_Printf(YQ2_COM_PRIdS " packets split into " YQ2_COM_PRIdS
+		" fragments\n", netchan_stats.fragmented, netchan_stats.fragments);
+	Com_Printf(YQ2_COM_PRIdS " fragments received, " YQ2_COM_PRIdS
+		" packets reassembled, " YQ2_COM_PRIdS " dropped\n",
+		netchan_stats.recv_fragments, netchan_stats.recv_reassembled,
+		netchan_stats.recv_dropped);
+	Com_Printf(YQ2_COM_PRIdS " packets inflated, " YQ2_COM_PRIdS
+		" bad\n", netchan_stats.recv_inflated, netchan_stats.recv_errors);
+}
+
 void
 Netchan_Init(void)
 {
@@ -121,6 +194,10 @@ Netchan_Init(void)
 	showpackets = Cvar_Get("showpackets", "0", 0);
 	showdrop = Cvar_Get("showdrop", "0", 0);
 	qport = Cvar_Get("qport", va("%i", port), CVAR_NOSET);
+	net_mtu = Cvar_Get("net_mtu", "1400", CVAR_ARCHIVE);
+	net_compress = Cvar_Get("net_compress", "1", CVAR_ARCHIVE);
+
+	Cmd_AddCommand("netchan_stats", Netchan_Stats_f);
 }
 
 /*
@@ -177,6 +254,188 @@ Netchan_Setup(netsrc_t sock, netchan_t *chan, netadr_t adr, int qport)
 	chan->message.allowoverflow = true;
 }
 
+/*
+ * Returns the datagram size requested by net_mtu,
+ * 0 if fragmentation is disabled
+ */
+int
+Netchan_FragmentSize(void)
+{
+	if (net_mtu->value <= 0)
+	{
+		return 0;
+	}
+
+	return Q_clamp((int)net_mtu->value, NETCHAN_MIN_MTU, MAX_MSGLEN);
+}
+
+/*
+ * Switches a channel to fragmentation and compression after the peer
+ * agreed on it. fragmentsize is the smaller of both sides' net_mtu,
+ * 0 if one of them disabled fragmentation.
+ */
+void
+Netchan_SetExtended(netchan_t *chan, int fragmentsize)
+{
+	chan->extended = true;
+	chan->compression = net_compress->value != 0;
+
+	if (fragmentsize > 0)
+	{
+		chan->fragmentsize = Q_clamp(fragmentsize, NETCHAN_MIN_MTU, MAX_MSGLEN);
+	}
+	else
+	{
+		chan->fragmentsize = 0;
+	}
+}
+
+/*
+ * Deflates len bytes of data into netchan_zbuf. Returns
+ * the compressed size or 0 if it didn't get smaller.
+ */
+static int
+Netchan_Deflate(const byte *data, int len)
+{
+	if (!netchan_deflate_init)
+	{
+		if (deflateInit2(&netchan_deflate, Z_BEST_SPEED, Z_DEFLATED,
+				-MAX_WBITS, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			return 0;
+		}
+
+		netchan_deflate_init = true;
+	}
+
+	deflateReset(&netchan_deflate);
+
+	netchan_deflate.next_in = (byte *)data;
+	netchan_deflate.avail_in = len;
+	netchan_deflate.next_out = netchan_zbuf;
+	netchan_deflate.avail_out = len - 1;
+
+	if (deflate(&netchan_deflate, Z_FINISH) != Z_STREAM_END)
+	{
+		/* didn't fit, not worth it */
+		return 0;
+	}
+
+	return (int)netchan_deflate.total_out;
+}
+
+/*
+ * Inflates len bytes of data into netchan_zbuf. Returns
+ * the uncompressed size or -1 on broken or oversized data.
+ */
+static int
+Netchan_Inflate(const byte *data, int len, int maxlen)
+{
+	if (!netchan_inflate_init)
+	{
+		if (inflateInit2(&netchan_inflate, -MAX_WBITS) != Z_OK)
+		{
+			return -1;
+		}
+
+		netchan_inflate_init = true;
+	}
+
+	inflateReset(&netchan_inflate);
+
+	netchan_inflate.next_in = (byte *)data;
+	netchan_inflate.avail_in = len;
+	netchan_inflate.next_out = netchan_zbuf;
+	netchan_inflate.avail_out = Q_min(maxlen, (int)sizeof(netchan_zbuf));
+
+	if (inflate(&netchan_inflate, Z_FINISH) != Z_STREAM_END)
+	{
+		return -1;
+	}
+
+	return (int)netchan_inflate.total_out;
+}
+
+static void
+Netchan_WriteHeader(const netchan_t *chan, sizebuf_t *send, unsigned w1,
+	unsigned w2)
+{
+	SZ_Clear(send);
+
+	MSG_WriteLong(send, w1);
+	MSG_WriteLong(send, w2);
+
+	/* send the qport if we are a client */
+	if (chan->sock == NS_CLIENT)
+	{
+		MSG_WriteShort(send, chan->qport);
+	}
+}
+
+/*
+ * Sends the payload of an extended channel, deflated
+ * if that helps and split into fragments if needed.
+ */
+static void
+Netchan_SendExtended(netchan_t *chan, unsigned w1, unsigned w2,
+	int length, const byte *data)
+{
+	sizebuf_t send;
+	byte send_buf[MAX_MSGLEN];
+	int offset, chunk, fragmentdata, zlength;
+
+	netchan_stats.packets++;
+	netchan_stats.bytes_in += length;
+
+	if (chan->compression && (length >= NETCHAN_COMPRESS_MIN))
+	{
+		zlength = Netchan_Deflate(data, length);
+
+		if (zlength > 0)
+		{
+			data = netchan_zbuf;
+			length = zlength;
+			w2 |= NETCHAN_COMPRESSED;
+
+			netchan_stats.compressed++;
+		}
+	}
+
+	netchan_stats.bytes_out += length;
+
+	SZ_Init(&send, send_buf, sizeof(send_buf));
+	Netchan_WriteHeader(chan, &send, w1, w2);
+
+	if (!chan->fragmentsize || (send.cursize + length <= chan->fragmentsize))
+	{
+		SZ_Write(&send, data, length);
+		NET_SendPacket(chan->sock, send.cursize, send.data,
+			chan->remote_address);
+
+		return;
+	}
+
+	/* header and fragment offset */
+	fragmentdata = chan->fragmentsize - send.cursize - 2;
+
+	netchan_stats.fragmented++;
+
+	for (offset = 0; offset < length; offset += chunk)
+	{
+		chunk = Q_min(length - offset, fragmentdata);
+
+		Netchan_WriteHeader(chan, &send, w1 | NETCHAN_FRAGMENT, w2);
+		MSG_WriteShort(&send, offset |
+			((offset + chunk < length) ? NETCHAN_MOREFRAGMENTS : 0));
+		SZ_Write(&send, data + offset, chunk);
+
+		NET_SendPacket(chan->sock, send.cursize, send.data,
+			chan->remote_address);
+
+		netchan_stats.fragments++;
+	}
+}
+
 /*
  * Returns true if the last reliable message has acked
  */
@@ -227,6 +486,7 @@ Netchan_Transmit(netchan_t *chan, int length, const byte *data)
 	byte send_buf[MAX_MSGLEN];
 	qboolean send_reliable;
 	unsigned w1, w2;
+	int header;
 
 	/* check for message overflow */
 	if (chan->message.overflowed)
@@ -258,14 +518,8 @@ Netchan_Transmit(netchan_t *chan, int length, const byte *data)
 	chan->outgoing_sequence++;
 	chan->last_sent = curtime;
 
-	MSG_WriteLong(&send, w1);
-	MSG_WriteLong(&send, w2);
-
-	/* send the qport if we are a client */
-	if (chan->sock == NS_CLIENT)
-	{
-		MSG_WriteShort(&send, qport->value);
-	}
+	Netchan_WriteHeader(chan, &send, w1, w2);
+	header = send.cursize;
 
 	/* copy the reliable message to the packet first */
 	if (send_reliable)
@@ -285,7 +539,16 @@ Netchan_Transmit(netchan_t *chan, int length, const byte *data)
 	}
 
 	/* send the datagram */
-	NET_SendPacket(chan->sock, send.cursize, send.data, chan->remote_address);
+	if (chan->extended)
+	{
+		Netchan_SendExtended(chan, w1, w2, send.cursize - header,
+			send.data + header);
+	}
+	else
+	{
+		NET_SendPacket(chan->sock, send.cursize, send.data,
+			chan->remote_address);
+	}
 
 	if (showpackets->value)
 	{
@@ -306,6 +569,112 @@ Netchan_Transmit(netchan_t *chan, int length, const byte *data)
 	}
 }
 
+/*
+ * Adds a fragment to the packet being reassembled. Returns true
+ * and puts the whole payload into msg once the last one arrived.
+ */
+static qboolean
+Netchan_Reassemble(netchan_t *chan, sizebuf_t *msg, int sequence)
+{
+	int header, offset, length;
+	qboolean more;
+
+	header = msg->readcount;
+	offset = MSG_ReadShort(msg) & 0xffff;
+	more = (offset & NETCHAN_MOREFRAGMENTS) != 0;
+	offset &= ~NETCHAN_MOREFRAGMENTS;
+	length = msg->cursize - msg->readcount;
+
+	if (length < 0)
+	{
+		return false;
+	}
+
+	netchan_stats.recv_fragments++;
+
+	if (sequence != chan->fragment_sequence)
+	{
+		if (chan->fragment_length > 0)
+		{
+			netchan_stats.recv_dropped++;
+		}
+
+		chan->fragment_sequence = sequence;
+		chan->fragment_length = 0;
+	}
+
+	if ((offset != chan->fragment_length) ||
+		(offset + length > msg->maxsize - header))
+	{
+		/* lost, reordered or broken, skip the rest of this packet */
+		if (chan->fragment_length >= 0)
+		{
+			netchan_stats.recv_dropped++;
+
+			if (showdrop->value)
+			{
+				Com_Printf("%s:Dropped fragmented packet %i at offset %i\n",
+						NET_AdrToString(chan->remote_address),
+						sequence, offset);
+			}
+		}
+
+		chan->fragment_length = -1;
+
+		return false;
+	}
+
+	memcpy(chan->fragment_buf + offset, msg->data + msg->readcount, length);
+	chan->fragment_length += length;
+
+	if (more)
+	{
+		return false;
+	}
+
+	memcpy(msg->data + header, chan->fragment_buf, chan->fragment_length);
+	msg->cursize = header + chan->fragment_length;
+	msg->readcount = header;
+
+	chan->fragment_length = 0;
+	netchan_stats.recv_reassembled++;
+
+	return true;
+}
+
+/*
+ * Replaces the deflated payload of msg with the inflated one.
+ */
+static qboolean
+Netchan_InflateMessage(const netchan_t *chan, sizebuf_t *msg)
+{
+	int header, length;
+
+	header = msg->readcount;
+	length = Netchan_Inflate(msg->data + header, msg->cursize - header,
+			msg->maxsize - header);
+
+	if (length < 0)
+	{
+		netchan_stats.recv_errors++;
+
+		if (showdrop->value)
+		{
+			Com_Printf("%s:Couldn't inflate packet\n",
+					NET_AdrToString(chan->remote_address));
+		}
+
+		return false;
+	}
+
+	memcpy(msg->data + header, netchan_zbuf, length);
+	msg->cursize = header + length;
+
+	netchan_stats.recv_inflated++;
+
+	return true;
+}
+
 /*
  * called when the current net_message is from remote_address
  * modifies net_message so that it points to the packet payload
@@ -315,6 +684,7 @@ Netchan_Process(netchan_t *chan, sizebuf_t *msg)
 {
 	unsigned sequence, sequence_ack;
 	unsigned reliable_ack, reliable_message;
+	qboolean fragment, compressed;
 
 	/* get sequence numbers */
 	MSG_BeginReading(msg);
@@ -327,6 +697,17 @@ Netchan_Process(netchan_t *chan, sizebuf_t *msg)
 		(void)MSG_ReadShort(msg);
 	}
 
+	fragment = compressed = false;
+
+	if (chan->extended)
+	{
+		fragment = (sequence & NETCHAN_FRAGMENT) != 0;
+		compressed = (sequence_ack & NETCHAN_COMPRESSED) != 0;
+
+		sequence &= ~NETCHAN_FRAGMENT;
+		sequence_ack &= ~NETCHAN_COMPRESSED;
+	}
+
 	reliable_message = sequence >> 31;
 	reliable_ack = sequence_ack >> 31;
 
@@ -363,6 +744,17 @@ Netchan_Process(netchan_t *chan, sizebuf_t *msg)
 		return false;
 	}
 
+	/* wait for the rest of the packet */
+	if (fragment && !Netchan_Reassemble(chan, msg, sequence))
+	{
+		return false;
+	}
+
+	if (compressed && !Netchan_InflateMessage(chan, msg))
+	{
+		return false;
+	}
+
 	/* dropped packets don't keep the message from being used */
 	chan->dropped = sequence - (chan->incoming_sequence + 1);
 
@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * Frame profiler. Code between PROF_BEGIN() and PROF_END() is recorded
+ * as a zone while the profile cvar is set. The events of the last
+ * profile_frames frames are kept in a ring buffer, profile_dump writes
+ * them as Chrome trace events (chrome://tracing, ui.perfetto.dev).
+ * Zones must be opened and closed on the main thread and can be nested.
+ * When profiling is off a zone costs a single test of prof_active.
+ *
+ * =======================================================================
+ */
+
+#include "header/common.h"
+
+#define PROF_MAXZONES 1024      /* distinct zone names */
+#define PROF_ZONENAMES 32768    /* bytes for the zone names */
+#define PROF_MAXEVENTS 4096     /* events per frame */
+#define PROF_MAXFRAMES 1024
+
+#define PROF_END_EVENT -1
+
+typedef struct
+{
+	int zone;                   /* index into prof_zones or PROF_END_EVENT */
+	long long time;             /* Sys_Microseconds() */
+} profevent_t;
+
+typedef struct
+{
+	long long start;
+	int numevents;
+	int dropped;
+	profevent_t events[PROF_MAXEVENTS];
+} profframe_t;
+
+qboolean prof_active;
+
+static cvar_t *profile;
+static cvar_t *profile_frames;
+
+static const char *prof_zones[PROF_MAXZONES];
+static unsigned prof_zonehashes[PROF_MAXZONES];
+static int prof_numzones;
+static char prof_zonenames[PROF_ZONENAMES];
+static int prof_zonenamesused;
+static int prof_overflowzone;
+
+static profframe_t *prof_frames;
+static int prof_numframes;
+static int prof_framecount;     /* frames recorded since the ring was set up */
+static profframe_t *prof_frame;
+
+static int prof_depth;          /* recorded zones still open */
+static int prof_skipdepth;      /* zones that didn't fit into the frame */
+
+/*
+ * Returns the index of a zone name. Names are copied, so the
+ * classnames of entities that are freed later can be used.
+ */
+static int
+Prof_Zone(const char *name)
+{
+	unsigned hash;
+	int i, len;
+
+	hash = 2166136261u;
+
+	for (i = 0; name[i]; i++)
+	{
+		hash = (hash ^ (byte)name[i]) * 16777619u;
+	}
+
+	len = i + 1;
+
+	for (i = hash & (PROF_MAXZONES - 1); prof_zones[i];
+		i = (i + 1) & (PROF_MAXZONES - 1))
+	{
+		if ((prof_zonehashes[i] == hash) && !strcmp(prof_zones[i], name))
+		{
+			return i;
+		}
+	}
+
+	/* keep one slot free, the probing above relies on it */
+	if ((prof_numzones >= PROF_MAXZONES - 1) ||
+		(prof_zonenamesused + len > PROF_ZONENAMES))
+	{
+		return prof_overflowzone;
+	}
+
+	memcpy(prof_zonenames + prof_zonenamesused, name, len);
+	prof_zones[i] = prof_zonenames + prof_zonenamesused;
+	prof_zonehashes[i] = hash;
+	prof_zonenamesused += len;
+	prof_numzones++;
+
+	return i;
+}
+
+void
+Prof_BeginZone(const char *name)
+{
+	profframe_t *frame = prof_frame;
+
+	if (!frame)
+	{
+		return;
+	}
+
+	/* leave room for closing everything that's open */
+	if (prof_skipdepth ||
+		(frame->numevents + prof_depth + 2 > PROF_MAXEVENTS))
+	{
+		prof_skipdepth++;
+		frame->dropped++;
+		return;
+	}
+
+	frame->events[frame->numevents].zone = Prof_Zone(name ? name : "(null)");
+	frame->events[frame->numevents].time = Sys_Microseconds();
+	frame->numevents++;
+	prof_depth++;
+}
+
+void
+Prof_EndZone(void)
+{
+	profframe_t *frame = prof_frame;
+
+	if (prof_skipdepth)
+	{
+		prof_skipdepth--;
+		return;
+	}
+
+	/* profiling was switched on inside the zone */
+	if (!frame || !prof_depth)
+	{
+		return;
+	}
+
+	frame->events[frame->numevents].zone = PROF_END_EVENT;
+	frame->events[frame->numevents].time = Sys_Microseconds();
+	frame->numevents++;
+	prof_depth--;
+}
+
+/*
+ * Closes the zones left open by the last frame,
+ * so that every begin event has its end.
+ */
+static void
+Prof_CloseFrame(void)
+{
+	if (!prof_frame)
+	{
+		return;
+	}
+
+	prof_skipdepth = 0;
+
+	while (prof_depth)
+	{
+		Prof_EndZone();
+	}
+
+	prof_frame = NULL;
+}
+
+static void
+Prof_FreeFrames(void)
+{
+	Prof_CloseFrame();
+
+	if (prof_frames)
+	{
+		Z_Free(prof_frames);
+	}
+
+	prof_frames = NULL;
+	prof_numframes = 0;
+	prof_framecount = 0;
+}
+
+/*
+ * Called at the start of each frame of the main loop.
+ */
+void
+Prof_Frame(void)
+{
+	if (!profile)
+	{
+		return;
+	}
+
+	Prof_CloseFrame();
+
+	prof_active = (profile->value != 0);
+
+	if (!prof_active)
+	{
+		return;
+	}
+
+	if (profile_frames->modified || !prof_frames)
+	{
+		profile_frames->modified = false;
+
+		Prof_FreeFrames();
+
+		prof_numframes = Q_clamp((int)profile_frames->value, 1,
+			PROF_MAXFRAMES);
+		prof_frames = Z_Malloc(prof_numframes * sizeof(profframe_t));
+	}
+
+	prof_frame = &prof_frames[prof_framecount % prof_numframes];
+	prof_frame->start = Sys_Microseconds();
+	prof_frame->numevents = 0;
+	prof_frame->dropped = 0;
+	prof_framecount++;
+}
+
+static void
+Prof_WriteName(FILE *f, const char *name)
+{
+	fputc('"', f);
+
+	for ( ; *name; name++)
+	{
+		if ((*name == '"') || (*name == '\\'))
+		{
+			fputc('\\', f);
+			fputc(*name, f);
+		}
+		else if ((byte)*name < ' ')
+		{
+			fprintf(f, "\\u%04x", (byte)*name);
+		}
+		else
+		{
+			fputc(*name, f);
+		}
+	}
+
+	fputc('"', f);
+}
+
+static void
+Prof_Dump_f(void)
+{
+	char name[MAX_OSPATH];
+	const char *filename;
+	int i, j, first, count, events, dropped;
+	qboolean comma;
+	FILE *f;
+
+	if (Cmd_Argc() > 2)
+	{
+		Com_Printf("Usage: profile_dump [name]\n");
+		return;
+	}
+
+	if (!prof_framecount)
+	{
+		Com_Printf("Nothing recorded, set profile to 1 first.\n");
+		return;
+	}
+
+	filename = (Cmd_Argc() == 2) ? Cmd_Argv(1) : "trace";
+
+	if (strstr(filename, "..") || strchr(filename, '/') ||
+		strchr(filename, '\\'))
+	{
+		Com_Printf("Illegal profile name.\n");
+		return;
+	}
+
+	Com_sprintf(name, sizeof(name), "%s/profiles/%s.json", FS_Gamedir(),
+		filename);
+
+	FS_CreatePath(name);
+	f = Q_fopen(name, "wb");
+
+	if (!f)
+	{
+		Com_Printf("ERROR: couldn't open %s.\n", name);
+		return;
+	}
+
+	/* the frame being recorded is left out, its zones aren't closed yet */
+	count = Q_min(prof_framecount - (prof_frame ? 1 : 0), prof_numframes);
+	first = prof_framecount - (prof_frame ? 1 : 0) - count;
+	events = dropped = 0;
+	comma = false;
+
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	for (i = 0; i < count; i++)
+	{
+		const profframe_t *frame = &prof_frames[(first + i) % prof_numframes];
+
+		fprintf(f, "%s{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\","
+			"\"ts\":%lld,\"pid\":1,\"tid\":1}", comma ? ",\n" : "",
+			frame->start);
+		comma = true;
+
+		for (j = 0; j < frame->numevents; j++)
+		{
+			const profevent_t *ev = &frame->events[j];
+
+			if (ev->zone == PROF_END_EVENT)
+			{
+				fprintf(f, ",\n{\"ph\":\"E\",\"ts\":%lld,\"pid\":1,\"tid\":1}",
+					ev->time);
+			}
+			else
+			{
+				fprintf(f, ",\n{\"name\":");
+				Prof_WriteName(f, prof_zones[ev->zone]);
+				fprintf(f, ",\"ph\":\"B\",\"ts\":%lld,\"pid\":1,\"tid\":1}",
+					ev->time);
+			}
+		}
+
+		events += frame->numevents;
+		dropped += frame->dropped;
+	}
+
+	fprintf(f, "\n]}\n");
+	fclose(f);
+
+	Com_Printf("Wrote %i frames with %i events to %s.\n", count, events, name);
+
+	if (dropped)
+	{
+		Com_Printf("%i zones didn't fit into their frame.\n", dropped);
+	}
+}
+
+void
+Prof_Init(void)
+{
+	profile = Cvar_Get("profile", "0", 0);
+	profile_frames = Cvar_Get("profile_frames", "64", CVAR_ARCHIVE);
+
+	if (!prof_numzones)
+	{
+		prof_overflowzone = Prof_Zone("(too many zones)");
+	}
+
+	Cmd_AddCommand("profile_dump", Prof_Dump_f);
+}
+
+void
+Prof_Shutdown(void)
+{
+	Cmd_RemoveCommand("profile_dump");
+
+	Prof_FreeFrames();
+	prof_active = false;
+	profile = NULL;
+}
@@ -1274,6 +1274,31 @@ Q_strcasecmp(const char *s1, const char *s2)
 	return Q_strncasecmp(s1, s2, 99999);
 }
 
+/*
+ * FNV-1a over the upper cased string, so anything
+ * equal by Q_stricmp() lands in the same bucket.
+ */
+unsigned int
+Q_strcasehash(const char *s)
+{
+	unsigned int hash = 2166136261u;
+
+	for (; *s != '\0'; s++)
+	{
+		int c = *s;
+
+		if ((c >= 'a') && (c <= 'z'))
+		{
+			c -= ('a' - 'A');
+		}
+
+		hash ^= (unsigned char)c;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
 void
 Q_replacebackslash(char *curr)
 {
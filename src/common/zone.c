@@ -19,7 +19,10 @@
  *
  * =======================================================================
  *
- * Zone malloc. It's just a normal malloc with tags.
+ * Zone malloc. Every tag has its own arena: small blocks are bump
+ * allocated from big chunks and recycled through free lists sorted
+ * by size, large blocks are plain mallocs. Freeing a tag releases
+ * its chunks and large blocks, not every single allocation.
  *
  * =======================================================================
  */
@@ -30,32 +33,150 @@
 
 #define Z_MAGIC 0x1d1d
 
+#define Z_ALIGN(x) (((x) + 15) & ~(size_t)15)
+#define Z_CHUNKSIZE (64 * 1024)
+#define Z_SMALLMAX 1024 /* larger requests get their own block */
+#define Z_NUMCLASSES (Z_ALIGN(Z_SMALLMAX + sizeof(zhead_t)) / 16 + 1)
+
 typedef struct zhead_s
 {
-	struct zhead_s *prev, *next;
-	size_t size;
+	struct zhead_s *prev, *next; /* large blocks, or free list (next) */
+	size_t size; /* requested size */
 	unsigned short magic;
 	unsigned short tag; /* for group free */
 } zhead_t;
 
-static zhead_t z_chain;
+typedef struct zchunk_s
+{
+	struct zchunk_s *next;
+	size_t used;
+} zchunk_t;
+
+typedef struct zarena_s
+{
+	struct zarena_s *next;
+	unsigned short tag;
+	zchunk_t *chunks;
+	size_t numchunks;
+	zhead_t large; /* list head of large blocks */
+	zhead_t *free[Z_NUMCLASSES]; /* free small blocks, by size */
+	size_t count, bytes;
+} zarena_t;
+
+static zarena_t *z_arenas;
 static size_t z_count, z_bytes;
+static size_t z_allocs, z_allocbytes; /* never decreased */
 
 void
 Z_Init(void)
 {
-	memset(&z_chain, 0, sizeof(z_chain));
-
-	z_chain.prev = &z_chain;
-	z_chain.next = &z_chain;
+	z_arenas = NULL;
 
 	z_count = 0;
 	z_bytes = 0;
 }
 
+/*
+ * Size of a small block including the header.
+ */
+static size_t
+Z_ClassSize(size_t size)
+{
+	return Z_ALIGN(size + sizeof(zhead_t));
+}
+
+/*
+ * Returns the arena of the given tag. Recently used
+ * arenas are moved to the front, the number of tags
+ * in use at the same time is low.
+ */
+static zarena_t *
+Z_GetArena(unsigned short tag, qboolean create)
+{
+	zarena_t *arena, **prev;
+
+	for (prev = &z_arenas, arena = z_arenas; arena;
+		prev = &arena->next, arena = arena->next)
+	{
+		if (arena->tag == tag)
+		{
+			*prev = arena->next;
+			arena->next = z_arenas;
+			z_arenas = arena;
+
+			return arena;
+		}
+	}
+
+	if (!create)
+	{
+		return NULL;
+	}
+
+	arena = calloc(1, sizeof(zarena_t));
+
+	if (!arena)
+	{
+		Com_Error(ERR_FATAL, "%s: failed to allocate arena for tag %i",
+			__func__, tag);
+		return NULL;
+	}
+
+	arena->tag = tag;
+	arena->large.prev = &arena->large;
+	arena->large.next = &arena->large;
+
+	arena->next = z_arenas;
+	z_arenas = arena;
+
+	return arena;
+}
+
+static zhead_t *
+Z_SmallAlloc(zarena_t *arena, size_t size)
+{
+	size_t blocksize;
+	zhead_t *z;
+
+	blocksize = Z_ClassSize(size);
+	z = arena->free[blocksize / 16];
+
+	if (z)
+	{
+		arena->free[blocksize / 16] = z->next;
+		memset(z, 0, blocksize);
+
+		return z;
+	}
+
+	if (!arena->chunks ||
+		(arena->chunks->used + blocksize > Z_CHUNKSIZE))
+	{
+		zchunk_t *chunk;
+
+		chunk = calloc(1, Z_CHUNKSIZE);
+
+		if (!chunk)
+		{
+			return NULL;
+		}
+
+		chunk->used = Z_ALIGN(sizeof(zchunk_t));
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		arena->numchunks++;
+	}
+
+	z = (zhead_t *)((byte *)arena->chunks + arena->chunks->used);
+	arena->chunks->used += blocksize;
+
+	return z;
+}
+
 void
 Z_Free(void *ptr)
 {
+	zarena_t *arena;
 	zhead_t *z;
 
 	if (!ptr)
@@ -71,19 +192,61 @@ Z_Free(void *ptr)
 		return;
 	}
 
-	z->prev->next = z->next;
-	z->next->prev = z->prev;
+	arena = Z_GetArena(z->tag, false);
 
+	if (!arena)
+	{
+		Com_Error(ERR_FATAL, "%s: no arena for tag %i: %p", __func__, z->tag, ptr);
+		return;
+	}
+
+	arena->count--;
+	arena->bytes -= z->size + sizeof(zhead_t);
 	z_count--;
-	z_bytes -= z->size;
+	z_bytes -= z->size + sizeof(zhead_t);
 
 	z->magic = 0; /* can avoid possible double free with check above */
-	free(z);
+
+	if (z->size > Z_SMALLMAX)
+	{
+		z->prev->next = z->next;
+		z->next->prev = z->prev;
+
+		free(z);
+	}
+	else
+	{
+		size_t blocksize;
+
+		blocksize = Z_ClassSize(z->size);
+		z->next = arena->free[blocksize / 16];
+		arena->free[blocksize / 16] = z;
+	}
+}
+
+/*
+ * Number and size of all allocations so far,
+ * freed blocks included.
+ */
+void
+Z_Allocations(size_t *count, size_t *bytes)
+{
+	*count = z_allocs;
+	*bytes = z_allocbytes;
 }
 
 void
 Z_Stats_f(void)
 {
+	const zarena_t *arena;
+
+	for (arena = z_arenas; arena; arena = arena->next)
+	{
+		Com_Printf("tag %5i: " YQ2_COM_PRIdS " bytes in " YQ2_COM_PRIdS
+			" blocks, " YQ2_COM_PRIdS " chunks\n", arena->tag,
+			arena->bytes, arena->count, arena->numchunks);
+	}
+
 	Com_Printf(YQ2_COM_PRIdS " bytes in " YQ2_COM_PRIdS " blocks\n",
 		z_bytes, z_count);
 }
@@ -91,22 +254,47 @@ Z_Stats_f(void)
 void
 Z_FreeTags(unsigned short tag)
 {
+	zarena_t *arena;
+	zchunk_t *chunk, *nextchunk;
 	zhead_t *z, *next;
 
-	for (z = z_chain.next; z != &z_chain; z = next)
+	arena = Z_GetArena(tag, false);
+
+	if (!arena)
+	{
+		return;
+	}
+
+	for (chunk = arena->chunks; chunk; chunk = nextchunk)
+	{
+		nextchunk = chunk->next;
+		free(chunk);
+	}
+
+	for (z = arena->large.next; z != &arena->large; z = next)
 	{
 		next = z->next;
 
-		if (z->tag == tag)
-		{
-			Z_Free((void *)(z + 1));
-		}
+		z->magic = 0;
+		free(z);
 	}
+
+	z_count -= arena->count;
+	z_bytes -= arena->bytes;
+
+	arena->chunks = NULL;
+	arena->numchunks = 0;
+	arena->large.prev = &arena->large;
+	arena->large.next = &arena->large;
+	memset(arena->free, 0, sizeof(arena->free));
+	arena->count = 0;
+	arena->bytes = 0;
 }
 
 void *
 Z_TagMalloc(size_t size, unsigned short tag)
 {
+	zarena_t *arena;
 	zhead_t *z;
 
 	if (!size || ((SIZE_MAX - size) < sizeof(zhead_t)))
@@ -116,27 +304,42 @@ Z_TagMalloc(size_t size, unsigned short tag)
 		return NULL;
 	}
 
-	size = size + sizeof(zhead_t);
-	z = calloc(1, size);
+	arena = Z_GetArena(tag, true);
+
+	if (size > Z_SMALLMAX)
+	{
+		z = calloc(1, size + sizeof(zhead_t));
+
+		if (z)
+		{
+			z->next = arena->large.next;
+			z->prev = &arena->large;
+			arena->large.next->prev = z;
+			arena->large.next = z;
+		}
+	}
+	else
+	{
+		z = Z_SmallAlloc(arena, size);
+	}
 
 	if (!z)
 	{
 		Com_Error(ERR_FATAL, "%s: failed to allocate " YQ2_COM_PRIdS " bytes",
-			__func__, size);
+			__func__, size + sizeof(zhead_t));
 		return NULL;
 	}
 
+	arena->count++;
+	arena->bytes += size + sizeof(zhead_t);
 	z_count++;
-	z_bytes += size;
+	z_bytes += size + sizeof(zhead_t);
+	z_allocs++;
+	z_allocbytes += size;
 	z->magic = Z_MAGIC;
 	z->tag = tag;
 	z->size = size;
 
-	z->next = z_chain.next;
-	z->prev = &z_chain;
-	z_chain.next->prev = z;
-	z_chain.next = z;
-
 	return (void *)(z + 1);
 }
 
@@ -149,7 +352,9 @@ Z_Malloc(size_t size)
 void *
 Z_TagRealloc(void *ptr, size_t size, unsigned short tag)
 {
+	zarena_t *arena;
 	zhead_t *z, *zr;
+	void *newptr;
 
 	if (!size || ((SIZE_MAX - size) < sizeof(zhead_t)))
 	{
@@ -171,25 +376,55 @@ Z_TagRealloc(void *ptr, size_t size, unsigned short tag)
 		return NULL;
 	}
 
-	size = size + sizeof(zhead_t);
-	zr = Q_realloc0(z, z->size, size);
-
-	if (!zr)
+	if (z->tag == tag)
 	{
-		Com_Error(ERR_FATAL, "%s: failed to allocate " YQ2_COM_PRIdS " bytes",
-			__func__, size);
-		return NULL;
-	}
+		arena = Z_GetArena(tag, false);
+
+		/* Still fits into the same small block. */
+		if ((z->size <= Z_SMALLMAX) && (size <= Z_SMALLMAX) &&
+			(Z_ClassSize(z->size) == Z_ClassSize(size)))
+		{
+			if (size > z->size)
+			{
+				memset((byte *)ptr + z->size, 0, size - z->size);
+			}
+
+			arena->bytes += size - z->size;
+			z_bytes += size - z->size;
+			z->size = size;
+
+			return ptr;
+		}
+
+		/* Large blocks stay large blocks. */
+		if ((z->size > Z_SMALLMAX) && (size > Z_SMALLMAX))
+		{
+			zr = Q_realloc0(z, z->size + sizeof(zhead_t), size + sizeof(zhead_t));
+
+			if (!zr)
+			{
+				Com_Error(ERR_FATAL, "%s: failed to allocate " YQ2_COM_PRIdS " bytes",
+					__func__, size + sizeof(zhead_t));
+				return NULL;
+			}
 
-	z_bytes -= zr->size;
-	z_bytes += size;
+			arena->bytes += size - zr->size;
+			z_bytes += size - zr->size;
 
-	zr->tag = tag;
-	zr->size = size;
-	zr->prev->next = zr;
-	zr->next->prev = zr;
+			zr->size = size;
+			zr->prev->next = zr;
+			zr->next->prev = zr;
 
-	return zr + 1;
+			return zr + 1;
+		}
+	}
+
+	/* Moves between arenas or block kinds. */
+	newptr = Z_TagMalloc(size, tag);
+	memcpy(newptr, ptr, Q_min(size, z->size));
+	Z_Free(ptr);
+
+	return newptr;
 }
 
 void *
@@ -215,6 +450,5 @@ Z_BlockSize(const void *ptr)
 		return 0;
 	}
 
-	return z->size - sizeof(*z);
+	return z->size;
 }
-
@@ -194,6 +194,9 @@ AI_AddLink( int n1, int n2, int linkType)
 
 	pLinks[n1].numLinks++;
 
+	/* routes may have changed */
+	AI_NavTableClear();
+
 	return true;
 }
 
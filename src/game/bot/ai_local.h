@@ -40,6 +40,8 @@
 // extern  cvar_t				*bot_showsrgoal;
 // extern  cvar_t				*bot_showlrgoal;
 extern cvar_t *bot_debugmonster;
+extern cvar_t *bot_pathbudget;
+extern cvar_t *bot_navtable;
 
 //----------------------------------------------------------
 
@@ -123,6 +125,13 @@ void AI_InitNavigationData(void);
 int AI_FlagsForNode( vec3_t origin, edict_t *passent );
 float AI_Distance(const vec3_t o1, const vec3_t o2);
 
+// ai_navtable.c
+//----------------------------------------------------------
+void AI_NavTableRequest(int movetypes);
+qboolean AI_NavTableLookup(int from, int to, int movetypes, int *hops, int *dist);
+qboolean AI_NavTablePath(int from, int to, int movetypes, struct astarpath_s *path,
+	qboolean *found);
+
 // ai_tools.c
 //----------------------------------------------------------
 void AIDebug_SetChased(const edict_t *ent);
@@ -161,6 +170,7 @@ qboolean AI_IsLadder(vec3_t origin, vec3_t v_angle, vec3_t mins, vec3_t maxs, ed
 //	A* PROPS
 //===========================================
 qboolean AStar_GetPath(int origin, int goal, int movetypes, struct astarpath_s *path);
+qboolean AStar_QueryBudgetLeft(void);
 
 /* ai_class_dmbot */
 qboolean BOT_DMclass_FindEnemy(edict_t *self);
@@ -34,6 +34,8 @@ ai_devel_t	AIDevel;
 // cvar_t *bot_showsrgoal;
 // cvar_t *bot_showlrgoal;
 cvar_t *bot_debugmonster;
+cvar_t *bot_pathbudget;
+cvar_t *bot_navtable;
 
 //ACE
 
@@ -49,6 +51,8 @@ void AI_Init(void)
 	// bot_showsrgoal = gi.cvar("bot_showsrgoal", "0", CVAR_SERVERINFO);
 	// bot_showlrgoal = gi.cvar("bot_showlrgoal", "0", CVAR_SERVERINFO);
 	bot_debugmonster = gi.cvar("bot_debugmonster", "0", CVAR_SERVERINFO|CVAR_ARCHIVE);
+	bot_pathbudget = gi.cvar("bot_pathbudget", "64", 0);
+	bot_navtable = gi.cvar("bot_navtable", "1", 0);
 
 	AIDevel.debugMode = false;
 	AIDevel.debugChased = false;
@@ -175,6 +179,19 @@ AI_PickLongRangeGoal(edict_t *self)
 	// edict_t *goal_ent = NULL;
 	float cost;
 	float dist;
+	int hops, pathdist;
+	qboolean routed;
+
+	// every candidate goal costs a path query, if other bots
+	// used up this frame's budget try again next frame
+	if (!AStar_QueryBudgetLeft())
+	{
+		if (self->ai->state != BOT_STATE_WANDER)
+			AI_SetUpMoveWander( self );
+
+		self->ai->wander_timeout = level.time;
+		return;
+	}
 
 	// look for a target
 	current_node = AI_FindClosestReachableNode(self->s.origin, self,((1+self->ai->nearest_node_tries)*NODE_DENSITY),NODE_ALL);
@@ -194,6 +211,8 @@ AI_PickLongRangeGoal(edict_t *self)
 	}
 	self->ai->nearest_node_tries = 0;
 
+	AI_NavTableRequest(self->ai->pers.moveTypesMask);
+
 	// Items
 	for(i=0;i<nav.num_items;i++)
 	{
@@ -210,8 +229,21 @@ AI_PickLongRangeGoal(edict_t *self)
 		if (weight == 0.0f)	//ignore zero weighted items
 			continue;
 
-		//limit cost finding distance
-		dist = AI_Distance( self->s.origin, nav.items[i].ent->s.origin );
+		//limit cost finding distance, use the real route length if known
+		routed = AI_NavTableLookup(current_node, nav.items[i].node,
+			self->ai->pers.moveTypesMask, &hops, &pathdist);
+
+		if (routed)
+		{
+			if (hops < 0)
+				continue;
+
+			dist = pathdist;
+		}
+		else
+		{
+			dist = AI_Distance( self->s.origin, nav.items[i].ent->s.origin );
+		}
 
 		//different distance limits for different types
 		if (nav.items[i].ent->item->flags & (IT_AMMO|IT_TECH) && dist > 2000)
@@ -223,7 +255,11 @@ AI_PickLongRangeGoal(edict_t *self)
 		if (nav.items[i].ent->item->flags & (IT_WEAPON|IT_FLAG) && dist > 10000)
 			continue;
 
-		cost = AI_FindCost(current_node, nav.items[i].node, self->ai->pers.moveTypesMask);
+		if (routed)
+			cost = hops - 1; // same as the A* path length
+		else
+			cost = AI_FindCost(current_node, nav.items[i].node, self->ai->pers.moveTypesMask);
+
 		if (cost == INVALID || cost < 3) // ignore invalid and very short hops
 			continue;
 
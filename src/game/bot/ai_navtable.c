@@ -0,0 +1,590 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * Precomputed all-pairs routes over the navigation graph. For every
+ * movetype mask the bots ask for, a table with the next hop, the
+ * number of hops and the link distance between each pair of nodes is
+ * built a few rows per server frame and stored next to the .nav file.
+ * Until a table is complete the A* search answers the queries.
+ *
+ * =======================================================================
+ */
+
+#include <limits.h>
+#include "../header/local.h"
+#include "ai_local.h"
+
+#define NAVTABLE_MAX 4
+#define NAVTABLE_EDGES_PER_FRAME 65536
+#define NAVTABLE_EXTENSION "nvt"
+#define NAVTABLE_IDENT (('T' << 24) + ('V' << 16) + ('A' << 8) + 'N')
+#define NAVTABLE_VERSION 1
+
+typedef struct
+{
+	int movetypes;
+	int numnodes;
+	int builtrows;			/* table is usable once all rows are built */
+	unsigned int checksum;	/* of the graph the table was built for */
+
+	short *next;			/* [from * numnodes + to], -1 if unreachable */
+	unsigned short *hops;
+	int *dist;
+} navtable_t;
+
+typedef struct
+{
+	int ident;
+	int version;
+	int movetypes;
+	int numnodes;
+	unsigned int checksum;
+} navtableheader_t;
+
+static navtable_t navtables[NAVTABLE_MAX];
+static int num_navtables;
+
+/* scratch space for building one row */
+static int row_dist[MAX_NODES];
+static int row_parent[MAX_NODES];
+static qboolean row_done[MAX_NODES];
+static int row_heap[MAX_NODES * NODES_MAX_PLINKS + 1];
+static int row_heapkey[MAX_NODES * NODES_MAX_PLINKS + 1];
+static int row_heapnum;
+static int row_order[MAX_NODES];
+
+static unsigned int
+AI_NavTableChecksum(void)
+{
+	const byte *data;
+	unsigned int hash = 2166136261u;
+	size_t i, size;
+
+	data = (const byte *)nodes;
+	size = nav.num_nodes * sizeof(nav_node_t);
+
+	for (i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+
+	data = (const byte *)pLinks;
+	size = nav.num_nodes * sizeof(nav_plink_t);
+
+	for (i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void
+AI_NavTableFileName(const navtable_t *table, char *filename, size_t size)
+{
+	Com_sprintf(filename, size, "%s/%s/%s_%x.%s",
+		gi.Gamedir(), AI_NODES_FOLDER, level.mapname, table->movetypes,
+		NAVTABLE_EXTENSION);
+}
+
+static size_t
+AI_NavTableSize(int numnodes)
+{
+	return (size_t)numnodes * numnodes *
+		(sizeof(short) + sizeof(unsigned short) + sizeof(int));
+}
+
+static qboolean
+AI_NavTableAlloc(navtable_t *table)
+{
+	size_t cells;
+	byte *buf;
+
+	cells = (size_t)table->numnodes * table->numnodes;
+	buf = malloc(AI_NavTableSize(table->numnodes));
+
+	if (!buf)
+	{
+		return false;
+	}
+
+	table->dist = (int *)buf;
+	table->next = (short *)(buf + cells * sizeof(int));
+	table->hops = (unsigned short *)(buf + cells * (sizeof(int) + sizeof(short)));
+
+	return true;
+}
+
+static qboolean
+AI_NavTableLoad(navtable_t *table)
+{
+	char filename[MAX_OSPATH];
+	navtableheader_t header;
+	size_t cells;
+	FILE *f;
+
+	AI_NavTableFileName(table, filename, sizeof(filename));
+
+	f = Q_fopen(filename, "rb");
+
+	if (!f)
+	{
+		return false;
+	}
+
+	cells = (size_t)table->numnodes * table->numnodes;
+
+	if (fread(&header, sizeof(header), 1, f) != 1 ||
+		header.ident != NAVTABLE_IDENT ||
+		header.version != NAVTABLE_VERSION ||
+		header.movetypes != table->movetypes ||
+		header.numnodes != table->numnodes ||
+		header.checksum != table->checksum ||
+		fread(table->dist, sizeof(int), cells, f) != cells ||
+		fread(table->next, sizeof(short), cells, f) != cells ||
+		fread(table->hops, sizeof(unsigned short), cells, f) != cells)
+	{
+		fclose(f);
+		return false;
+	}
+
+	fclose(f);
+
+	table->builtrows = table->numnodes;
+
+	return true;
+}
+
+static void
+AI_NavTableSave(const navtable_t *table)
+{
+	char filename[MAX_OSPATH];
+	navtableheader_t header;
+	size_t cells;
+	FILE *f;
+
+	AI_NavTableFileName(table, filename, sizeof(filename));
+	gi.CreatePath(filename);
+
+	f = Q_fopen(filename, "wb");
+
+	if (!f)
+	{
+		Com_Printf("%s: Couldn't write %s\n", __func__, filename);
+		return;
+	}
+
+	header.ident = NAVTABLE_IDENT;
+	header.version = NAVTABLE_VERSION;
+	header.movetypes = table->movetypes;
+	header.numnodes = table->numnodes;
+	header.checksum = table->checksum;
+
+	cells = (size_t)table->numnodes * table->numnodes;
+
+	fwrite(&header, sizeof(header), 1, f);
+	fwrite(table->dist, sizeof(int), cells, f);
+	fwrite(table->next, sizeof(short), cells, f);
+	fwrite(table->hops, sizeof(unsigned short), cells, f);
+
+	fclose(f);
+}
+
+static void
+AI_NavTableHeapPush(int node, int key)
+{
+	int pos = row_heapnum++;
+
+	while (pos > 0)
+	{
+		int parent = (pos - 1) / 2;
+
+		if (row_heapkey[parent] <= key)
+		{
+			break;
+		}
+
+		row_heap[pos] = row_heap[parent];
+		row_heapkey[pos] = row_heapkey[parent];
+		pos = parent;
+	}
+
+	row_heap[pos] = node;
+	row_heapkey[pos] = key;
+}
+
+static int
+AI_NavTableHeapPop(void)
+{
+	int best, node, key, pos;
+
+	best = row_heap[0];
+	row_heapnum--;
+
+	node = row_heap[row_heapnum];
+	key = row_heapkey[row_heapnum];
+	pos = 0;
+
+	while (1)
+	{
+		int child = pos * 2 + 1;
+
+		if (child >= row_heapnum)
+		{
+			break;
+		}
+
+		if (child + 1 < row_heapnum && row_heapkey[child + 1] < row_heapkey[child])
+		{
+			child++;
+		}
+
+		if (key <= row_heapkey[child])
+		{
+			break;
+		}
+
+		row_heap[pos] = row_heap[child];
+		row_heapkey[pos] = row_heapkey[child];
+		pos = child;
+	}
+
+	row_heap[pos] = node;
+	row_heapkey[pos] = key;
+
+	return best;
+}
+
+/*
+ * Dijkstra from one node, returns the number of links looked at
+ */
+static int
+AI_NavTableBuildRow(navtable_t *table, int from)
+{
+	int *dist;
+	short *next;
+	unsigned short *hops;
+	int i, numsettled, edges;
+
+	for (i = 0; i < table->numnodes; i++)
+	{
+		row_dist[i] = INT_MAX;
+		row_parent[i] = -1;
+		row_done[i] = false;
+	}
+
+	row_dist[from] = 0;
+	row_heapnum = 0;
+	AI_NavTableHeapPush(from, 0);
+
+	numsettled = 0;
+	edges = 0;
+
+	while (row_heapnum)
+	{
+		int node;
+
+		node = AI_NavTableHeapPop();
+
+		if (row_done[node])
+		{
+			continue;
+		}
+
+		row_done[node] = true;
+		row_order[numsettled++] = node;
+
+		for (i = 0; i < pLinks[node].numLinks; i++)
+		{
+			int addnode, d;
+
+			edges++;
+
+			if (!(table->movetypes & pLinks[node].moveType[i]))
+			{
+				continue;
+			}
+
+			addnode = pLinks[node].nodes[i];
+
+			if (addnode == node || row_done[addnode] ||
+				pLinks[node].dist[i] < 0)
+			{
+				continue;
+			}
+
+			d = row_dist[node] + pLinks[node].dist[i];
+
+			if (d < row_dist[addnode])
+			{
+				row_dist[addnode] = d;
+				row_parent[addnode] = node;
+				AI_NavTableHeapPush(addnode, d);
+			}
+		}
+	}
+
+	dist = table->dist + (size_t)from * table->numnodes;
+	next = table->next + (size_t)from * table->numnodes;
+	hops = table->hops + (size_t)from * table->numnodes;
+
+	for (i = 0; i < table->numnodes; i++)
+	{
+		dist[i] = -1;
+		next[i] = -1;
+		hops[i] = 0;
+	}
+
+	dist[from] = 0;
+
+	/* parents are settled first, so their first hop is known */
+	for (i = 1; i < numsettled; i++)
+	{
+		int node, parent;
+
+		node = row_order[i];
+		parent = row_parent[node];
+
+		dist[node] = row_dist[node];
+		next[node] = (parent == from) ? node : next[parent];
+		hops[node] = hops[parent] + 1;
+	}
+
+	return edges;
+}
+
+/*
+ * Drops all tables, called whenever nodes or links change
+ */
+void
+AI_NavTableClear(void)
+{
+	int i;
+
+	for (i = 0; i < num_navtables; i++)
+	{
+		/* next and hops share the allocation */
+		free(navtables[i].dist);
+	}
+
+	memset(navtables, 0, sizeof(navtables));
+	num_navtables = 0;
+}
+
+/*
+ * Asks for a table for the given movetypes,
+ * it's loaded from disk or built over the next frames
+ */
+void
+AI_NavTableRequest(int movetypes)
+{
+	navtable_t *table;
+	int i;
+
+	if (!bot_navtable->value || !nav.loaded || !movetypes ||
+		nav.num_nodes <= 0)
+	{
+		return;
+	}
+
+	for (i = 0; i < num_navtables; i++)
+	{
+		if (navtables[i].movetypes == movetypes)
+		{
+			return;
+		}
+	}
+
+	if (num_navtables == NAVTABLE_MAX)
+	{
+		return;
+	}
+
+	table = &navtables[num_navtables];
+	table->movetypes = movetypes;
+	table->numnodes = nav.num_nodes;
+	table->checksum = AI_NavTableChecksum();
+
+	if (!AI_NavTableAlloc(table))
+	{
+		Com_Printf("%s: Couldn't allocate %d KiB\n", __func__,
+			(int)(AI_NavTableSize(table->numnodes) / 1024));
+		memset(table, 0, sizeof(*table));
+		return;
+	}
+
+	num_navtables++;
+
+	if (AI_NavTableLoad(table) && bot_debugmonster->value)
+	{
+		Com_Printf("AI: Loaded route table for movetypes %x.\n", movetypes);
+	}
+}
+
+/*
+ * Builds rows of incomplete tables, one table at a time
+ */
+void
+AI_NavTableFrame(void)
+{
+	int i, edges;
+
+	for (i = 0; i < num_navtables; i++)
+	{
+		navtable_t *table = &navtables[i];
+
+		if (table->builtrows == table->numnodes)
+		{
+			continue;
+		}
+
+		edges = 0;
+
+		while (table->builtrows < table->numnodes &&
+			edges < NAVTABLE_EDGES_PER_FRAME)
+		{
+			edges += AI_NavTableBuildRow(table, table->builtrows);
+			table->builtrows++;
+		}
+
+		if (table->builtrows == table->numnodes)
+		{
+			if (bot_debugmonster->value)
+			{
+				Com_Printf("AI: Built route table for movetypes %x.\n",
+					table->movetypes);
+			}
+
+			AI_NavTableSave(table);
+		}
+
+		return;
+	}
+}
+
+static const navtable_t *
+AI_NavTableFind(int from, int to, int movetypes)
+{
+	int i;
+
+	for (i = 0; i < num_navtables; i++)
+	{
+		const navtable_t *table = &navtables[i];
+
+		if (table->movetypes != movetypes)
+		{
+			continue;
+		}
+
+		if (table->builtrows != table->numnodes ||
+			from < 0 || from >= table->numnodes ||
+			to < 0 || to >= table->numnodes)
+		{
+			return NULL;
+		}
+
+		return table;
+	}
+
+	return NULL;
+}
+
+/*
+ * Looks up the number of hops and the distance of the best route,
+ * hops is set to -1 if there is none. Returns false if there is no
+ * table, the caller has to search the path itself.
+ */
+qboolean
+AI_NavTableLookup(int from, int to, int movetypes, int *hops, int *dist)
+{
+	const navtable_t *table;
+	size_t cell;
+
+	table = AI_NavTableFind(from, to, movetypes);
+
+	if (!table)
+	{
+		return false;
+	}
+
+	cell = (size_t)from * table->numnodes + to;
+
+	if (from != to && table->next[cell] < 0)
+	{
+		*hops = -1;
+		*dist = -1;
+	}
+	else
+	{
+		*hops = table->hops[cell];
+		*dist = table->dist[cell];
+	}
+
+	return true;
+}
+
+/*
+ * Fills a path like AStar_GetPath() does: goal first, the node
+ * after origin last. Returns false if there is no table.
+ */
+qboolean
+AI_NavTablePath(int from, int to, int movetypes, struct astarpath_s *path,
+	qboolean *found)
+{
+	const navtable_t *table;
+	int count, cur;
+
+	table = AI_NavTableFind(from, to, movetypes);
+
+	if (!table)
+	{
+		return false;
+	}
+
+	*found = false;
+
+	if (from == to)
+	{
+		return true;
+	}
+
+	count = table->hops[(size_t)from * table->numnodes + to];
+
+	if (table->next[(size_t)from * table->numnodes + to] < 0 ||
+		count > MAX_NODES)
+	{
+		return true;
+	}
+
+	path->numNodes = count - 1;
+
+	for (cur = from; cur != to; )
+	{
+		cur = table->next[(size_t)cur * table->numnodes + to];
+		path->nodes[--count] = cur;
+	}
+
+	*found = true;
+
+	return true;
+}
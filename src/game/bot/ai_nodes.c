@@ -1019,6 +1019,8 @@ AI_LinkServerNodes(int start)
 void
 AI_CleanNodesAndLinks(void)
 {
+	AI_NavTableClear();
+
 	nav.num_nodes = 0;
 	memset(nodes, 0, sizeof(nav_node_t) * MAX_NODES);
 	memset(pLinks, 0, sizeof(nav_plink_t) * MAX_NODES);
@@ -31,9 +31,6 @@
 //
 //==========================================
 
-static int alist[MAX_NODES];	//list contains all studied nodes, Open and Closed together
-static int alist_nodesnum;
-
 typedef enum {
 	NOLIST,
 	OPENLIST,
@@ -45,11 +42,24 @@ typedef struct
 	int parent;
 	int g;
 	int h;
+	int heapindex;	// position in the open heap while in OPENLIST
 
+	// state is only valid if generation matches astar_generation,
+	// so nothing has to be cleared between queries
+	unsigned int generation;
 	astarnodelist_e list;
 } astarnode_t;
 
 static astarnode_t	astar_nodes[MAX_NODES];
+static unsigned int astar_generation;
+
+// open list, binary min heap on f = g + h
+static int astar_heap[MAX_NODES];
+static int astar_heapnum;
+
+// path queries started in astar_queryframe
+static int astar_queryframe = -1;
+static int astar_queries;
 
 //==========================================
 //
@@ -84,13 +94,24 @@ AStar_IsValidNode(int node)
 	return (node >= 0 && node < MAX_NODES);
 }
 
+static inline astarnodelist_e
+AStar_NodeList(int node)
+{
+	if (astar_nodes[node].generation != astar_generation)
+	{
+		return NOLIST;
+	}
+
+	return astar_nodes[node].list;
+}
+
 /*
  * Check if a node is in the Closed list.
  */
 static inline qboolean
 AStar_nodeIsInClosed(int node)
 {
-	return (AStar_IsValidNode(node) && astar_nodes[node].list == CLOSEDLIST);
+	return (AStar_IsValidNode(node) && AStar_NodeList(node) == CLOSEDLIST);
 }
 
 /*
@@ -99,24 +120,120 @@ AStar_nodeIsInClosed(int node)
 static inline qboolean
 AStar_nodeIsInOpen(int node)
 {
-	return (AStar_IsValidNode(node) && astar_nodes[node].list == OPENLIST);
+	return (AStar_IsValidNode(node) && AStar_NodeList(node) == OPENLIST);
 }
 
 static void
 AStar_InitLists(void)
 {
-	size_t i;
+	astar_generation++;
+
+	// on wrap around old stamps could match again
+	if (!astar_generation)
+	{
+		memset(astar_nodes, 0, sizeof(astar_nodes));
+		astar_generation = 1;
+	}
+
+	astar_heapnum = 0;
+}
+
+static inline int
+AStar_F(int node)
+{
+	return astar_nodes[node].g + astar_nodes[node].h;
+}
+
+static inline void
+AStar_HeapSet(int pos, int node)
+{
+	astar_heap[pos] = node;
+	astar_nodes[node].heapindex = pos;
+}
+
+static void
+AStar_HeapUp(int pos)
+{
+	int node = astar_heap[pos];
+	int f = AStar_F(node);
+
+	while (pos > 0)
+	{
+		int parent = (pos - 1) / 2;
+
+		if (AStar_F(astar_heap[parent]) <= f)
+		{
+			break;
+		}
+
+		AStar_HeapSet(pos, astar_heap[parent]);
+		pos = parent;
+	}
+
+	AStar_HeapSet(pos, node);
+}
+
+static void
+AStar_HeapDown(int pos)
+{
+	int node = astar_heap[pos];
+	int f = AStar_F(node);
+
+	while (1)
+	{
+		int child = pos * 2 + 1;
+
+		if (child >= astar_heapnum)
+		{
+			break;
+		}
+
+		if (child + 1 < astar_heapnum &&
+			AStar_F(astar_heap[child + 1]) < AStar_F(astar_heap[child]))
+		{
+			child++;
+		}
+
+		if (f <= AStar_F(astar_heap[child]))
+		{
+			break;
+		}
+
+		AStar_HeapSet(pos, astar_heap[child]);
+		pos = child;
+	}
+
+	AStar_HeapSet(pos, node);
+}
 
-	for (i = 0; i < MAX_NODES; i++)
+static void
+AStar_HeapPush(int node)
+{
+	astar_heap[astar_heapnum] = node;
+	astar_heapnum++;
+	AStar_HeapUp(astar_heapnum - 1);
+}
+
+static int
+AStar_HeapPop(void)
+{
+	int best;
+
+	if (!astar_heapnum)
 	{
-		astar_nodes[i].g = 0;
-		astar_nodes[i].h = 0;
-		astar_nodes[i].parent = 0;
-		astar_nodes[i].list = NOLIST;
+		return -1;
+	}
+
+	best = astar_heap[0];
+	astar_heapnum--;
+
+	if (astar_heapnum)
+	{
+		astar_heap[0] = astar_heap[astar_heapnum];
+		AStar_HeapDown(0);
 	}
 
-	alist_nodesnum = 0;
-	memset(alist, -1, sizeof(alist));
+	return best;
 }
 
 static int
@@ -191,12 +308,7 @@ AStar_PutInClosed(int node)
 		return;
 	}
 
-	if (!astar_nodes[node].list)
-	{
-		alist[alist_nodesnum] = node;
-		alist_nodesnum++;
-	}
-
+	astar_nodes[node].generation = astar_generation;
 	astar_nodes[node].list = CLOSEDLIST;
 }
 
@@ -256,6 +368,9 @@ AStar_PutAdjacentsInOpen(int node)
 			{
 				astar_nodes[addnode].parent = node;
 				astar_nodes[addnode].g = astar_nodes[node].g + plink_dist;
+
+				// decrease key
+				AStar_HeapUp(astar_nodes[addnode].heapindex);
 			}
 		}
 		else
@@ -279,17 +394,13 @@ AStar_PutAdjacentsInOpen(int node)
 				}
 			}
 
-			// put in global list
-			if (!astar_nodes[addnode].list)
-			{
-				alist[alist_nodesnum] = addnode;
-				alist_nodesnum++;
-			}
-
 			astar_nodes[addnode].parent = node;
 			astar_nodes[addnode].g = astar_nodes[node].g + plink_dist;
 			astar_nodes[addnode].h = Astar_HDist_ManhatanGuess( addnode );
+			astar_nodes[addnode].generation = astar_generation;
 			astar_nodes[addnode].list = OPENLIST;
+
+			AStar_HeapPush(addnode);
 		}
 	}
 }
@@ -297,25 +408,11 @@ AStar_PutAdjacentsInOpen(int node)
 static int
 AStar_FindInOpen_BestF(void)
 {
-	size_t i;
-	int	bestF = -1;
-	int best = -1;
+	int best;
 
-	for (i = 0; i < alist_nodesnum; i++)
-	{
-		int node = alist[i];
-
-		if (!AStar_IsValidNode(node) || astar_nodes[node].list != OPENLIST)
-		{
-			continue;
-		}
-
-		if (bestF < 0 || bestF > (astar_nodes[node].g + astar_nodes[node].h))
-		{
-			bestF = astar_nodes[node].g + astar_nodes[node].h;
-			best = node;
-		}
-	}
+	// the best node leaves the open list, it's put in
+	// the closed one as the next current node
+	best = AStar_HeapPop();
 
 	if (bot_debugmonster->value)
 	{
@@ -397,9 +494,48 @@ AStar_ResolvePath(int origin, int goal, int movetypes, struct astarpath_s *path)
 	return true;
 }
 
+/*
+ * Counts the path queries of this server frame and tells
+ * if callers with optional queries should go ahead.
+ */
+qboolean
+AStar_QueryBudgetLeft(void)
+{
+	if (astar_queryframe != level.framenum)
+	{
+		return true;
+	}
+
+	return (bot_pathbudget->value <= 0 ||
+		astar_queries < (int)bot_pathbudget->value);
+}
+
 qboolean
 AStar_GetPath(int origin, int goal, int movetypes, struct astarpath_s *path)
 {
+	qboolean found;
+
+	// precomputed routes are free
+	if (AI_NavTablePath(origin, goal, movetypes, path, &found))
+	{
+		if (!found)
+		{
+			return false;
+		}
+
+		path->originNode = origin;
+		path->goalNode = goal;
+		return true;
+	}
+
+	if (astar_queryframe != level.framenum)
+	{
+		astar_queryframe = level.framenum;
+		astar_queries = 0;
+	}
+
+	astar_queries++;
+
 	if (!AStar_ResolvePath(origin, goal, movetypes, path))
 	{
 		return false;
@@ -106,6 +106,7 @@ cvar_t *g_itemsbobeffect;
 cvar_t *g_start_items;
 cvar_t *ai_model_scale;
 cvar_t *g_game;
+cvar_t *g_profile;
 
 static void G_RunFrame(void);
 
@@ -119,6 +120,7 @@ ShutdownGame(void)
 	gi.FreeTags(TAG_LEVEL);
 	gi.FreeTags(TAG_GAME);
 	SpawnFree();
+	AI_NavTableClear();
 }
 
 /*
@@ -483,10 +485,13 @@ G_RunFrame(void)
 	/* choose a client for monsters to target this frame */
 	AI_SetSightClient();
 
+	G_PROF_BEGIN("G_RunFrame");
+
 	/* exit intermissions */
 	if (level.exitintermission)
 	{
 		ExitLevel();
+		G_PROF_END();
 		return;
 	}
 
@@ -528,7 +533,10 @@ G_RunFrame(void)
 				continue;
 		}
 
+		/* one zone per classname */
+		G_PROF_BEGIN(ent->classname);
 		G_RunEntity(ent);
+		G_PROF_END();
 	}
 
 	/* see if it is time to end a deathmatch */
@@ -542,5 +550,8 @@ G_RunFrame(void)
 
 	//JABot[start]
 	AITools_Frame();	//give think time to AI debug tools
+	AI_NavTableFrame();	//build route tables in the background
 	//[end]
+
+	G_PROF_END();
 }
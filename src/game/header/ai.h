@@ -116,6 +116,10 @@ void BOT_Respawn(edict_t *self);
 void AITools_Frame(void);
 void AITools_DropNodes(edict_t *ent);
 
+/* ai_navtable.c */
+void AI_NavTableClear(void);
+void AI_NavTableFrame(void);
+
 /* ai_dropnodes.c */
 void AITools_SaveNodes(void);
 void AITools_InitEditnodes(void);
@@ -36,7 +36,8 @@
  */
 
 #define GAME_API_R97_VERSION 3
-#define GAME_API_VERSION 4
+#define GAME_API_V4_VERSION 4 /* before ProfileBegin() and ProfileEnd() */
+#define GAME_API_VERSION 5
 
 /* edict->svflags */
 #define SVF_NOCLIENT 0x00000001             /* don't send entity to clients, even if it has effects */
@@ -221,6 +222,10 @@ typedef struct
 
 	const char* (*LocalizationMessage)(const char *message, int *sound_index);
 	const char* (*LocalizationUIMessage)(const char *message, const char *default_message);
+
+	/* frame profiler zones, recorded while the profile cvar is set */
+	void (*ProfileBegin)(const char *name);
+	void (*ProfileEnd)(void);
 } game_import_t;
 
 /* functions exported by the game subsystem */
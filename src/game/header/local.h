@@ -782,6 +782,13 @@ extern cvar_t *g_itemsbobeffect;
 extern cvar_t *g_start_items;
 extern cvar_t *ai_model_scale;
 extern cvar_t *g_game;
+extern cvar_t *g_profile;
+
+/* zones of the engine's frame profiler */
+#define G_PROF_BEGIN(name) \
+	do { if (g_profile->value) { gi.ProfileBegin(name); } } while (0)
+#define G_PROF_END() \
+	do { if (g_profile->value) { gi.ProfileEnd(); } } while (0)
 
 /* this is for the count of monsters */
 #define ENT_SLOTS_LEFT \
@@ -181,6 +181,16 @@ BeginIntermission(const edict_t *targ)
 
 	level.exitintermission = 0;
 
+	/* let the server read the next map while the scores are up */
+	if (level.changemap && level.changemap[0])
+	{
+		char command[256];
+
+		Com_sprintf(command, sizeof(command), "sv_prefetch \"%s\"\n",
+			level.changemap);
+		gi.AddCommandString(command);
+	}
+
 	/* find an intermission spot */
 	ent = G_Find(NULL, FOFS(classname), "info_player_intermission");
 
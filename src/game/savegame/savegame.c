@@ -446,6 +446,7 @@ InitGame(void)
 	g_swap_speed = gi.cvar("g_swap_speed", "1", CVAR_ARCHIVE);
 	g_itemsbobeffect = gi.cvar("g_itemsbobeffect", "0", CVAR_ARCHIVE);
 	g_game = gi.cvar("game", "", 0);
+	g_profile = gi.cvar("profile", "0", 0);
 	g_start_items = gi.cvar("g_start_items", "", 0);
 	ai_model_scale = gi.cvar("ai_model_scale", "0", 0);
 
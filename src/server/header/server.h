@@ -152,6 +152,8 @@ typedef struct client_s
 	netchan_t netchan;
 	int protocol;
 
+	struct client_s *hashnext;          /* SV_FindClient chain */
+
 	/* per-frame caches for SV_Multicast fanout */
 	vec3_t cached_origin;
 	int cached_leafnum;
@@ -214,6 +216,9 @@ extern cvar_t *sv_airaccelerate;            /* don't reload level state when ree
 extern cvar_t *sv_enforcetime;
 extern cvar_t *sv_downloadserver;			/* Download server. */
 extern cvar_t *sv_language;			/* Localization. */
+extern cvar_t *sv_broadphase;			/* World linking. */
+extern cvar_t *sv_threads;				/* Parallel client frames. */
+extern cvar_t *sv_oobrate;				/* Connectionless packet limit. */
 
 extern client_t *sv_client;
 extern edict_t *sv_player;
@@ -253,6 +258,8 @@ void SV_SendClientMessages(void);
 void SV_SendPrepClientMessages(void);
 
 void SV_Multicast(const vec3_t origin, multicast_t to);
+void SV_ClientMoved(const edict_t *ent);
+void SV_ClearClusters(void);
 void SV_StartSound(const vec3_t origin, const edict_t *entity, int channel,
 		int soundindex, float volume, float attenuation,
 		float timeofs);
@@ -268,9 +275,18 @@ void SV_ReadLevelFile(void);
 char *SV_StatusString(void);
 void SV_ConnectionlessPacket(void);
 
-void SV_WriteFrameToClient(client_t *client, sizebuf_t *msg);
+void SV_ClearClientHash(void);
+void SV_HashClient(client_t *cl);
+void SV_UnhashClient(client_t *cl);
+qboolean SV_ConnectionlessAllowed(netadr_t adr);
+
+void SV_WriteFrameToClient(client_t *client, sizebuf_t *msg, int worker);
 void SV_RecordDemoMessage(void);
 void SV_BuildClientFrame(client_t *client);
+void SV_BuildClientFrames(client_t **clients, int count);
+void SV_FreeFrameBuffers(void);
+void SV_ResetDeltaCache(void);
+void SV_DeltaStats_f(void);
 
 extern game_export_t *ge;
 
@@ -290,6 +306,8 @@ void SV_Savegame_f(void);
 
 /* high level object sorting to reduce interaction tests */
 void SV_ClearWorld(void);
+void SV_FreeWorld(void);
+void SV_WorldStats_f(void);
 
 /* called after the world model has been loaded, before linking any entities */
 void SV_UnlinkEdict(edict_t *ent);
@@ -321,5 +339,25 @@ trace_t SV_Trace(const vec3_t start, const vec3_t mins, const vec3_t maxs,
 
 int SV_Optimizations(void);
 
+/* time spent in the phases of SV_Frame(), in microseconds */
+typedef struct
+{
+	long long readpackets;
+	long long rungame;
+	long long sendmessages;
+} sv_frametimes_t;
+
+extern sv_frametimes_t sv_frametimes;
+
+/* server benchmark with in-process clients */
+void SV_Bench_f(void);
+void SV_BenchRecord_f(void);
+void SV_BenchStop_f(void);
+void SV_BenchRecordCmd(const client_t *cl, const usercmd_t *cmd);
+
+void SV_Prefetch_f(void);
+void SV_PrefetchFrame(void);
+void SV_PrefetchStop(void);
+
 #endif
 
@@ -0,0 +1,670 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * Server benchmark. sv_bench connects a number of in-process clients
+ * over the loopback, lets them replay movement commands for a fixed
+ * number of frames and reports where the server spent its time. The
+ * commands are either recorded from a real client with sv_benchrecord
+ * or generated. Works on dedicated servers only, a local client would
+ * see the packets of the benchmark clients.
+ *
+ * =======================================================================
+ */
+
+#include "header/server.h"
+
+#define BENCH_MAGIC (('D' << 24) + ('M' << 16) + ('C' << 8) + 'U') /* "UCMD" */
+#define BENCH_VERSION 1
+
+#define BENCH_FRAMEMSEC 100      /* length of a server frame */
+#define BENCH_MAXPACKETS 16      /* move packets per client and frame */
+#define BENCH_WARMUP 50          /* max frames for the clients to spawn */
+#define BENCH_SYNTHCMDS 600      /* 10 seconds at 60 packets a second */
+
+typedef struct
+{
+	netchan_t netchan;
+	netadr_t adr;
+	qboolean connected;
+	qboolean received;          /* got a packet this frame */
+	int lastframe;
+
+	int cmdnum;                 /* position in bench_cmds */
+	int cmdmsec;                /* command time sent ahead of the server */
+	usercmd_t oldest, old;
+
+	size_t packets, bytes;      /* received */
+	size_t sentpackets, sentbytes;
+} benchclient_t;
+
+static benchclient_t *bench_clients;
+static int bench_numclients;
+
+static usercmd_t *bench_cmds;
+static int bench_numcmds;
+
+static FILE *bench_recordfile;
+static int bench_recordclient;
+static int bench_recordcount;
+static usercmd_t bench_recordcmd;
+
+/*
+ * Loads the commands recorded by sv_benchrecord.
+ */
+static qboolean
+SV_BenchLoadCmds(const char *name)
+{
+	usercmd_t from, cmd;
+	sizebuf_t msg;
+	byte *buf;
+	int len, i;
+
+	len = FS_LoadFile(va("benchmarks/%s.ucmd", name), (void **)&buf);
+
+	if (!buf)
+	{
+		Com_Printf("Couldn't load benchmarks/%s.ucmd\n", name);
+		return false;
+	}
+
+	if ((len < 8) || (LittleLong(((int *)buf)[0]) != BENCH_MAGIC) ||
+		(LittleLong(((int *)buf)[1]) != BENCH_VERSION))
+	{
+		Com_Printf("benchmarks/%s.ucmd is no command file\n", name);
+		FS_FreeFile(buf);
+		return false;
+	}
+
+	/* count them first */
+	SZ_Init(&msg, buf + 8, len - 8);
+	msg.cursize = len - 8;
+	memset(&from, 0, sizeof(from));
+
+	for (bench_numcmds = 0; msg.readcount < msg.cursize; bench_numcmds++)
+	{
+		MSG_ReadDeltaUsercmd(&msg, &from, &cmd);
+		from = cmd;
+	}
+
+	if (msg.readcount > msg.cursize)
+	{
+		bench_numcmds--; /* truncated */
+	}
+
+	if (bench_numcmds <= 0)
+	{
+		Com_Printf("benchmarks/%s.ucmd is empty\n", name);
+		FS_FreeFile(buf);
+		return false;
+	}
+
+	bench_cmds = Z_Malloc(bench_numcmds * sizeof(usercmd_t));
+
+	MSG_BeginReading(&msg);
+	memset(&from, 0, sizeof(from));
+
+	for (i = 0; i < bench_numcmds; i++)
+	{
+		MSG_ReadDeltaUsercmd(&msg, &from, &bench_cmds[i]);
+		from = bench_cmds[i];
+	}
+
+	FS_FreeFile(buf);
+
+	return true;
+}
+
+/*
+ * Generates commands that run around in circles,
+ * strafe, jump and fire now and then.
+ */
+static void
+SV_BenchSynthesizeCmds(void)
+{
+	usercmd_t *cmd;
+	int i;
+
+	bench_numcmds = BENCH_SYNTHCMDS;
+	bench_cmds = Z_Malloc(bench_numcmds * sizeof(usercmd_t));
+
+	for (i = 0; i < bench_numcmds; i++)
+	{
+		cmd = &bench_cmds[i];
+
+		cmd->msec = 16;
+		cmd->angles[YAW] = ANGLE2SHORT(i * 1.5f);
+		cmd->forwardmove = 400;
+		cmd->sidemove = ((i / 120) & 1) ? 200 : -200;
+		cmd->upmove = ((i % 180) < 10) ? 200 : 0;
+		cmd->buttons = ((i / 60) & 1) ? BUTTON_ATTACK : 0;
+	}
+}
+
+/*
+ * The server side of a benchmark client.
+ */
+static client_t *
+SV_BenchServerClient(const benchclient_t *bc)
+{
+	client_t *cl;
+	int i;
+
+	for (i = 0, cl = svs.clients; i < maxclients->value; i++, cl++)
+	{
+		if ((cl->state != cs_free) &&
+			(cl->netchan.remote_address.type == NA_LOOPBACK) &&
+			(cl->netchan.remote_address.port == bc->adr.port))
+		{
+			return cl;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+SV_BenchStringCmd(benchclient_t *bc, const char *s)
+{
+	MSG_WriteByte(&bc->netchan.message, clc_stringcmd);
+	MSG_WriteString(&bc->netchan.message, s);
+}
+
+static void
+SV_BenchSendMove(benchclient_t *bc)
+{
+	usercmd_t nullcmd, *cmd;
+	byte data[128];
+	sizebuf_t msg;
+	int checksumIndex;
+
+	cmd = &bench_cmds[bc->cmdnum];
+	bc->cmdnum = (bc->cmdnum + 1) % bench_numcmds;
+
+	SZ_Init(&msg, data, sizeof(data));
+
+	MSG_WriteByte(&msg, clc_move);
+
+	checksumIndex = msg.cursize;
+	MSG_WriteByte(&msg, 0);
+	MSG_WriteLong(&msg, bc->lastframe);
+
+	memset(&nullcmd, 0, sizeof(nullcmd));
+	MSG_WriteDeltaUsercmd(&msg, &nullcmd, &bc->oldest);
+	MSG_WriteDeltaUsercmd(&msg, &bc->oldest, &bc->old);
+	MSG_WriteDeltaUsercmd(&msg, &bc->old, cmd);
+
+	msg.data[checksumIndex] = COM_BlockSequenceCRCByte(
+		msg.data + checksumIndex + 1, msg.cursize - checksumIndex - 1,
+		bc->netchan.outgoing_sequence);
+
+	Netchan_Transmit(&bc->netchan, msg.cursize, msg.data);
+
+	bc->oldest = bc->old;
+	bc->old = *cmd;
+	bc->cmdmsec += cmd->msec ? cmd->msec : 1;
+	bc->sentpackets++;
+	bc->sentbytes += msg.cursize;
+}
+
+/*
+ * Handles everything the server sent to the benchmark clients.
+ */
+static void
+SV_BenchReadPackets(void)
+{
+	benchclient_t *bc;
+	const char *s;
+	int i;
+
+	while (NET_GetPacket(NS_CLIENT, &net_from, &net_message))
+	{
+		i = net_from.port - 1;
+
+		if ((net_from.type != NA_LOOPBACK) ||
+			(i < 0) || (i >= bench_numclients))
+		{
+			continue;
+		}
+
+		bc = &bench_clients[i];
+
+		if (*(int *)net_message.data == -1)
+		{
+			MSG_BeginReading(&net_message);
+			MSG_ReadLong(&net_message);
+
+			s = MSG_ReadStringLine(&net_message);
+			Cmd_TokenizeString((char *)s, false);
+
+			if (!bc->connected && !strcmp(Cmd_Argv(0), "client_connect"))
+			{
+				Netchan_Setup(NS_CLIENT, &bc->netchan, bc->adr, i + 1);
+				bc->connected = true;
+
+				/* skip the configstrings and baselines */
+				SV_BenchStringCmd(bc, "new");
+				SV_BenchStringCmd(bc, va("begin %i", svs.spawncount));
+			}
+
+			continue;
+		}
+
+		if (!bc->connected || (net_message.cursize < 8))
+		{
+			continue;
+		}
+
+		if (Netchan_Process(&bc->netchan, &net_message))
+		{
+			bc->received = true;
+			bc->packets++;
+			bc->bytes += net_message.cursize;
+		}
+	}
+}
+
+/*
+ * Sends the moves of all clients for one server
+ * frame, runs the frame and reads the replies.
+ */
+static long long
+SV_BenchFrame(void)
+{
+	benchclient_t *bc;
+	long long start;
+	int i, n, usec;
+
+	for (i = 0, bc = bench_clients; i < bench_numclients; i++, bc++)
+	{
+		if (!bc->connected)
+		{
+			continue;
+		}
+
+		for (n = 0; (bc->cmdmsec < BENCH_FRAMEMSEC) && (n < BENCH_MAXPACKETS); n++)
+		{
+			SV_BenchSendMove(bc);
+		}
+
+		/* reliable messages only */
+		if (!n)
+		{
+			Netchan_Transmit(&bc->netchan, 0, NULL);
+		}
+
+		bc->cmdmsec = Q_max(bc->cmdmsec - BENCH_FRAMEMSEC, 0);
+		bc->received = false;
+	}
+
+	/* always let the game run */
+	usec = Q_max(sv.time - svs.realtime, 0) * 1000;
+
+	start = Sys_Microseconds();
+	SV_Frame(usec);
+	start = Sys_Microseconds() - start;
+
+	SV_BenchReadPackets();
+
+	/* nothing gets lost over the loopback, acknowledge the frame */
+	for (i = 0, bc = bench_clients; i < bench_numclients; i++, bc++)
+	{
+		if (bc->received)
+		{
+			bc->lastframe = sv.framenum;
+		}
+	}
+
+	return start;
+}
+
+static qboolean
+SV_BenchAllSpawned(void)
+{
+	const client_t *cl;
+	int i;
+
+	for (i = 0; i < bench_numclients; i++)
+	{
+		cl = SV_BenchServerClient(&bench_clients[i]);
+
+		if (!cl || (cl->state != cs_spawned))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void
+SV_BenchDisconnect(void)
+{
+	client_t *cl;
+	int i;
+
+	for (i = 0; i < bench_numclients; i++)
+	{
+		if (bench_clients[i].connected)
+		{
+			SV_BenchStringCmd(&bench_clients[i], "disconnect");
+		}
+	}
+
+	SV_BenchFrame();
+
+	/* don't wait for the zombies to time out */
+	for (i = 0; i < bench_numclients; i++)
+	{
+		cl = SV_BenchServerClient(&bench_clients[i]);
+
+		if (cl)
+		{
+			if (cl->state > cs_zombie)
+			{
+				SV_DropClient(cl);
+			}
+
+			SV_UnhashClient(cl);
+			cl->state = cs_free;
+		}
+	}
+
+	NET_SetLoopbackSize(0);
+
+	Z_Free(bench_clients);
+	bench_clients = NULL;
+	bench_numclients = 0;
+
+	Z_Free(bench_cmds);
+	bench_cmds = NULL;
+	bench_numcmds = 0;
+}
+
+/*
+ * sv_bench <clients> <frames> [commands]
+ */
+void
+SV_Bench_f(void)
+{
+	char cmdname[MAX_QPATH];
+	sv_frametimes_t times;
+	size_t allocs, allocbytes, allocs2, allocbytes2;
+	size_t bytes, sentbytes, packets;
+	long long start, frametime, maxframetime;
+	int numclients, frames, i;
+	benchclient_t *bc;
+	client_t *cl;
+
+	if ((Cmd_Argc() < 3) || (Cmd_Argc() > 4))
+	{
+		Com_Printf("Usage: sv_bench <clients> <frames> [commands]\n");
+		return;
+	}
+
+	if (!dedicated->value)
+	{
+		Com_Printf("sv_bench only works on dedicated servers.\n");
+		return;
+	}
+
+	if (sv.state != ss_game)
+	{
+		Com_Printf("No map running.\n");
+		return;
+	}
+
+	if (bench_clients)
+	{
+		Com_Printf("Already running a benchmark.\n");
+		return;
+	}
+
+	numclients = (int)strtol(Cmd_Argv(1), (char **)NULL, 10);
+	frames = (int)strtol(Cmd_Argv(2), (char **)NULL, 10);
+	Q_strlcpy(cmdname, Cmd_Argv(3), sizeof(cmdname));
+
+	if ((numclients <= 0) || (frames <= 0))
+	{
+		Com_Printf("Need at least one client and one frame.\n");
+		return;
+	}
+
+	for (i = 0, cl = svs.clients; i < maxclients->value; i++, cl++)
+	{
+		if (cl->state == cs_free)
+		{
+			numclients--;
+		}
+	}
+
+	if (numclients > 0)
+	{
+		Com_Printf("%i client slots missing, raise maxclients.\n", numclients);
+		return;
+	}
+
+	numclients = (int)strtol(Cmd_Argv(1), (char **)NULL, 10);
+
+	if (cmdname[0])
+	{
+		if (!SV_BenchLoadCmds(cmdname))
+		{
+			return;
+		}
+	}
+	else
+	{
+		SV_BenchSynthesizeCmds();
+	}
+
+	bench_numclients = numclients;
+	bench_clients = Z_Malloc(numclients * sizeof(benchclient_t));
+
+	NET_SetLoopbackSize(numclients * (BENCH_MAXPACKETS + 2));
+
+	for (i = 0, bc = bench_clients; i < numclients; i++, bc++)
+	{
+		bc->adr.type = NA_LOOPBACK;
+		bc->adr.port = i + 1;
+		bc->lastframe = -1;
+
+		/* don't let them all walk the same way */
+		bc->cmdnum = (int)(((long long)i * bench_numcmds) / numclients);
+
+		Netchan_OutOfBandPrint(NS_CLIENT, bc->adr,
+			"connect %i %i %i \"\\name\\bench%i\\skin\\male/grunt\\hand\\2\"\n",
+			PROTOCOL_VERSION, i + 1, 0, i);
+	}
+
+	for (i = 0; (i < BENCH_WARMUP) && !SV_BenchAllSpawned(); i++)
+	{
+		SV_BenchFrame();
+	}
+
+	if (!SV_BenchAllSpawned())
+	{
+		Com_Printf("The benchmark clients didn't spawn.\n");
+		SV_BenchDisconnect();
+		return;
+	}
+
+	Com_Printf("Running %i frames with %i clients on %s...\n",
+		frames, numclients, sv.name);
+
+	for (i = 0, bc = bench_clients; i < numclients; i++, bc++)
+	{
+		bc->packets = bc->bytes = 0;
+		bc->sentpackets = bc->sentbytes = 0;
+	}
+
+	times = sv_frametimes;
+	Z_Allocations(&allocs, &allocbytes);
+	frametime = maxframetime = 0;
+	start = Sys_Microseconds();
+
+	for (i = 0; i < frames; i++)
+	{
+		long long t;
+
+		t = SV_BenchFrame();
+		frametime += t;
+		maxframetime = Q_max(maxframetime, t);
+	}
+
+	start = Sys_Microseconds() - start;
+	Z_Allocations(&allocs2, &allocbytes2);
+	times.readpackets = sv_frametimes.readpackets - times.readpackets;
+	times.rungame = sv_frametimes.rungame - times.rungame;
+	times.sendmessages = sv_frametimes.sendmessages - times.sendmessages;
+
+	bytes = sentbytes = packets = 0;
+
+	for (i = 0, bc = bench_clients; i < numclients; i++, bc++)
+	{
+		bytes += bc->bytes;
+		sentbytes += bc->sentbytes;
+		packets += bc->packets;
+	}
+
+	Com_Printf("%s commands, %i frames in %.1f ms including the clients\n",
+		cmdname[0] ? cmdname : "synthetic", frames, start / 1000.0);
+	Com_Printf("server frame:  %8.3f ms avg %8.3f ms max\n",
+		frametime / 1000.0 / frames, maxframetime / 1000.0);
+	Com_Printf("read packets:  %8.3f ms\n", times.readpackets / 1000.0 / frames);
+	Com_Printf("run game:      %8.3f ms\n", times.rungame / 1000.0 / frames);
+	Com_Printf("send messages: %8.3f ms\n", times.sendmessages / 1000.0 / frames);
+	Com_Printf("per client:    %8.1f bytes received, %.1f bytes sent per frame,"
+		" %.2f packets received\n", (double)bytes / numclients / frames,
+		(double)sentbytes / numclients / frames,
+		(double)packets / numclients / frames);
+	Com_Printf("allocations:   %8.1f per frame, %.1f bytes\n",
+		(double)(allocs2 - allocs) / frames,
+		(double)(allocbytes2 - allocbytes) / frames);
+
+	/* one line to grep for */
+	Com_Printf("sv_bench map=%s clients=%i frames=%i frame_us=%.1f"
+		" frame_max_us=%lld read_us=%.1f game_us=%.1f send_us=%.1f"
+		" client_bytes=%.1f allocs=%.1f\n", sv.name, numclients, frames,
+		(double)frametime / frames, maxframetime,
+		(double)times.readpackets / frames, (double)times.rungame / frames,
+		(double)times.sendmessages / frames,
+		(double)bytes / numclients / frames,
+		(double)(allocs2 - allocs) / frames);
+
+	SV_BenchDisconnect();
+}
+
+/*
+ * Writes the commands of a client to a file for sv_bench.
+ */
+void
+SV_BenchRecordCmd(const client_t *cl, const usercmd_t *cmd)
+{
+	byte data[64];
+	sizebuf_t msg;
+
+	if (!bench_recordfile || ((cl - svs.clients) != bench_recordclient))
+	{
+		return;
+	}
+
+	SZ_Init(&msg, data, sizeof(data));
+	MSG_WriteDeltaUsercmd(&msg, &bench_recordcmd, cmd);
+	fwrite(msg.data, msg.cursize, 1, bench_recordfile);
+
+	bench_recordcmd = *cmd;
+	bench_recordcount++;
+}
+
+/*
+ * sv_benchrecord <name> [client]
+ */
+void
+SV_BenchRecord_f(void)
+{
+	char name[MAX_OSPATH];
+	int header[2];
+
+	if ((Cmd_Argc() < 2) || (Cmd_Argc() > 3))
+	{
+		Com_Printf("Usage: sv_benchrecord <name> [client]\n");
+		return;
+	}
+
+	if (bench_recordfile)
+	{
+		Com_Printf("Already recording.\n");
+		return;
+	}
+
+	if (strstr(Cmd_Argv(1), "..") ||
+		strstr(Cmd_Argv(1), "/") ||
+		strstr(Cmd_Argv(1), "\\"))
+	{
+		Com_Printf("Illegal filename.\n");
+		return;
+	}
+
+	bench_recordclient = (int)strtol(Cmd_Argv(2), (char **)NULL, 10);
+
+	if ((bench_recordclient < 0) || (bench_recordclient >= maxclients->value))
+	{
+		Com_Printf("Bad client %i.\n", bench_recordclient);
+		return;
+	}
+
+	Com_sprintf(name, sizeof(name), "%s/benchmarks/%s.ucmd", FS_Gamedir(),
+		Cmd_Argv(1));
+
+	FS_CreatePath(name);
+	bench_recordfile = Q_fopen(name, "wb");
+
+	if (!bench_recordfile)
+	{
+		Com_Printf("ERROR: couldn't open %s.\n", name);
+		return;
+	}
+
+	header[0] = LittleLong(BENCH_MAGIC);
+	header[1] = LittleLong(BENCH_VERSION);
+	fwrite(header, sizeof(header), 1, bench_recordfile);
+
+	memset(&bench_recordcmd, 0, sizeof(bench_recordcmd));
+	bench_recordcount = 0;
+
+	Com_Printf("Recording the commands of client %i to %s.\n",
+		bench_recordclient, name);
+}
+
+void
+SV_BenchStop_f(void)
+{
+	if (!bench_recordfile)
+	{
+		Com_Printf("Not recording commands.\n");
+		return;
+	}
+
+	fclose(bench_recordfile);
+	bench_recordfile = NULL;
+
+	Com_Printf("Recorded %i commands.\n", bench_recordcount);
+}
@@ -799,5 +799,12 @@ SV_InitOperatorCommands(void)
 	Cmd_AddCommand("killserver", SV_KillServer_f);
 
 	Cmd_AddCommand("sv", SV_ServerCommand_f);
+
+	Cmd_AddCommand("sv_worldstats", SV_WorldStats_f);
+	Cmd_AddCommand("sv_deltastats", SV_DeltaStats_f);
+	Cmd_AddCommand("sv_bench", SV_Bench_f);
+	Cmd_AddCommand("sv_benchrecord", SV_BenchRecord_f);
+	Cmd_AddCommand("sv_benchstop", SV_BenchStop_f);
+	Cmd_AddCommand("sv_prefetch", SV_Prefetch_f);
 }
 
@@ -158,6 +158,9 @@ SVC_DirectConnect(void)
 	int version;
 	int qport;
 	int challenge;
+	int fragmentsize;
+	qboolean extended;
+	char reply[MAX_INFO_STRING];
 
 	adr = net_from;
 
@@ -178,6 +181,28 @@ SVC_DirectConnect(void)
 
 	Q_strlcpy(userinfo, Cmd_Argv(4), sizeof(userinfo));
 
+	/* clients of this protocol version may offer netchan fragmentation
+	   and compression, it's not worth it for local connections */
+	extended = false;
+	fragmentsize = 0;
+
+	if (!strncmp(Cmd_Argv(5), "nc=", 3) && !NET_IsLocalAddress(adr))
+	{
+		extended = true;
+		fragmentsize = (int)strtol(Cmd_Argv(5) + 3, (char **)NULL, 10);
+
+		/* the smaller datagram size wins, 0 on
+		   either side disables fragmentation */
+		if ((fragmentsize <= 0) || !Netchan_FragmentSize())
+		{
+			fragmentsize = 0;
+		}
+		else if (Netchan_FragmentSize() < fragmentsize)
+		{
+			fragmentsize = Netchan_FragmentSize();
+		}
+	}
+
 	/* force the IP key/value pair so the game can filter based on ip */
 	Info_SetValueForKey(userinfo, "ip", NET_AdrToString(net_from));
 
@@ -270,6 +295,7 @@ gotnewcl:
 
 	/* build a new connection  accept the new client this
 	   is the only place a client_t is ever initialized */
+	SV_UnhashClient(newcl);
 	*newcl = temp;
 	sv_client = newcl;
 	ent = CL_EDICT(newcl);
@@ -299,17 +325,28 @@ gotnewcl:
 	SV_UserinfoChanged(newcl);
 
 	/* send the connect packet to the client */
+	Q_strlcpy(reply, "client_connect", sizeof(reply));
+
 	if (sv_downloadserver->string[0])
 	{
-		Netchan_OutOfBandPrint(NS_SERVER, adr, "client_connect dlserver=%s", sv_downloadserver->string);
+		Q_strlcat(reply, va(" dlserver=%s", sv_downloadserver->string), sizeof(reply));
 	}
-	else
+
+	if (extended)
 	{
-		Netchan_OutOfBandPrint(NS_SERVER, adr, "client_connect");
+		Q_strlcat(reply, va(" nc=%i", fragmentsize), sizeof(reply));
 	}
 
+	Netchan_OutOfBandPrint(NS_SERVER, adr, "%s", reply);
+
 	Netchan_Setup(NS_SERVER, &newcl->netchan, adr, qport);
 
+	if (extended)
+	{
+		Netchan_SetExtended(&newcl->netchan, fragmentsize);
+	}
+	SV_HashClient(newcl);
+
 	newcl->state = cs_connected;
 
 	SZ_Init(&newcl->datagram, newcl->datagram_buf, sizeof(newcl->datagram_buf));
@@ -394,6 +431,11 @@ SV_ConnectionlessPacket(void)
 	char *s;
 	char *c;
 
+	if (!SV_ConnectionlessAllowed(net_from))
+	{
+		return;
+	}
+
 	MSG_BeginReading(&net_message);
 	MSG_ReadLong(&net_message); /* skip the -1 marker */
 
@@ -30,12 +30,167 @@
 
 #include "header/server.h"
 
+#define DELTACACHE_SIZE 4096 /* must be a power of two */
+#define DELTACACHE_PROBES 16
+#define DELTACACHE_BYTES (64 * 1024)
+
+/*
+ * Encoded entity deltas of the current frame. Clients that
+ * acked the same frame or start from the baseline need the
+ * same bytes, so they are only encoded once. The states are
+ * not copied, they live in client_entities or the baselines
+ * and don't change while the frames are written.
+ */
+typedef struct
+{
+	int gen;
+	int number;
+	int flags;
+	const entity_xstate_t *from;
+	const entity_xstate_t *to;
+	int ofs;
+	int len;
+} deltaentry_t;
+
+/* one per worker thread */
+typedef struct
+{
+	deltaentry_t entries[DELTACACHE_SIZE];
+	byte data[DELTACACHE_BYTES];
+	int size;
+	int gen;
+	size_t lookups;
+	size_t hits;
+} deltacache_t;
+
+static deltacache_t *sv_deltacaches;
+static int sv_numdeltacaches;
+static int sv_deltagen = 1;
+
+/*
+ * Forgets all cached deltas, called before
+ * the frames of a server frame are written.
+ */
+void
+SV_ResetDeltaCache(void)
+{
+	sv_deltagen++;
+}
+
+/*
+ * MSG_WriteDeltaEntity, but looks for the same delta first.
+ */
+static void
+SV_WriteDeltaEntity(deltacache_t *cache, const entity_xstate_t *from,
+	const entity_xstate_t *to, sizebuf_t *msg, qboolean force,
+	qboolean newentity, int protocol)
+{
+	deltaentry_t *entry, *slot;
+	unsigned int hash;
+	int flags, start, i;
+
+	if (!cache)
+	{
+		MSG_WriteDeltaEntity(from, to, msg, force, newentity, protocol);
+		return;
+	}
+
+	if (cache->gen != sv_deltagen)
+	{
+		cache->gen = sv_deltagen;
+		cache->size = 0;
+	}
+
+	flags = (force ? 1 : 0) | (newentity ? 2 : 0) | (protocol << 2);
+	hash = ((unsigned int)to->number * 2654435761u) ^ (unsigned int)flags;
+	slot = NULL;
+
+	cache->lookups++;
+
+	for (i = 0; i < DELTACACHE_PROBES; i++)
+	{
+		entry = &cache->entries[(hash + i) & (DELTACACHE_SIZE - 1)];
+
+		if (entry->gen != sv_deltagen)
+		{
+			slot = entry;
+			break;
+		}
+
+		if ((entry->number != to->number) || (entry->flags != flags) ||
+			(!entry->from != !from))
+		{
+			continue;
+		}
+
+		if (((entry->to == to) || !memcmp(entry->to, to, sizeof(*to))) &&
+			(!from || (entry->from == from) ||
+			 !memcmp(entry->from, from, sizeof(*from))))
+		{
+			cache->hits++;
+			SZ_Write(msg, cache->data + entry->ofs, entry->len);
+			return;
+		}
+	}
+
+	start = msg->cursize;
+
+	MSG_WriteDeltaEntity(from, to, msg, force, newentity, protocol);
+
+	if (!slot || msg->overflowed || (msg->cursize < start) ||
+		(cache->size + msg->cursize - start > DELTACACHE_BYTES))
+	{
+		return;
+	}
+
+	slot->gen = sv_deltagen;
+	slot->number = to->number;
+	slot->flags = flags;
+	slot->from = from;
+	slot->to = to;
+	slot->ofs = cache->size;
+	slot->len = msg->cursize - start;
+
+	memcpy(cache->data + cache->size, msg->data + start, slot->len);
+	cache->size += slot->len;
+}
+
+/*
+ * Prints how many entity deltas were found in the cache since
+ * the server was started or this command was run the last time
+ */
+void
+SV_DeltaStats_f(void)
+{
+	size_t lookups, hits;
+	int i;
+
+	lookups = hits = 0;
+
+	for (i = 0; i < sv_numdeltacaches; i++)
+	{
+		lookups += sv_deltacaches[i].lookups;
+		hits += sv_deltacaches[i].hits;
+		sv_deltacaches[i].lookups = sv_deltacaches[i].hits = 0;
+	}
+
+	Com_Printf(YQ2_COM_PRIdS " entity deltas, " YQ2_COM_PRIdS " from cache",
+		lookups, hits);
+
+	if (lookups)
+	{
+		Com_Printf(", %.1f%%", 100.0f * hits / lookups);
+	}
+
+	Com_Printf("\n");
+}
+
 /*
  * Writes a delta update of an entity_state_t list to the message.
  */
 static void
 SV_EmitPacketEntities(const client_frame_t *from, const client_frame_t *to, sizebuf_t *msg,
-	int protocol)
+	int protocol, deltacache_t *cache)
 {
 	const entity_xstate_t *oldent, *newent;
 	int oldindex, newindex;
@@ -95,7 +250,7 @@ SV_EmitPacketEntities(const client_frame_t *from, const client_frame_t *to, size
 			   being emited if the entity has not changed at all
 			   note that players are always 'newentities', this
 			   updates their oldorigin always and prevents warping */
-			MSG_WriteDeltaEntity(oldent, newent, msg,
+			SV_WriteDeltaEntity(cache, oldent, newent, msg,
 					false, newent->number <= maxclients->value, protocol);
 			oldindex++;
 			newindex++;
@@ -105,7 +260,7 @@ SV_EmitPacketEntities(const client_frame_t *from, const client_frame_t *to, size
 		if (newnum < oldnum)
 		{
 			/* this is a new entity, send it from the baseline */
-			MSG_WriteDeltaEntity(
+			SV_WriteDeltaEntity(cache,
 				(newnum < sv.numbaselines) ? &sv.baselines[newnum] : NULL,
 				newent, msg, true, true, protocol);
 
@@ -448,8 +603,12 @@ SV_WritePlayerstateToClient(client_frame_t *from, client_frame_t *to,
 	}
 }
 
+/*
+ * worker is the thread index as passed by Sys_ParallelFor,
+ * 0 on the main thread.
+ */
 void
-SV_WriteFrameToClient(client_t *client, sizebuf_t *msg)
+SV_WriteFrameToClient(client_t *client, sizebuf_t *msg, int worker)
 {
 	client_frame_t *frame, *oldframe;
 	int lastframe;
@@ -490,7 +649,133 @@ SV_WriteFrameToClient(client_t *client, sizebuf_t *msg)
 	SV_WritePlayerstateToClient(oldframe, frame, msg, client->protocol);
 
 	/* delta encode the entities */
-	SV_EmitPacketEntities(oldframe, frame, msg, client->protocol);
+	SV_EmitPacketEntities(oldframe, frame, msg, client->protocol,
+		(worker < sv_numdeltacaches) ? &sv_deltacaches[worker] : NULL);
+}
+
+/* scratch rows of a thread building client frames */
+typedef struct
+{
+	byte *fatpvs;
+	byte *pvs;
+	byte *phs;
+	size_t rowsize;
+} frameworker_t;
+
+static frameworker_t *sv_frameworkers;
+static int sv_numframeworkers;
+static byte *sv_framerows;
+static size_t sv_framerowsize;
+
+/* visible entity numbers of every client of a SV_BuildClientFrames call */
+static int *sv_framelists;
+static int *sv_framecounts;
+static int sv_numframelists;
+static int sv_framelistsize;
+
+static void *
+SV_FrameRealloc(void *ptr, size_t size)
+{
+	ptr = realloc(ptr, size);
+	YQ2_COM_CHECK_OOM(ptr, "realloc()", size)
+
+	return ptr;
+}
+
+/*
+ * Makes sure there is scratch space for numworkers threads and the
+ * entity lists of numclients clients.
+ */
+static void
+SV_FrameBuffers(int numclients, int numworkers)
+{
+	size_t rowsize;
+	int i;
+
+	CM_ClusterPTS(&rowsize);
+
+	if ((numworkers > sv_numframeworkers) ||
+		(numworkers && (rowsize != sv_framerowsize)))
+	{
+		numworkers = Q_max(numworkers, sv_numframeworkers);
+
+		sv_frameworkers = SV_FrameRealloc(sv_frameworkers,
+			numworkers * sizeof(frameworker_t));
+		sv_framerows = SV_FrameRealloc(sv_framerows,
+			numworkers * rowsize * 3);
+
+		for (i = 0; i < numworkers; i++)
+		{
+			sv_frameworkers[i].fatpvs = sv_framerows + (i * 3) * rowsize;
+			sv_frameworkers[i].pvs = sv_frameworkers[i].fatpvs + rowsize;
+			sv_frameworkers[i].phs = sv_frameworkers[i].pvs + rowsize;
+			sv_frameworkers[i].rowsize = rowsize;
+		}
+
+		sv_numframeworkers = numworkers;
+		sv_framerowsize = rowsize;
+	}
+
+	if (numworkers > sv_numdeltacaches)
+	{
+		sv_deltacaches = SV_FrameRealloc(sv_deltacaches,
+			numworkers * sizeof(deltacache_t));
+		memset(sv_deltacaches + sv_numdeltacaches, 0,
+			(numworkers - sv_numdeltacaches) * sizeof(deltacache_t));
+		sv_numdeltacaches = numworkers;
+	}
+
+	if ((numclients > sv_numframelists) ||
+		(ge->max_edicts != sv_framelistsize))
+	{
+		numclients = Q_max(numclients, sv_numframelists);
+
+		sv_framelists = SV_FrameRealloc(sv_framelists,
+			numclients * ge->max_edicts * sizeof(int));
+		sv_framecounts = SV_FrameRealloc(sv_framecounts,
+			numclients * sizeof(int));
+
+		sv_numframelists = numclients;
+		sv_framelistsize = ge->max_edicts;
+	}
+}
+
+void
+SV_FreeFrameBuffers(void)
+{
+	free(sv_frameworkers);
+	free(sv_framerows);
+	free(sv_framelists);
+	free(sv_framecounts);
+	free(sv_deltacaches);
+
+	sv_deltacaches = NULL;
+	sv_numdeltacaches = 0;
+	sv_frameworkers = NULL;
+	sv_framerows = NULL;
+	sv_framelists = NULL;
+	sv_framecounts = NULL;
+	sv_numframeworkers = 0;
+	sv_numframelists = 0;
+	sv_framerowsize = 0;
+	sv_framelistsize = 0;
+}
+
+/*
+ * Without scratch rows this goes through the shared row
+ * buffers of the collision model, which only the main
+ * thread may use.
+ */
+static const byte *
+SV_ClusterVis(int cluster, int type, byte *scratch, size_t *size)
+{
+	if (!scratch)
+	{
+		return (type == DVIS_PVS) ? CM_ClusterPVS(cluster, size) :
+			CM_ClusterPHS(cluster, size);
+	}
+
+	return CM_ClusterVis(cluster, type, scratch, size);
 }
 
 /*
@@ -498,7 +783,7 @@ SV_WriteFrameToClient(client_t *client, sizebuf_t *msg)
  * so we can't use a single PVS point
  */
 static byte *
-SV_FatPVS(vec3_t org, size_t *fatpvs_size)
+SV_FatPVS(vec3_t org, frameworker_t *work, size_t *fatpvs_size)
 {
 	size_t pvs_size;
 	const byte *src, *pvs_buf;
@@ -517,7 +802,15 @@ SV_FatPVS(vec3_t org, size_t *fatpvs_size)
 
 	count = CM_BoxLeafnums(mins, maxs, leafs, 64, NULL);
 
-	fatpvs = CM_ClusterPTS(fatpvs_size);
+	if (work)
+	{
+		fatpvs = work->fatpvs;
+		*fatpvs_size = work->rowsize;
+	}
+	else
+	{
+		fatpvs = CM_ClusterPTS(fatpvs_size);
+	}
 
 	if (count < 1)
 	{
@@ -534,7 +827,8 @@ SV_FatPVS(vec3_t org, size_t *fatpvs_size)
 	}
 
 	*fatpvs_size = Q_min(numInt32s << 2, *fatpvs_size);
-	pvs_buf = CM_ClusterPVS(leafs[0], &pvs_size);
+	pvs_buf = SV_ClusterVis(leafs[0], DVIS_PVS, work ? work->pvs : NULL,
+		&pvs_size);
 	pvs_size = Q_min(pvs_size, *fatpvs_size);
 	memcpy(fatpvs, pvs_buf, pvs_size);
 
@@ -556,7 +850,8 @@ SV_FatPVS(vec3_t org, size_t *fatpvs_size)
 			continue; /* already have the cluster we want */
 		}
 
-		src = CM_ClusterPVS(leafs[i], &src_size);
+		src = SV_ClusterVis(leafs[i], DVIS_PVS, work ? work->pvs : NULL,
+			&src_size);
 
 		src_size = Q_min(src_size, pvs_size);
 
@@ -571,10 +866,13 @@ SV_FatPVS(vec3_t org, size_t *fatpvs_size)
 
 /*
  * Decides which entities are going to be visible to the client, and
- * copies off the playerstat and areabits.
+ * copies off the playerstat and areabits. The numbers of the visible
+ * entities are written to list. Returns their count, -1 if the client
+ * isn't in game yet. Only the client's own frame is written, with
+ * scratch rows in work this is safe to run on a worker thread.
  */
-void
-SV_BuildClientFrame(client_t *client)
+static int
+SV_ClientVisibleEntities(client_t *client, frameworker_t *work, int *list)
 {
 	int e, i;
 	vec3_t org;
@@ -584,6 +882,7 @@ SV_BuildClientFrame(client_t *client)
 	int l;
 	int clientarea, clientcluster;
 	int leafnum;
+	int count;
 	const byte *clientphs;
 	const byte *bitvector, *fatpvs;
 	size_t phs_size;
@@ -593,7 +892,7 @@ SV_BuildClientFrame(client_t *client)
 
 	if (!clent->client)
 	{
-		return; /* not in game yet */
+		return -1; /* not in game yet */
 	}
 
 	/* this is the frame we are creating */
@@ -634,17 +933,15 @@ SV_BuildClientFrame(client_t *client)
 	/* grab the current player_state_t */
 	frame->ps = clent->client->ps;
 
-	fatpvs = SV_FatPVS(org, &fatpvs_size);
-	clientphs = CM_ClusterPHS(clientcluster, &phs_size);
+	fatpvs = SV_FatPVS(org, work, &fatpvs_size);
+	clientphs = SV_ClusterVis(clientcluster, DVIS_PHS,
+		work ? work->phs : NULL, &phs_size);
 
 	/* build up the list of visible entities */
-	frame->num_entities = 0;
-	frame->first_entity = svs.next_client_entities;
+	count = 0;
 
 	for (e = 1; e < ge->num_edicts; e++)
 	{
-		entity_xstate_t *state;
-
 		ent = EDICT_NUM(e);
 
 		/* ignore ents without visible models */
@@ -733,14 +1030,44 @@ SV_BuildClientFrame(client_t *client)
 			}
 		}
 
+		list[count++] = e;
+	}
+
+	return count;
+}
+
+/*
+ * Adds the entities picked by SV_ClientVisibleEntities
+ * to the circular client_entities array.
+ */
+static void
+SV_StoreClientEntities(client_t *client, const int *list, int count)
+{
+	client_frame_t *frame;
+	edict_t *clent;
+	int i;
+
+	clent = CL_EDICT(client);
+	frame = &client->frames[sv.framenum & UPDATE_MASK];
+
+	frame->num_entities = 0;
+	frame->first_entity = svs.next_client_entities;
+
+	for (i = 0; i < count; i++)
+	{
+		entity_xstate_t *state;
+		edict_t *ent;
+
+		ent = EDICT_NUM(list[i]);
+
 		/* add it to the circular client_entities array */
 		state = &svs.client_entities[svs.next_client_entities %
 				svs.num_client_entities];
 
-		if (ent->s.number != e)
+		if (ent->s.number != list[i])
 		{
 			Com_DPrintf("FIXING ENT->S.NUMBER!!!\n");
-			ent->s.number = e;
+			ent->s.number = list[i];
 		}
 
 		SV_GetEntityState(ent, state);
@@ -756,6 +1083,54 @@ SV_BuildClientFrame(client_t *client)
 	}
 }
 
+void
+SV_BuildClientFrame(client_t *client)
+{
+	int count;
+
+	SV_FrameBuffers(1, 1);
+
+	count = SV_ClientVisibleEntities(client, NULL, sv_framelists);
+
+	if (count >= 0)
+	{
+		SV_StoreClientEntities(client, sv_framelists, count);
+	}
+}
+
+static void
+SV_ClientVisibleEntitiesJob(void *data, int index, int worker)
+{
+	client_t **clients = data;
+
+	sv_framecounts[index] = SV_ClientVisibleEntities(clients[index],
+		&sv_frameworkers[worker], sv_framelists + index * sv_framelistsize);
+}
+
+/*
+ * SV_BuildClientFrame for several clients at once. The visibility
+ * checks run on the worker threads, only copying the entity states
+ * into the shared client_entities array is left to the main thread.
+ */
+void
+SV_BuildClientFrames(client_t **clients, int count)
+{
+	int i;
+
+	SV_FrameBuffers(count, Sys_NumWorkers());
+
+	Sys_ParallelFor(count, SV_ClientVisibleEntitiesJob, clients);
+
+	for (i = 0; i < count; i++)
+	{
+		if (sv_framecounts[i] >= 0)
+		{
+			SV_StoreClientEntities(clients[i],
+				sv_framelists + i * sv_framelistsize, sv_framecounts[i]);
+		}
+	}
+}
+
 /*
  * Save everything in the world out without deltas.
  * Used for recording footage for merged or assembled demos
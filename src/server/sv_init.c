@@ -288,12 +288,16 @@ SV_SpawnServer(char *server, char *spawnpoint, server_state_t serverstate,
 		FS_FCloseFile(sv.demofile);
 	}
 
+	/* whatever was prefetched is in the caches by now */
+	SV_PrefetchStop();
+
 	svs.spawncount++; /* any partially connected client will be restarted */
 	sv.state = ss_dead;
 	Com_SetServerState(sv.state);
 
 	/* wipe the entire per-level structure */
 	SV_ClearBaselines();
+	SV_ClearClusters();
 	memset(&sv, 0, sizeof(sv));
 	svs.realtime = 0;
 	sv.loadgame = loadgame;
@@ -555,6 +559,7 @@ SV_InitGame(void)
 	svs.gamemode = gamemode;
 	svs.spawncount = randk();
 	svs.clients = Z_Malloc(sizeof(client_t) * maxclients->value);
+	SV_ClearClientHash();
 	svs.num_client_entities = maxclients->value * UPDATE_BACKUP * MAX_PACKET_ENTITIES;
 	svs.client_entities = Z_Malloc( sizeof(entity_xstate_t) * svs.num_client_entities);
 
@@ -55,6 +55,25 @@ cvar_t *public_server; /* should heartbeats be sent */
 cvar_t *sv_entfile; /* External entity files. */
 cvar_t *sv_downloadserver; /* Download server. */
 cvar_t *sv_language; /* Server message language. */
+cvar_t *sv_broadphase; /* How entities are sorted for collision tests. */
+cvar_t *sv_threads; /* Build client frames on the worker threads. */
+cvar_t *sv_oobrate; /* Connectionless packets per second and address. */
+
+sv_frametimes_t sv_frametimes;
+
+#define CLIENTHASH_SIZE 256 /* must be a power of two */
+#define OOBRATE_SIZE 1024 /* must be a power of two */
+
+/* recent senders of connectionless packets */
+typedef struct
+{
+	netadr_t adr;
+	int time;
+	int count;
+} oobrate_t;
+
+static client_t *sv_clienthash[CLIENTHASH_SIZE];
+static oobrate_t sv_oobrates[OOBRATE_SIZE];
 
 /*
  * Called when the player is totally leaving the server, either willingly
@@ -193,10 +212,158 @@ SV_GiveMsec(void)
 	}
 }
 
+/*
+ * Hashes what NET_CompareBaseAdr looks at,
+ * so the port can change without rehashing.
+ */
+static unsigned int
+SV_HashAddress(netadr_t adr, int qport)
+{
+	unsigned int hash;
+	const byte *data;
+	int i, len;
+
+	switch (adr.type)
+	{
+		case NA_IP:
+			data = adr.ip;
+			len = 4;
+			break;
+
+		case NA_IP6:
+			data = adr.ip;
+			len = 16;
+			break;
+
+		case NA_IPX:
+			data = adr.ipx;
+			len = 10;
+			break;
+
+		default:
+			data = NULL;
+			len = 0;
+			break;
+	}
+
+	/* FNV-1a */
+	hash = 2166136261u ^ adr.type;
+	hash *= 16777619u;
+
+	for (i = 0; i < len; i++)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+
+	hash ^= qport & 0xffff;
+	hash *= 16777619u;
+
+	return hash;
+}
+
+void
+SV_ClearClientHash(void)
+{
+	memset(sv_clienthash, 0, sizeof(sv_clienthash));
+	memset(sv_oobrates, 0, sizeof(sv_oobrates));
+}
+
+/*
+ * Adds a client to the lookup by address and qport. Must be
+ * called whenever a connection is set up with Netchan_Setup.
+ */
+void
+SV_HashClient(client_t *cl)
+{
+	unsigned int hash;
+
+	hash = SV_HashAddress(cl->netchan.remote_address, cl->netchan.qport) &
+		(CLIENTHASH_SIZE - 1);
+
+	cl->hashnext = sv_clienthash[hash];
+	sv_clienthash[hash] = cl;
+}
+
+/*
+ * Removes a client from the lookup, before the client is
+ * freed or its address is changed. Unhashed clients are
+ * ignored.
+ */
+void
+SV_UnhashClient(client_t *cl)
+{
+	client_t **link;
+	unsigned int hash;
+
+	hash = SV_HashAddress(cl->netchan.remote_address, cl->netchan.qport) &
+		(CLIENTHASH_SIZE - 1);
+
+	for (link = &sv_clienthash[hash]; *link; link = &(*link)->hashnext)
+	{
+		if (*link == cl)
+		{
+			*link = cl->hashnext;
+			break;
+		}
+	}
+
+	cl->hashnext = NULL;
+}
+
+static client_t *
+SV_FindClient(netadr_t adr, int qport)
+{
+	unsigned int hash;
+	client_t *cl;
+
+	hash = SV_HashAddress(adr, qport) & (CLIENTHASH_SIZE - 1);
+
+	for (cl = sv_clienthash[hash]; cl; cl = cl->hashnext)
+	{
+		if ((cl->state != cs_free) && (cl->netchan.qport == qport) &&
+			NET_CompareBaseAdr(adr, cl->netchan.remote_address))
+		{
+			return cl;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Limits every address to sv_oobrate connectionless packets a
+ * second. Addresses share slots, on collisions the new sender
+ * takes over the slot.
+ */
+qboolean
+SV_ConnectionlessAllowed(netadr_t adr)
+{
+	oobrate_t *rate;
+
+	if ((sv_oobrate->value <= 0) || NET_IsLocalAddress(adr) ||
+		(adr.type == NA_LOOPBACK))
+	{
+		return true;
+	}
+
+	rate = &sv_oobrates[SV_HashAddress(adr, 0) & (OOBRATE_SIZE - 1)];
+
+	if (!NET_CompareBaseAdr(adr, rate->adr) ||
+		(svs.realtime - rate->time >= 1000) ||
+		(svs.realtime < rate->time))
+	{
+		rate->adr = adr;
+		rate->time = svs.realtime;
+		rate->count = 0;
+	}
+
+	return (++rate->count <= sv_oobrate->value);
+}
+
 static void
 SV_ReadPackets(void)
 {
-	int i;
 	client_t *cl;
 	int qport;
 
@@ -217,49 +384,31 @@ SV_ReadPackets(void)
 		qport = MSG_ReadShort(&net_message) & 0xffff;
 
 		/* check for packets from connected clients */
-		for (i = 0, cl = svs.clients; i < maxclients->value; i++, cl++)
-		{
-			if (cl->state == cs_free)
-			{
-				continue;
-			}
+		cl = SV_FindClient(net_from, qport);
 
-			if (!NET_CompareBaseAdr(net_from, cl->netchan.remote_address))
-			{
-				continue;
-			}
+		if (!cl)
+		{
+			continue;
+		}
 
-			if (cl->netchan.qport != qport)
-			{
-				continue;
-			}
+		if (cl->netchan.remote_address.port != net_from.port)
+		{
+			Com_Printf("%s: fixing up a translated port\n", __func__);
+			cl->netchan.remote_address.port = net_from.port;
+		}
 
-			if (cl->netchan.remote_address.port != net_from.port)
+		if (Netchan_Process(&cl->netchan, &net_message))
+		{
+			/* this is a valid, sequenced packet, so process it */
+			if (cl->state != cs_zombie)
 			{
-				Com_Printf("%s: fixing up a translated port\n", __func__);
-				cl->netchan.remote_address.port = net_from.port;
-			}
+				cl->lastmessage = svs.realtime; /* don't timeout */
 
-			if (Netchan_Process(&cl->netchan, &net_message))
-			{
-				/* this is a valid, sequenced packet, so process it */
-				if (cl->state != cs_zombie)
+				if (!(sv.demofile && (sv.state == ss_demo)))
 				{
-					cl->lastmessage = svs.realtime; /* don't timeout */
-
-					if (!(sv.demofile && (sv.state == ss_demo)))
-					{
-						SV_ExecuteClientMessage(cl);
-					}
+					SV_ExecuteClientMessage(cl);
 				}
 			}
-
-			break;
-		}
-
-		if (i != maxclients->value)
-		{
-			continue;
 		}
 	}
 }
@@ -295,6 +444,7 @@ SV_CheckTimeouts(void)
 		if ((cl->state == cs_zombie) &&
 			(cl->lastmessage < zombiepoint))
 		{
+			SV_UnhashClient(cl);
 			cl->state = cs_free; /* can now be reused */
 			continue;
 		}
@@ -304,6 +454,7 @@ SV_CheckTimeouts(void)
 		{
 			SV_BroadcastPrintf(PRINT_HIGH, "%s timed out\n", cl->name);
 			SV_DropClient(cl);
+			SV_UnhashClient(cl);
 			cl->state = cs_free; /* don't bother with zombie state */
 		}
 	}
@@ -390,6 +541,7 @@ void
 SV_Frame(int usec)
 {
 	int opt_sendrate;
+	long long start;
 
 #ifndef DEDICATED_ONLY
 	time_before_game = time_after_game = 0;
@@ -410,7 +562,11 @@ SV_Frame(int usec)
 	SV_CheckTimeouts();
 
 	/* get packets from clients */
+	PROF_BEGIN("SV_ReadPackets");
+	start = Sys_Microseconds();
 	SV_ReadPackets();
+	sv_frametimes.readpackets += Sys_Microseconds() - start;
+	PROF_END();
 
 	/* send messages more often to new clients getting ready for spawning in
 	   speeds up the process of sending configstrings, entty deltas, etc.
@@ -419,7 +575,11 @@ SV_Frame(int usec)
 
 	if (opt_sendrate)
 	{
+		PROF_BEGIN("SV_SendPrepClientMessages");
+		start = Sys_Microseconds();
 		SV_SendPrepClientMessages();
+		sv_frametimes.sendmessages += Sys_Microseconds() - start;
+		PROF_END();
 	}
 
 	/* move autonomous things around if enough time has passed */
@@ -436,7 +596,9 @@ SV_Frame(int usec)
 			svs.realtime = sv.time - 100;
 		}
 
+		PROF_BEGIN("NET_Sleep");
 		NET_Sleep(sv.time - svs.realtime);
+		PROF_END();
 		return;
 	}
 
@@ -447,9 +609,15 @@ SV_Frame(int usec)
 	SV_GiveMsec();
 
 	/* let everything in the world think and move */
+	PROF_BEGIN("SV_RunGameFrame");
+	start = Sys_Microseconds();
 	SV_RunGameFrame();
+	sv_frametimes.rungame += Sys_Microseconds() - start;
+	PROF_END();
 
 	/* send messages back to the clients that had packets read this frame */
+	PROF_BEGIN("SV_SendClientMessages");
+	start = Sys_Microseconds();
 	SV_SendClientMessages();
 
 	/* if not optimizing, send all messages here */
@@ -458,6 +626,9 @@ SV_Frame(int usec)
 		SV_SendPrepClientMessages();
 	}
 
+	sv_frametimes.sendmessages += Sys_Microseconds() - start;
+	PROF_END();
+
 	/* save the entire world state if recording a serverdemo */
 	SV_RecordDemoMessage();
 
@@ -466,6 +637,9 @@ SV_Frame(int usec)
 
 	/* clear teleport flags, etc for next frame */
 	SV_PrepWorldFrame();
+
+	/* read ahead the next map */
+	SV_PrefetchFrame();
 }
 
 /*
@@ -639,6 +813,12 @@ SV_Init(void)
 
 	sv_airaccelerate = Cvar_Get("sv_airaccelerate", "0", CVAR_LATCH);
 
+	sv_broadphase = Cvar_Get("sv_broadphase", "1", CVAR_LATCH);
+
+	sv_threads = Cvar_Get("sv_threads", "1", 0);
+
+	sv_oobrate = Cvar_Get("sv_oobrate", "20", 0);
+
 	public_server = Cvar_Get("public", "0", 0);
 
 	sv_entfile = Cvar_Get("sv_entfile", "1", CVAR_ARCHIVE);
@@ -728,7 +908,9 @@ SV_Shutdown(const char *finalmsg, qboolean reconnect)
 	}
 
 	Master_Shutdown();
+	SV_PrefetchStop();
 	SV_ShutdownGameProgs();
+	SV_FreeWorld();
 
 	/* free current level */
 	if (sv.demofile)
@@ -761,6 +943,8 @@ SV_Shutdown(const char *finalmsg, qboolean reconnect)
 	}
 
 	memset(&svs, 0, sizeof(svs));
+	SV_ClearClientHash();
 
 	SV_SendFreeBuffers();
+	SV_FreeFrameBuffers();
 }
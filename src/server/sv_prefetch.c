@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * Map prefetching. While the intermission is up the game asks for the
+ * next map with sv_prefetch. The files of that map are opened and a
+ * background thread reads them into the page cache, then the BSP is
+ * converted into the collision model cache, where CM_LoadMap() finds
+ * it when gamemap fires. Finally the sounds and models named in the
+ * entity string are read ahead the same way. Each step runs in its
+ * own server frame, so the intermission doesn't stall.
+ *
+ * =======================================================================
+ */
+
+#include "header/server.h"
+
+#define PREFETCH_MAXFILES 64
+
+typedef enum
+{
+	PREFETCH_IDLE,
+	PREFETCH_READMAP,    /* thread reads the BSP and bot nodes */
+	PREFETCH_CONVERT,    /* BSP goes into the collision model cache */
+	PREFETCH_READFILES,  /* thread reads sounds and models */
+} prefetchstate_t;
+
+typedef struct
+{
+	char name[MAX_QPATH];
+	FILE *file;
+	int size;
+} prefetchfile_t;
+
+static struct
+{
+	prefetchstate_t state;
+	char mapname[MAX_QPATH];
+	long long start;
+
+	prefetchfile_t files[PREFETCH_MAXFILES];
+	int numfiles;
+	int bytes;
+
+	void *thread;
+	byte buffer[0x10000];   /* the thread reads into it */
+} prefetch;
+
+/*
+ * Runs on the background thread, only touches the
+ * streams opened for it, never the file system.
+ */
+static void
+SV_PrefetchRead(void *data)
+{
+	int i, left;
+
+	for (i = 0; i < prefetch.numfiles; i++)
+	{
+		left = prefetch.files[i].size;
+
+		while (left > 0)
+		{
+			size_t len;
+
+			len = fread(prefetch.buffer, 1,
+				Q_min(left, (int)sizeof(prefetch.buffer)),
+				prefetch.files[i].file);
+
+			if (!len)
+			{
+				break;
+			}
+
+			left -= (int)len;
+		}
+	}
+}
+
+static void
+SV_PrefetchAddFile(const char *name)
+{
+	prefetchfile_t *file;
+	int i, size;
+
+	if (prefetch.numfiles == PREFETCH_MAXFILES)
+	{
+		return;
+	}
+
+	/* entities share their sounds */
+	for (i = 0; i < prefetch.numfiles; i++)
+	{
+		if (!Q_stricmp(prefetch.files[i].name, name))
+		{
+			return;
+		}
+	}
+
+	/* compressed files in pk3s can't be read off
+	   the main thread, they're left out */
+	file = &prefetch.files[prefetch.numfiles];
+	file->file = FS_FOpenRaw(name, &size);
+
+	if (!file->file)
+	{
+		return;
+	}
+
+	Q_strlcpy(file->name, name, sizeof(file->name));
+	file->size = size;
+	prefetch.bytes += size;
+	prefetch.numfiles++;
+}
+
+static void
+SV_PrefetchFreeFiles(void)
+{
+	int i;
+
+	for (i = 0; i < prefetch.numfiles; i++)
+	{
+		fclose(prefetch.files[i].file);
+	}
+
+	prefetch.numfiles = 0;
+}
+
+/*
+ * Starts reading the opened files. Without
+ * a thread it's done right away.
+ */
+static void
+SV_PrefetchStartRead(prefetchstate_t state)
+{
+	prefetch.state = state;
+	prefetch.thread = Sys_StartThread(SV_PrefetchRead, NULL);
+
+	if (!prefetch.thread)
+	{
+		SV_PrefetchRead(NULL);
+	}
+}
+
+/*
+ * Adds the sounds and models named in the entity string.
+ */
+static void
+SV_PrefetchEntityFiles(const char *entities)
+{
+	char key[MAX_TOKEN_CHARS];
+	const char *value;
+	char *data;
+
+	/* COM_Parse() doesn't write to the string */
+	data = (char *)entities;
+
+	while (data)
+	{
+		value = COM_Parse(&data);
+
+		if (!data || (value[0] == '{') || (value[0] == '}'))
+		{
+			continue;
+		}
+
+		Q_strlcpy(key, value, sizeof(key));
+		value = COM_Parse(&data);
+
+		if (!data)
+		{
+			break;
+		}
+
+		if (!strcmp(key, "noise") && value[0])
+		{
+			if (value[0] == '#')
+			{
+				SV_PrefetchAddFile(value + 1);
+			}
+			else
+			{
+				SV_PrefetchAddFile(va("sound/%s%s", value,
+					strstr(value, ".wav") ? "" : ".wav"));
+			}
+		}
+		else if (!strcmp(key, "model") && value[0] && (value[0] != '*'))
+		{
+			SV_PrefetchAddFile(value);
+		}
+	}
+}
+
+/*
+ * Stops a running prefetch, what was loaded so far is kept.
+ */
+void
+SV_PrefetchStop(void)
+{
+	if (prefetch.thread)
+	{
+		Sys_JoinThread(prefetch.thread);
+		prefetch.thread = NULL;
+	}
+
+	SV_PrefetchFreeFiles();
+	prefetch.state = PREFETCH_IDLE;
+}
+
+/*
+ * Advances the prefetch by at most one step, called every server frame.
+ */
+void
+SV_PrefetchFrame(void)
+{
+	const char *entities;
+
+	if (prefetch.state == PREFETCH_IDLE)
+	{
+		return;
+	}
+
+	if (prefetch.thread)
+	{
+		if (!Sys_ThreadDone(prefetch.thread))
+		{
+			return;
+		}
+
+		Sys_JoinThread(prefetch.thread);
+		prefetch.thread = NULL;
+	}
+
+	SV_PrefetchFreeFiles();
+
+	switch (prefetch.state)
+	{
+		case PREFETCH_READMAP:
+			prefetch.state = PREFETCH_CONVERT;
+			break;
+
+		case PREFETCH_CONVERT:
+			entities = CM_PrefetchMap(va("maps/%s.bsp", prefetch.mapname));
+
+			if (entities)
+			{
+				SV_PrefetchEntityFiles(entities);
+			}
+
+			SV_PrefetchStartRead(PREFETCH_READFILES);
+			break;
+
+		default:
+			Com_DPrintf("Prefetched %s, %i KiB in %.1f ms\n",
+				prefetch.mapname, prefetch.bytes / 1024,
+				(Sys_Microseconds() - prefetch.start) / 1000.0f);
+			prefetch.state = PREFETCH_IDLE;
+			break;
+	}
+}
+
+/*
+ * sv_prefetch <map>
+ * Accepts the same map names as gamemap.
+ */
+void
+SV_Prefetch_f(void)
+{
+	char level[MAX_QPATH];
+	char *ch;
+
+	if (Cmd_Argc() != 2)
+	{
+		Com_Printf("Usage: sv_prefetch <map>\n");
+		return;
+	}
+
+	if (sv.state != ss_game)
+	{
+		return;
+	}
+
+	Q_strlcpy(level, Cmd_Argv(1), sizeof(level));
+
+	/* the first map of a +list, without spawnpoint and unit flag */
+	if ((ch = strchr(level, '+')))
+	{
+		*ch = 0;
+	}
+
+	if ((ch = strchr(level, '$')))
+	{
+		*ch = 0;
+	}
+
+	ch = (level[0] == '*') ? level + 1 : level;
+
+	/* cinematics and pictures */
+	if (!ch[0] || strchr(ch, '.'))
+	{
+		return;
+	}
+
+	SV_PrefetchStop();
+
+	Q_strlcpy(prefetch.mapname, ch, sizeof(prefetch.mapname));
+	prefetch.start = Sys_Microseconds();
+	prefetch.bytes = 0;
+
+	if (!FS_FileExists(va("maps/%s.bsp", prefetch.mapname)))
+	{
+		Com_DPrintf("%s: no map %s\n", __func__, prefetch.mapname);
+		return;
+	}
+
+	SV_PrefetchAddFile(va("maps/%s.bsp", prefetch.mapname));
+	SV_PrefetchAddFile(va("navigation/%s.nav", prefetch.mapname));
+	SV_PrefetchStartRead(PREFETCH_READMAP);
+}
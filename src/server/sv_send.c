@@ -132,63 +132,219 @@ SV_BroadcastCommand(const char *fmt, ...)
 	SV_Multicast(NULL, MULTICAST_ALL_R);
 }
 
+static void
+SV_GetClientLeafCache(client_t *client, int *area, int *cluster)
+{
+	edict_t *e = CL_EDICT(client);
+
+	if (client->cached_framenum != sv.framenum ||
+	    !VectorCompare(client->cached_origin, e->s.origin))
+	{
+		VectorCopy(e->s.origin, client->cached_origin);
+		client->cached_leafnum = CM_PointLeafnum(e->s.origin);
+		client->cached_area = CM_LeafArea(client->cached_leafnum);
+		client->cached_cluster = CM_LeafCluster(client->cached_leafnum);
+		client->cached_framenum = sv.framenum;
+	}
+
+	*area = client->cached_area;
+	*cluster = client->cached_cluster;
+}
+
 /*
- * Sends the contents of sv.multicast to a subset of the clients,
- * then clears sv.multicast.
- *
- * MULTICAST_ALL	same as broadcast (origin can be NULL)
- * MULTICAST_PVS	send to clients potentially visible from org
- * MULTICAST_PHS	send to clients potentially hearable from org
+ * The clients grouped by the cluster they're in, so a multicast only
+ * tests the occupied clusters against its PVS / PHS row. Rebuilt once
+ * a frame, clients that were linked since are moved to their new
+ * cluster before the next multicast.
  */
-static qboolean
-SV_WereConnected(int cluster, int area2, const byte *mask, int area1,
-		 size_t mask_size, qboolean underwater, int water_cluster, int water_area)
+#define CLIENT_WORDS ((MAX_CLIENTS + 31) / 32)
+
+typedef struct
+{
+	int cluster;
+	unsigned clients[CLIENT_WORDS];
+} clusterclients_t;
+
+static clusterclients_t cluster_clients[MAX_CLIENTS];
+static int cluster_count;
+static int cluster_slot[MAX_CLIENTS];        /* -1 if in no cluster */
+static unsigned cluster_moved[CLIENT_WORDS];
+static qboolean cluster_anymoved;
+static int cluster_framenum = -1;
+
+static void
+SV_ClusterRemove(int clientnum)
 {
-	if (cluster >= 0 && ((cluster >> 3) < mask_size) &&
-	    (mask[cluster >> 3] & (1 << (cluster & 7))))
+	clusterclients_t *slot;
+	int i, num;
+
+	num = cluster_slot[clientnum];
+
+	if (num < 0)
 	{
-		if (CM_AreasConnected(area1, area2))
+		return;
+	}
+
+	cluster_slot[clientnum] = -1;
+	slot = &cluster_clients[num];
+	slot->clients[clientnum >> 5] &= ~(1u << (clientnum & 31));
+
+	for (i = 0; i < CLIENT_WORDS; i++)
+	{
+		if (slot->clients[i])
 		{
-			return true;
+			return;
 		}
 	}
 
-	if (underwater && water_cluster >= 0 && ((water_cluster >> 3) < mask_size) &&
-	    (mask[water_cluster >> 3] & (1 << (water_cluster & 7))))
+	/* keep the occupied clusters packed */
+	cluster_count--;
+
+	if (num == cluster_count)
 	{
-		if (CM_AreasConnected(area1, water_area))
+		return;
+	}
+
+	*slot = cluster_clients[cluster_count];
+
+	for (i = 0; i < MAX_CLIENTS; i++)
+	{
+		if (slot->clients[i >> 5] & (1u << (i & 31)))
 		{
-			return true;
+			cluster_slot[i] = num;
 		}
 	}
+}
 
-	return false;
+static void
+SV_ClusterAdd(int clientnum)
+{
+	clusterclients_t *slot;
+	int i, area, cluster;
+
+	SV_GetClientLeafCache(&svs.clients[clientnum], &area, &cluster);
+
+	if (cluster < 0)
+	{
+		return;
+	}
+
+	for (i = 0; i < cluster_count; i++)
+	{
+		if (cluster_clients[i].cluster == cluster)
+		{
+			break;
+		}
+	}
+
+	slot = &cluster_clients[i];
+
+	if (i == cluster_count)
+	{
+		memset(slot, 0, sizeof(*slot));
+		slot->cluster = cluster;
+		cluster_count++;
+	}
+
+	slot->clients[clientnum >> 5] |= 1u << (clientnum & 31);
+	cluster_slot[clientnum] = i;
 }
 
 static void
-SV_GetClientLeafCache(client_t *client, int *area, int *cluster)
+SV_UpdateClusters(void)
 {
-	edict_t *e = CL_EDICT(client);
+	int i;
 
-	if (client->cached_framenum != sv.framenum ||
-	    !VectorCompare(client->cached_origin, e->s.origin))
+	if (cluster_framenum != sv.framenum)
 	{
-		VectorCopy(e->s.origin, client->cached_origin);
-		client->cached_leafnum = CM_PointLeafnum(e->s.origin);
-		client->cached_area = CM_LeafArea(client->cached_leafnum);
-		client->cached_cluster = CM_LeafCluster(client->cached_leafnum);
-		client->cached_framenum = sv.framenum;
+		cluster_framenum = sv.framenum;
+		cluster_count = 0;
+
+		for (i = 0; i < maxclients->value; i++)
+		{
+			cluster_slot[i] = -1;
+
+			if ((svs.clients[i].state != cs_free) &&
+				(svs.clients[i].state != cs_zombie))
+			{
+				SV_ClusterAdd(i);
+			}
+		}
 	}
+	else if (cluster_anymoved)
+	{
+		for (i = 0; i < maxclients->value; i++)
+		{
+			if (!(cluster_moved[i >> 5] & (1u << (i & 31))))
+			{
+				continue;
+			}
 
-	*area = client->cached_area;
-	*cluster = client->cached_cluster;
+			SV_ClusterRemove(i);
+
+			if ((svs.clients[i].state != cs_free) &&
+				(svs.clients[i].state != cs_zombie))
+			{
+				SV_ClusterAdd(i);
+			}
+		}
+	}
+
+	memset(cluster_moved, 0, sizeof(cluster_moved));
+	cluster_anymoved = false;
+}
+
+/*
+ * Called when the edict of a client was linked,
+ * it may be in another cluster now.
+ */
+void
+SV_ClientMoved(const edict_t *ent)
+{
+	int clientnum;
+
+	clientnum = NUM_FOR_EDICT(ent) - 1;
+
+	if ((clientnum < 0) || (clientnum >= maxclients->value))
+	{
+		return;
+	}
+
+	cluster_moved[clientnum >> 5] |= 1u << (clientnum & 31);
+	cluster_anymoved = true;
+}
+
+/*
+ * Forgets the clusters of all clients, for a new map.
+ */
+void
+SV_ClearClusters(void)
+{
+	cluster_framenum = -1;
+	cluster_count = 0;
+}
+
+static qboolean
+SV_ClusterInMask(int cluster, const byte *mask, size_t mask_size)
+{
+	return (cluster >= 0) && ((cluster >> 3) < mask_size) &&
+		(mask[cluster >> 3] & (1 << (cluster & 7)));
 }
 
+/*
+ * Sends the contents of sv.multicast to a subset of the clients,
+ * then clears sv.multicast.
+ *
+ * MULTICAST_ALL	same as broadcast (origin can be NULL)
+ * MULTICAST_PVS	send to clients potentially visible from org
+ * MULTICAST_PHS	send to clients potentially hearable from org
+ */
 void
 SV_Multicast(const vec3_t origin, multicast_t to)
 {
-	int leafnum = 0, cluster, area1 = 0, water_area = 0, water_cluster = -1, j;
-	qboolean reliable, underwater = false;
+	int leafnum = 0, cluster, area1 = 0, water_area = 0, water_cluster = -1, i, j;
+	unsigned targets[CLIENT_WORDS];
+	qboolean reliable;
 	client_t *client;
 	const byte *mask;
 	size_t mask_size = 0;
@@ -245,31 +401,49 @@ SV_Multicast(const vec3_t origin, multicast_t to)
 		water_leafnum = CM_PointLeafnum(origin2);
 		water_cluster = CM_LeafCluster(water_leafnum);
 		water_area = CM_LeafArea(water_leafnum);
-		underwater = true;
+
+		/* the surface above is seen from the row, everyone gets it */
+		if (SV_ClusterInMask(water_cluster, mask, mask_size) &&
+			CM_AreasConnected(area1, water_area))
+		{
+			mask = NULL;
+		}
+	}
+
+	if (mask)
+	{
+		SV_UpdateClusters();
+		memset(targets, 0, sizeof(targets));
+
+		for (i = 0; i < cluster_count; i++)
+		{
+			if (SV_ClusterInMask(cluster_clients[i].cluster, mask, mask_size))
+			{
+				for (j = 0; j < CLIENT_WORDS; j++)
+				{
+					targets[j] |= cluster_clients[i].clients[j];
+				}
+			}
+		}
 	}
 
 	/* send the data to all relevent clients */
 	for (j = 0, client = svs.clients; j < maxclients->value; j++, client++)
 	{
-		if ((client->state == cs_free) || (client->state == cs_zombie))
+		if (mask && (!(targets[j >> 5] & (1u << (j & 31))) ||
+			!CM_AreasConnected(area1, client->cached_area)))
 		{
 			continue;
 		}
 
-		if ((client->state != cs_spawned) && !reliable)
+		if ((client->state == cs_free) || (client->state == cs_zombie))
 		{
 			continue;
 		}
 
-		if (mask)
+		if ((client->state != cs_spawned) && !reliable)
 		{
-			int area2, cluster2;
-			SV_GetClientLeafCache(client, &area2, &cluster2);
-
-			if (!SV_WereConnected(cluster2, area2, mask, area1, mask_size, underwater, water_cluster, water_area))
-			{
-				continue;
-			}
+			continue;
 		}
 
 		SZ_Write(reliable ? &client->netchan.message : &client->datagram,
@@ -446,6 +620,12 @@ SV_StartSound(const vec3_t origin, const edict_t *entity, int channel, int sound
 static int msgbuff_size = 0;
 static byte *msgbuff_cache = NULL;
 
+/* clients and frames of SV_SendClientDatagrams */
+static client_t **sendbuff_clients = NULL;
+static sizebuf_t *sendbuff_msgs = NULL;
+static byte *sendbuff_data = NULL;
+static int sendbuff_numclients = 0;
+
 static byte *
 SV_SendReallocBuffers(int *num)
 {
@@ -474,6 +654,28 @@ SV_SendReallocBuffers(int *num)
 	return msgbuff_cache;
 }
 
+/*
+ * Makes room for the frames of numclients clients
+ * built in parallel by SV_SendClientDatagrams.
+ */
+static void
+SV_SendReallocClientBuffers(int numclients)
+{
+	if (numclients <= sendbuff_numclients)
+	{
+		return;
+	}
+
+	sendbuff_clients = realloc(sendbuff_clients, numclients * sizeof(client_t *));
+	YQ2_COM_CHECK_OOM(sendbuff_clients, "realloc()", numclients * sizeof(client_t *))
+	sendbuff_msgs = realloc(sendbuff_msgs, numclients * sizeof(sizebuf_t));
+	YQ2_COM_CHECK_OOM(sendbuff_msgs, "realloc()", numclients * sizeof(sizebuf_t))
+	sendbuff_data = realloc(sendbuff_data, numclients * MAX_MSGLEN);
+	YQ2_COM_CHECK_OOM(sendbuff_data, "realloc()", numclients * MAX_MSGLEN)
+
+	sendbuff_numclients = numclients;
+}
+
 void
 SV_SendInitBuffers(void)
 {
@@ -495,27 +697,23 @@ SV_SendFreeBuffers(void)
 		msgbuff_cache = NULL;
 	}
 	msgbuff_size = 0;
+
+	free(sendbuff_clients);
+	free(sendbuff_msgs);
+	free(sendbuff_data);
+	sendbuff_clients = NULL;
+	sendbuff_msgs = NULL;
+	sendbuff_data = NULL;
+	sendbuff_numclients = 0;
 }
 
-static qboolean
-SV_SendClientDatagram(client_t *client)
+/*
+ * Appends the accumulated multicast datagram to
+ * the frame in msg and sends it to the client.
+ */
+static void
+SV_TransmitClientDatagram(client_t *client, sizebuf_t *msg)
 {
-	int msg_buf_size;
-	byte *msg_buf;
-	sizebuf_t msg;
-
-	msg_buf_size = MAX_MSGLEN;
-	msg_buf = SV_SendReallocBuffers(&msg_buf_size);
-
-	SV_BuildClientFrame(client);
-
-	SZ_Init(&msg, msg_buf, msg_buf_size);
-	msg.allowoverflow = true;
-
-	/* send over all the relevant entity_state_t
-	   and the player_state_t */
-	SV_WriteFrameToClient(client, &msg);
-
 	/* copy the accumulated multicast datagram
 	   for this client out to the message
 	   it is necessary for this to be after the WriteEntities
@@ -526,27 +724,96 @@ SV_SendClientDatagram(client_t *client)
 	}
 	else
 	{
-		SZ_Write(&msg, client->datagram.data, client->datagram.cursize);
+		SZ_Write(msg, client->datagram.data, client->datagram.cursize);
 	}
 
 	SZ_Clear(&client->datagram);
 
-	if (msg.overflowed)
+	if (msg->overflowed)
 	{
 		/* must have room left for the packet header */
 		Com_Printf("WARNING: msg overflowed for %s\n", client->name);
-		SZ_Clear(&msg);
+		SZ_Clear(msg);
 	}
 
 	/* send the datagram */
-	Netchan_Transmit(&client->netchan, msg.cursize, msg.data);
+	Netchan_Transmit(&client->netchan, msg->cursize, msg->data);
 
 	/* record the size for rate estimation */
-	client->message_size[sv.framenum % RATE_MESSAGES] = msg.cursize;
+	client->message_size[sv.framenum % RATE_MESSAGES] = msg->cursize;
+}
+
+static qboolean
+SV_SendClientDatagram(client_t *client)
+{
+	int msg_buf_size;
+	byte *msg_buf;
+	sizebuf_t msg;
+
+	msg_buf_size = MAX_MSGLEN;
+	msg_buf = SV_SendReallocBuffers(&msg_buf_size);
+
+	SV_BuildClientFrame(client);
+
+	SZ_Init(&msg, msg_buf, msg_buf_size);
+	msg.allowoverflow = true;
+
+	/* send over all the relevant entity_state_t
+	   and the player_state_t */
+	SV_WriteFrameToClient(client, &msg, 0);
+
+	SV_TransmitClientDatagram(client, &msg);
 
 	return true;
 }
 
+static void
+SV_WriteFrameJob(void *data, int index, int worker)
+{
+	client_t **clients = data;
+	sizebuf_t *msg;
+
+	/* SV_EmitPacketEntities stops well before MAX_MSGLEN,
+	   so this never overflows and prints from a worker */
+	msg = &sendbuff_msgs[index];
+	SZ_Init(msg, sendbuff_data + index * MAX_MSGLEN, MAX_MSGLEN);
+	msg->allowoverflow = true;
+
+	SV_WriteFrameToClient(clients[index], msg, worker);
+}
+
+/*
+ * SV_SendClientDatagram for a batch of clients. Building and
+ * delta compressing the frames is spread over the worker threads,
+ * sending them stays on the main thread.
+ */
+static void
+SV_SendClientDatagrams(client_t **clients, int count)
+{
+	int i;
+
+	SV_ResetDeltaCache();
+
+	if ((count < 2) || !sv_threads->value || (Sys_NumWorkers() < 2))
+	{
+		for (i = 0; i < count; i++)
+		{
+			SV_SendClientDatagram(clients[i]);
+		}
+
+		return;
+	}
+
+	SV_BuildClientFrames(clients, count);
+
+	Sys_ParallelFor(count, SV_WriteFrameJob, clients);
+
+	for (i = 0; i < count; i++)
+	{
+		SV_TransmitClientDatagram(clients[i], &sendbuff_msgs[i]);
+	}
+}
+
 static void
 SV_DemoCompleted(void)
 {
@@ -651,9 +918,13 @@ SV_SendClientMessages(void)
 	int i;
 	client_t *c;
 	int msglen;
+	int numsend;
 	byte *msgbuf = NULL;
 
 	msglen = 0;
+	numsend = 0;
+
+	SV_SendReallocClientBuffers(maxclients->value);
 
 	/* read the next demo message if needed */
 	if (sv.demofile && (sv.state == ss_demo))
@@ -671,6 +942,9 @@ SV_SendClientMessages(void)
 		msglen = 0;
 	}
 
+	/* everything of this frame goes out with as few calls as possible */
+	NET_BatchBegin(NS_SERVER);
+
 	/* send a message to each spawned client */
 	for (i = 0, c = svs.clients; i < maxclients->value; i++, c++)
 	{
@@ -699,11 +973,15 @@ SV_SendClientMessages(void)
 				continue;
 			}
 
-			SV_SendClientDatagram(c);
+			sendbuff_clients[numsend++] = c;
 		}
 
 		/* messages to non-spawned clients are sent by SendPrepClientMessages */
 	}
+
+	SV_SendClientDatagrams(sendbuff_clients, numsend);
+
+	NET_BatchFlush(NS_SERVER);
 }
 
 void
@@ -719,6 +997,8 @@ SV_SendPrepClientMessages(void)
 		return;
 	}
 
+	NET_BatchBegin(NS_SERVER);
+
 	/* send a message to each inactive client if needed */
 	for (i = 0, c = svs.clients; i < maxclients->value; i++, c++)
 	{
@@ -740,4 +1020,6 @@ SV_SendPrepClientMessages(void)
 			Netchan_Transmit(&c->netchan, 0, NULL);
 		}
 	}
+
+	NET_BatchFlush(NS_SERVER);
 }
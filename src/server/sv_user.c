@@ -754,6 +754,8 @@ SV_ExecuteClientMessage(client_t *cl)
 					return;
 				}
 
+				SV_BenchRecordCmd(cl, &newcmd);
+
 				if (!sv_paused->value)
 				{
 					int net_drop;
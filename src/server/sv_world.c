@@ -30,6 +30,9 @@
 #define AREA_NODES 32
 #define MAX_TOTAL_ENT_LEAFS 128
 
+#define BVH_MARGIN 8 /* entities may move this far without being relinked */
+#define BVH_STACK 256
+
 #define STRUCT_FROM_LINK(l, t, m) ((t *)((byte *)l - (byte *)&(((t *)NULL)->m)))
 #define EDICT_FROM_AREA(l) STRUCT_FROM_LINK(l, edict_t, area)
 
@@ -45,11 +48,54 @@ typedef struct areanode_s
 static areanode_t sv_areanodes[AREA_NODES];
 static int sv_numareanodes;
 
+/*
+ * Dynamic bounding volume hierarchy, one tree for solid
+ * entities and one for triggers. Leafs hold the boxes of the
+ * entities grown by BVH_MARGIN, inner nodes the union of their
+ * children. Kept balanced by rotations like an AVL tree.
+ */
+typedef struct
+{
+	vec3_t mins, maxs;
+	int parent; /* next free node if unused */
+	int children[2]; /* -1 for leafs */
+	int height; /* 0 for leafs, -1 if unused */
+	edict_t *ent;
+} bvhnode_t;
+
+typedef struct
+{
+	bvhnode_t *nodes;
+	int root;
+	int freelist;
+} bvhtree_t;
+
+static bvhtree_t sv_bvh[2]; /* AREA_SOLID - 1, AREA_TRIGGERS - 1 */
+static int *sv_bvhleafs; /* per edict number, leaf node or -1 */
+static byte *sv_bvhtrees; /* per edict number, tree the leaf is in */
+static int sv_bvhmaxedicts;
+
+/* How entities are sorted to reduce interaction tests */
+typedef struct
+{
+	const char *name;
+	void (*Clear)(void);
+	void (*Link)(edict_t *ent);
+	void (*Unlink)(edict_t *ent);
+	void (*Query)(void);
+} broadphase_t;
+
+static const broadphase_t *sv_broadphase_impl;
+
 static const float *area_mins, *area_maxs;
 static edict_t **area_list;
 static int area_count, area_maxcount;
 static int area_type;
 
+/* counters for sv_worldstats */
+static size_t sv_worldqueries, sv_worldcandidates, sv_worldfound;
+static size_t sv_worldtraces, sv_worldclips;
+
 static int SV_HullForEntity(edict_t *ent);
 
 /* ClearLink is used for new headnodes */
@@ -123,8 +169,8 @@ SV_CreateAreaNode(int depth, vec3_t mins, vec3_t maxs)
 	return anode;
 }
 
-void
-SV_ClearWorld(void)
+static void
+SV_AreaNodesClear(void)
 {
 	memset(sv_areanodes, 0, sizeof(sv_areanodes));
 	sv_numareanodes = 0;
@@ -134,6 +180,659 @@ SV_ClearWorld(void)
 	}
 }
 
+static void
+SV_AreaNodesLink(edict_t *ent)
+{
+	areanode_t *node;
+
+	if (ent->area.prev)
+	{
+		RemoveLink(&ent->area);
+	}
+
+	/* find the first node that the ent's box crosses */
+	node = sv_areanodes;
+
+	while (1)
+	{
+		if (node->axis == -1)
+		{
+			break;
+		}
+
+		if (ent->absmin[node->axis] > node->dist)
+		{
+			node = node->children[0];
+		}
+		else if (ent->absmax[node->axis] < node->dist)
+		{
+			node = node->children[1];
+		}
+		else
+		{
+			break; /* crosses the node */
+		}
+	}
+
+	/* link it in */
+	if (ent->solid == SOLID_TRIGGER)
+	{
+		InsertLinkBefore(&ent->area, &node->trigger_edicts);
+	}
+	else
+	{
+		InsertLinkBefore(&ent->area, &node->solid_edicts);
+	}
+}
+
+static void
+SV_AreaNodesUnlink(edict_t *ent)
+{
+	RemoveLink(&ent->area);
+}
+
+/*
+ * Adds check to area_list if it touches the area,
+ * returns false if the list is full
+ */
+static qboolean
+SV_AreaAddEdict(edict_t *check)
+{
+	sv_worldcandidates++;
+
+	if (check->solid == SOLID_NOT)
+	{
+		return true; /* deactivated */
+	}
+
+	if ((check->absmin[0] > area_maxs[0]) ||
+		(check->absmin[1] > area_maxs[1]) ||
+		(check->absmin[2] > area_maxs[2]) ||
+		(check->absmax[0] < area_mins[0]) ||
+		(check->absmax[1] < area_mins[1]) ||
+		(check->absmax[2] < area_mins[2]))
+	{
+		return true; /* not touching */
+	}
+
+	if (area_count == area_maxcount)
+	{
+		Com_Printf("SV_AreaEdicts: MAXCOUNT\n");
+		return false;
+	}
+
+	area_list[area_count] = check;
+	area_count++;
+
+	return true;
+}
+
+static void
+SV_AreaEdicts_r(areanode_t *node)
+{
+	link_t *l, *next, *start;
+
+	/* touch linked edicts */
+	if (area_type == AREA_SOLID)
+	{
+		start = &node->solid_edicts;
+	}
+	else
+	{
+		start = &node->trigger_edicts;
+	}
+
+	for (l = start->next; l != start; l = next)
+	{
+		next = l->next;
+
+		if (!SV_AreaAddEdict(EDICT_FROM_AREA(l)))
+		{
+			return;
+		}
+	}
+
+	if (node->axis == -1)
+	{
+		return; /* terminal node */
+	}
+
+	/* recurse down both sides */
+	if (area_maxs[node->axis] > node->dist)
+	{
+		SV_AreaEdicts_r(node->children[0]);
+	}
+
+	if (area_mins[node->axis] < node->dist)
+	{
+		SV_AreaEdicts_r(node->children[1]);
+	}
+}
+
+static void
+SV_AreaNodesQuery(void)
+{
+	SV_AreaEdicts_r(sv_areanodes);
+}
+
+static void
+SV_BVHUnion(const bvhnode_t *a, const bvhnode_t *b, bvhnode_t *out)
+{
+	int i;
+
+	for (i = 0; i < 3; i++)
+	{
+		out->mins[i] = Q_min(a->mins[i], b->mins[i]);
+		out->maxs[i] = Q_max(a->maxs[i], b->maxs[i]);
+	}
+}
+
+/* surface area, cost of a node in the tree */
+static float
+SV_BVHCost(const vec3_t mins, const vec3_t maxs)
+{
+	vec3_t size;
+
+	VectorSubtract(maxs, mins, size);
+
+	return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+}
+
+static float
+SV_BVHUnionCost(const bvhnode_t *a, const bvhnode_t *b)
+{
+	bvhnode_t u;
+
+	SV_BVHUnion(a, b, &u);
+
+	return SV_BVHCost(u.mins, u.maxs);
+}
+
+static int
+SV_BVHAllocNode(bvhtree_t *tree)
+{
+	bvhnode_t *node;
+	int n;
+
+	n = tree->freelist;
+
+	if (n < 0)
+	{
+		/* can't happen, there are 2 * max_edicts nodes */
+		Com_Error(ERR_FATAL, "%s: out of nodes", __func__);
+	}
+
+	node = &tree->nodes[n];
+	tree->freelist = node->parent;
+
+	node->parent = -1;
+	node->children[0] = node->children[1] = -1;
+	node->height = 0;
+	node->ent = NULL;
+
+	return n;
+}
+
+static void
+SV_BVHFreeNode(bvhtree_t *tree, int n)
+{
+	tree->nodes[n].parent = tree->freelist;
+	tree->nodes[n].height = -1;
+	tree->freelist = n;
+}
+
+static void
+SV_BVHReplaceChild(bvhtree_t *tree, int parent, int oldchild, int newchild)
+{
+	if (parent == -1)
+	{
+		tree->root = newchild;
+	}
+	else if (tree->nodes[parent].children[0] == oldchild)
+	{
+		tree->nodes[parent].children[0] = newchild;
+	}
+	else
+	{
+		tree->nodes[parent].children[1] = newchild;
+	}
+}
+
+static void
+SV_BVHRefit(bvhtree_t *tree, int n)
+{
+	bvhnode_t *node, *c0, *c1;
+
+	node = &tree->nodes[n];
+	c0 = &tree->nodes[node->children[0]];
+	c1 = &tree->nodes[node->children[1]];
+
+	SV_BVHUnion(c0, c1, node);
+	node->height = 1 + Q_max(c0->height, c1->height);
+}
+
+/*
+ * If one child of a is more than one level higher than the
+ * other, rotates the higher child up. Returns the node now
+ * in the place of a.
+ */
+static int
+SV_BVHBalance(bvhtree_t *tree, int a)
+{
+	bvhnode_t *A;
+	int i, b, c, balance;
+
+	A = &tree->nodes[a];
+
+	if (A->height < 2)
+	{
+		return a;
+	}
+
+	for (i = 0; i < 2; i++)
+	{
+		bvhnode_t *B, *C;
+		int f, g, keep, move;
+
+		b = A->children[i];
+		c = A->children[!i];
+		B = &tree->nodes[b];
+		C = &tree->nodes[c];
+
+		balance = C->height - B->height;
+
+		if (balance <= 1)
+		{
+			continue;
+		}
+
+		/* rotate c up, a becomes its child in
+		   place of the lower one of c's children */
+		f = C->children[0];
+		g = C->children[1];
+
+		if (tree->nodes[f].height > tree->nodes[g].height)
+		{
+			keep = f;
+			move = g;
+		}
+		else
+		{
+			keep = g;
+			move = f;
+		}
+
+		C->parent = A->parent;
+		SV_BVHReplaceChild(tree, C->parent, a, c);
+		A->parent = c;
+
+		C->children[0] = a;
+		C->children[1] = keep;
+
+		A->children[!i] = move;
+		tree->nodes[move].parent = a;
+
+		SV_BVHRefit(tree, a);
+		SV_BVHRefit(tree, c);
+
+		return c;
+	}
+
+	return a;
+}
+
+static void
+SV_BVHFixUpwards(bvhtree_t *tree, int n)
+{
+	while (n != -1)
+	{
+		n = SV_BVHBalance(tree, n);
+		SV_BVHRefit(tree, n);
+		n = tree->nodes[n].parent;
+	}
+}
+
+static void
+SV_BVHInsertLeaf(bvhtree_t *tree, int leaf)
+{
+	bvhnode_t *L;
+	int sibling, oldparent, newparent;
+
+	L = &tree->nodes[leaf];
+
+	if (tree->root == -1)
+	{
+		tree->root = leaf;
+		L->parent = -1;
+		return;
+	}
+
+	/* descend to the sibling that grows the tree the least */
+	sibling = tree->root;
+
+	while (tree->nodes[sibling].height > 0)
+	{
+		const bvhnode_t *N;
+		float area, combined, cost, inherit, childcost[2];
+		int i;
+
+		N = &tree->nodes[sibling];
+		area = SV_BVHCost(N->mins, N->maxs);
+		combined = SV_BVHUnionCost(N, L);
+
+		/* cost of a new parent for N and the leaf */
+		cost = 2 * combined;
+
+		/* minimum cost of pushing the leaf further down */
+		inherit = 2 * (combined - area);
+
+		for (i = 0; i < 2; i++)
+		{
+			const bvhnode_t *child;
+
+			child = &tree->nodes[N->children[i]];
+			childcost[i] = SV_BVHUnionCost(child, L) + inherit;
+
+			if (child->height > 0)
+			{
+				childcost[i] -= SV_BVHCost(child->mins, child->maxs);
+			}
+		}
+
+		if ((cost < childcost[0]) && (cost < childcost[1]))
+		{
+			break;
+		}
+
+		sibling = N->children[childcost[0] < childcost[1] ? 0 : 1];
+	}
+
+	oldparent = tree->nodes[sibling].parent;
+	newparent = SV_BVHAllocNode(tree);
+
+	/* tree->nodes wasn't reallocated, L is still valid */
+	tree->nodes[newparent].parent = oldparent;
+	tree->nodes[newparent].children[0] = sibling;
+	tree->nodes[newparent].children[1] = leaf;
+	SV_BVHReplaceChild(tree, oldparent, sibling, newparent);
+
+	tree->nodes[sibling].parent = newparent;
+	L->parent = newparent;
+
+	SV_BVHFixUpwards(tree, newparent);
+}
+
+static void
+SV_BVHRemoveLeaf(bvhtree_t *tree, int leaf)
+{
+	int parent, grandparent, sibling;
+
+	if (leaf == tree->root)
+	{
+		tree->root = -1;
+		return;
+	}
+
+	parent = tree->nodes[leaf].parent;
+	grandparent = tree->nodes[parent].parent;
+	sibling = tree->nodes[parent].children[0] == leaf ?
+		tree->nodes[parent].children[1] :
+		tree->nodes[parent].children[0];
+
+	SV_BVHReplaceChild(tree, grandparent, parent, sibling);
+	tree->nodes[sibling].parent = grandparent;
+	SV_BVHFreeNode(tree, parent);
+
+	SV_BVHFixUpwards(tree, grandparent);
+}
+
+static void
+SV_BVHFree(void)
+{
+	int i;
+
+	for (i = 0; i < 2; i++)
+	{
+		if (sv_bvh[i].nodes)
+		{
+			Z_Free(sv_bvh[i].nodes);
+		}
+	}
+
+	if (sv_bvhleafs)
+	{
+		Z_Free(sv_bvhleafs);
+	}
+
+	if (sv_bvhtrees)
+	{
+		Z_Free(sv_bvhtrees);
+	}
+
+	memset(sv_bvh, 0, sizeof(sv_bvh));
+	sv_bvhleafs = NULL;
+	sv_bvhtrees = NULL;
+	sv_bvhmaxedicts = 0;
+}
+
+static void
+SV_BVHClear(void)
+{
+	int i, j, numnodes;
+
+	if (!ge || (ge->max_edicts != sv_bvhmaxedicts))
+	{
+		SV_BVHFree();
+
+		if (!ge)
+		{
+			return;
+		}
+
+		sv_bvhmaxedicts = ge->max_edicts;
+		sv_bvhleafs = Z_Malloc(sv_bvhmaxedicts * sizeof(int));
+		sv_bvhtrees = Z_Malloc(sv_bvhmaxedicts);
+
+		for (i = 0; i < 2; i++)
+		{
+			sv_bvh[i].nodes = Z_Malloc(2 * sv_bvhmaxedicts * sizeof(bvhnode_t));
+		}
+	}
+
+	numnodes = 2 * sv_bvhmaxedicts;
+
+	for (i = 0; i < 2; i++)
+	{
+		bvhtree_t *tree = &sv_bvh[i];
+
+		tree->root = -1;
+		tree->freelist = -1;
+
+		for (j = numnodes - 1; j >= 0; j--)
+		{
+			SV_BVHFreeNode(tree, j);
+		}
+	}
+
+	for (i = 0; i < sv_bvhmaxedicts; i++)
+	{
+		sv_bvhleafs[i] = -1;
+	}
+}
+
+static void
+SV_BVHUnlink(edict_t *ent)
+{
+	int num;
+
+	num = NUM_FOR_EDICT(ent);
+
+	if ((num < 0) || (num >= sv_bvhmaxedicts) || (sv_bvhleafs[num] < 0))
+	{
+		return;
+	}
+
+	SV_BVHRemoveLeaf(&sv_bvh[sv_bvhtrees[num]], sv_bvhleafs[num]);
+	SV_BVHFreeNode(&sv_bvh[sv_bvhtrees[num]], sv_bvhleafs[num]);
+	sv_bvhleafs[num] = -1;
+}
+
+static void
+SV_BVHLink(edict_t *ent)
+{
+	bvhtree_t *tree;
+	bvhnode_t *node;
+	int num, t, leaf;
+
+	num = NUM_FOR_EDICT(ent);
+
+	if ((num < 0) || (num >= sv_bvhmaxedicts))
+	{
+		return;
+	}
+
+	t = (ent->solid == SOLID_TRIGGER) ? 1 : 0;
+	leaf = sv_bvhleafs[num];
+
+	/* still inside the grown box, nothing to do */
+	if ((leaf >= 0) && (sv_bvhtrees[num] == t))
+	{
+		node = &sv_bvh[t].nodes[leaf];
+
+		if ((node->ent == ent) &&
+			(ent->absmin[0] >= node->mins[0]) &&
+			(ent->absmin[1] >= node->mins[1]) &&
+			(ent->absmin[2] >= node->mins[2]) &&
+			(ent->absmax[0] <= node->maxs[0]) &&
+			(ent->absmax[1] <= node->maxs[1]) &&
+			(ent->absmax[2] <= node->maxs[2]))
+		{
+			ClearLink(&ent->area);
+			return;
+		}
+	}
+
+	SV_BVHUnlink(ent);
+
+	tree = &sv_bvh[t];
+	leaf = SV_BVHAllocNode(tree);
+	node = &tree->nodes[leaf];
+
+	node->ent = ent;
+	VectorSet(node->mins, ent->absmin[0] - BVH_MARGIN,
+		ent->absmin[1] - BVH_MARGIN, ent->absmin[2] - BVH_MARGIN);
+	VectorSet(node->maxs, ent->absmax[0] + BVH_MARGIN,
+		ent->absmax[1] + BVH_MARGIN, ent->absmax[2] + BVH_MARGIN);
+
+	SV_BVHInsertLeaf(tree, leaf);
+
+	sv_bvhleafs[num] = leaf;
+	sv_bvhtrees[num] = t;
+
+	/* the area link isn't used, it only marks the entity as linked */
+	ClearLink(&ent->area);
+}
+
+static void
+SV_BVHQuery(void)
+{
+	const bvhtree_t *tree;
+	int stack[BVH_STACK];
+	int sp;
+
+	tree = &sv_bvh[(area_type == AREA_SOLID) ? 0 : 1];
+
+	if (!tree->nodes || (tree->root == -1))
+	{
+		return;
+	}
+
+	sp = 0;
+	stack[sp++] = tree->root;
+
+	while (sp)
+	{
+		const bvhnode_t *node;
+
+		node = &tree->nodes[stack[--sp]];
+
+		if ((node->mins[0] > area_maxs[0]) ||
+			(node->mins[1] > area_maxs[1]) ||
+			(node->mins[2] > area_maxs[2]) ||
+			(node->maxs[0] < area_mins[0]) ||
+			(node->maxs[1] < area_mins[1]) ||
+			(node->maxs[2] < area_mins[2]))
+		{
+			continue;
+		}
+
+		if (node->height == 0)
+		{
+			if (!SV_AreaAddEdict(node->ent))
+			{
+				return;
+			}
+
+			continue;
+		}
+
+		if (sp + 2 > BVH_STACK)
+		{
+			Com_Printf("%s: tree too deep\n", __func__);
+			return;
+		}
+
+		stack[sp++] = node->children[1];
+		stack[sp++] = node->children[0];
+	}
+}
+
+static const broadphase_t sv_broadphases[] = {
+	{
+		"areanodes",
+		SV_AreaNodesClear,
+		SV_AreaNodesLink,
+		SV_AreaNodesUnlink,
+		SV_AreaNodesQuery
+	},
+	{
+		"bvh",
+		SV_BVHClear,
+		SV_BVHLink,
+		SV_BVHUnlink,
+		SV_BVHQuery
+	}
+};
+
+void
+SV_ClearWorld(void)
+{
+	int type;
+
+	type = (int)sv_broadphase->value;
+
+	if ((type < 0) || (type >= (int)ARRLEN(sv_broadphases)))
+	{
+		type = 0;
+	}
+
+	sv_broadphase_impl = &sv_broadphases[type];
+	sv_broadphase_impl->Clear();
+
+	sv_worldqueries = sv_worldcandidates = sv_worldfound = 0;
+	sv_worldtraces = sv_worldclips = 0;
+}
+
+/*
+ * Frees what the broadphase allocated, on server shutdown
+ */
+void
+SV_FreeWorld(void)
+{
+	SV_BVHFree();
+	sv_broadphase_impl = NULL;
+}
+
 void
 SV_UnlinkEdict(edict_t *ent)
 {
@@ -142,31 +841,28 @@ SV_UnlinkEdict(edict_t *ent)
 		return; /* not linked in anywhere */
 	}
 
-	RemoveLink(&ent->area);
+	sv_broadphase_impl->Unlink(ent);
 	ent->area.prev = ent->area.next = NULL;
 }
 
 void
 SV_LinkEdict(edict_t *ent)
 {
-	areanode_t *node;
 	int leafs[MAX_TOTAL_ENT_LEAFS];
 	int clusters[MAX_TOTAL_ENT_LEAFS];
 	int num_leafs, topnode, i;
 
-	if (ent->area.prev)
-	{
-		SV_UnlinkEdict(ent); /* unlink from old position */
-	}
-
-	if (ent == ge->edicts)
+	/* the old position is left by the broadphase
+	   itself, it may keep the entity where it is */
+	if ((ent == ge->edicts) || !ent->inuse)
 	{
+		SV_UnlinkEdict(ent);
 		return; /* don't add the world */
 	}
 
-	if (!ent->inuse)
+	if (ent->client)
 	{
-		return;
+		SV_ClientMoved(ent);
 	}
 
 	/* set the size */
@@ -368,105 +1064,11 @@ SV_LinkEdict(edict_t *ent)
 
 	if (ent->solid == SOLID_NOT)
 	{
+		SV_UnlinkEdict(ent);
 		return;
 	}
 
-	/* find the first node that the ent's box crosses */
-	node = sv_areanodes;
-
-	while (1)
-	{
-		if (node->axis == -1)
-		{
-			break;
-		}
-
-		if (ent->absmin[node->axis] > node->dist)
-		{
-			node = node->children[0];
-		}
-		else if (ent->absmax[node->axis] < node->dist)
-		{
-			node = node->children[1];
-		}
-		else
-		{
-			break; /* crosses the node */
-		}
-	}
-
-	/* link it in */
-	if (ent->solid == SOLID_TRIGGER)
-	{
-		InsertLinkBefore(&ent->area, &node->trigger_edicts);
-	}
-	else
-	{
-		InsertLinkBefore(&ent->area, &node->solid_edicts);
-	}
-}
-
-static void
-SV_AreaEdicts_r(areanode_t *node)
-{
-	link_t *l, *next, *start;
-	edict_t *check;
-
-	/* touch linked edicts */
-	if (area_type == AREA_SOLID)
-	{
-		start = &node->solid_edicts;
-	}
-	else
-	{
-		start = &node->trigger_edicts;
-	}
-
-	for (l = start->next; l != start; l = next)
-	{
-		next = l->next;
-		check = (EDICT_FROM_AREA(l));
-
-		if (check->solid == SOLID_NOT)
-		{
-			continue; /* deactivated */
-		}
-
-		if ((check->absmin[0] > area_maxs[0]) ||
-			(check->absmin[1] > area_maxs[1]) ||
-			(check->absmin[2] > area_maxs[2]) ||
-			(check->absmax[0] < area_mins[0]) ||
-			(check->absmax[1] < area_mins[1]) ||
-			(check->absmax[2] < area_mins[2]))
-		{
-			continue; /* not touching */
-		}
-
-		if (area_count == area_maxcount)
-		{
-			Com_Printf("SV_AreaEdicts: MAXCOUNT\n");
-			return;
-		}
-
-		area_list[area_count] = check;
-		area_count++;
-	}
-
-	if (node->axis == -1)
-	{
-		return; /* terminal node */
-	}
-
-	/* recurse down both sides */
-	if (area_maxs[node->axis] > node->dist)
-	{
-		SV_AreaEdicts_r(node->children[0]);
-	}
-
-	if (area_mins[node->axis] < node->dist)
-	{
-		SV_AreaEdicts_r(node->children[1]);
-	}
+	sv_broadphase_impl->Link(ent);
 }
 
 int
@@ -480,7 +1082,9 @@ SV_AreaEdicts(const vec3_t mins, const vec3_t maxs, edict_t **list,
 	area_type = areatype;
 	area_count = 0;
 
-	SV_AreaEdicts_r(sv_areanodes);
+	sv_worldqueries++;
+	sv_broadphase_impl->Query();
+	sv_worldfound += area_count;
 
 	area_mins = 0;
 	area_maxs = 0;
@@ -616,6 +1220,7 @@ SV_ClipMoveToEntities(moveclip_t *clip)
 		}
 
 		/* might intersect, so do an exact clip */
+		sv_worldclips++;
 		headnode = SV_HullForEntity(touch);
 		angles = touch->s.angles;
 
@@ -698,6 +1303,8 @@ SV_Trace(const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t
 
 	memset(&clip, 0, sizeof(moveclip_t));
 
+	sv_worldtraces++;
+
 	/* clip to world */
 	clip.trace = CM_BoxTrace(start, end, mins, maxs, 0, contentmask);
 	clip.trace.ent = ge->edicts;
@@ -727,3 +1334,34 @@ SV_Trace(const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t
 	return clip.trace;
 }
 
+
+/*
+ * Prints how much work the broadphase did since the map
+ * was loaded or this command was run the last time
+ */
+void
+SV_WorldStats_f(void)
+{
+	if (!sv_broadphase_impl)
+	{
+		Com_Printf("No map loaded.\n");
+		return;
+	}
+
+	Com_Printf("broadphase: %s\n", sv_broadphase_impl->name);
+	Com_Printf(YQ2_COM_PRIdS " area queries, " YQ2_COM_PRIdS
+		" candidates tested, " YQ2_COM_PRIdS " found\n",
+		sv_worldqueries, sv_worldcandidates, sv_worldfound);
+	Com_Printf(YQ2_COM_PRIdS " traces, " YQ2_COM_PRIdS " entity clips",
+		sv_worldtraces, sv_worldclips);
+
+	if (sv_worldtraces)
+	{
+		Com_Printf(", %.2f per trace", (float)sv_worldclips / sv_worldtraces);
+	}
+
+	Com_Printf("\n");
+
+	sv_worldqueries = sv_worldcandidates = sv_worldfound = 0;
+	sv_worldtraces = sv_worldclips = 0;
+}